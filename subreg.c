@@ -46,16 +46,45 @@ typedef enum
 } mode_t;
 
 
+#define NO_INPUT_LENGTH                     ((unsigned long) -1)
+#define REPEAT_UNBOUNDED                    ((unsigned int) -1)
+
+
+/*
+ * Work done by a match, counted only for subreg_match_stats().
+ */
+typedef struct
+{
+    unsigned long steps;
+    unsigned long input_peak;
+    
+} counters_t;
+
+
+/*
+ * Positions in the input are offsets from its start, so that an input split
+ * into segments can be matched as one. The segment holding the last
+ * character read is cached. counters is 0 unless statistics are wanted.
+ */
 typedef struct
 {
     const char* regex;
-    const char* input;
+    unsigned long input;
+    const char* base;
+    const subreg_segment_t* segments;
+    unsigned int num_segments;
+    unsigned int segment;
+    unsigned long segment_start;
     subreg_capture_t* captures;
+    subreg_span_t* spans;
     unsigned int max_captures;
     int max_depth;
     unsigned int capture_index;
     int depth;
     int options;
+    counters_t* counters;
+    unsigned long input_length;
+    int unanchored;
     
 } state_t;
 
@@ -91,6 +120,7 @@ static int skip_block(state_t* state)
     {
         char rc;
         
+        if ( state->counters ) state->counters->steps++;
         rc = state->regex[0];
         
         if ( is_end(rc) )
@@ -118,7 +148,17 @@ static int skip_block(state_t* state)
         }
         else
         {
-            if ( rc == '\\' ) state->regex++;
+            if ( rc == '\\' )
+            {
+                state->regex++;
+                
+                /* the operand of \! is a character, even if it is '(' */
+                if ( state->regex[0] == '!' )
+                {
+                    state->regex++;
+                    if ( state->regex[0] == '\\' ) state->regex++;
+                }
+            }
             
             rc = state->regex[0];
             if ( is_end(rc) ) return SUBREG_RESULT_INVALID_METACHARACTER;
@@ -131,6 +171,43 @@ static int skip_block(state_t* state)
 }
 
 
+static char segment_char(state_t* state)
+{
+    const subreg_segment_t* segment;
+    
+    segment = &state->segments[state->segment];
+    
+    while ( state->input < state->segment_start )
+    {
+        segment--;
+        state->segment_start -= segment->length;
+    }
+    
+    while ( state->input - state->segment_start >= segment->length &&
+            segment != &state->segments[state->num_segments - 1] )
+    {
+        state->segment_start += segment->length;
+        segment++;
+    }
+    
+    state->segment = (unsigned int) (segment - state->segments);
+    
+    if ( state->input - state->segment_start >= segment->length ) return '\0';
+    
+    return segment->start[state->input - state->segment_start];
+}
+
+
+static char input_char(state_t* state)
+{
+    if ( state->segments ) return segment_char(state);
+    
+    /* a length-bounded input ends as if null-terminated */
+    return (state->input == state->input_length) ? '\0' :
+            state->base[state->input];
+}
+
+
 static int is_bad_result(int result)
 {
     return (result < 0);
@@ -186,6 +263,8 @@ static int match_option(char c)
 
 static int match_char(state_t* state, char c1, char c2)
 {
+    if ( is_end(c1) ) return SUBREG_RESULT_NO_MATCH;
+    
     if ( state->options & SUBREG_OPTION_NOCASE )
     {
         if ( c1 >= 'a' && c1 <= 'z' ) c1 = c1 - 'a' + 'A';
@@ -280,225 +359,415 @@ static int decode_non_class_metacharacter(state_t* state, char* c)
 }
 
 
-static int parse_literal(state_t* state)
+static int parse_count(const char** regex, unsigned int* count)
+{
+    const char* digit;
+    
+    digit = *regex;
+    
+    if ( !is_match_result(match_digit(digit[0])) )
+        return SUBREG_RESULT_ILLEGAL_EXPRESSION;
+    
+    for (*count = 0; is_match_result(match_digit(digit[0])); digit++)
+    {
+        *count = *count * 10 + (unsigned int) (digit[0] - '0');
+        
+        if ( *count > SUBREG_REPEAT_MAX )
+            return SUBREG_RESULT_ILLEGAL_EXPRESSION;
+    }
+    
+    *regex = digit;
+    
+    return SUBREG_RESULT_INTERNAL_MATCH;
+}
+
+
+/*
+ * Checks whether the '{' at regex starts counted repetition bounds, "{m}",
+ * "{m,}" or "{m,n}". As in PCRE, any other '{' is a plain character.
+ */
+static int is_count(const char* regex)
+{
+    regex++;
+    
+    if ( !is_match_result(match_digit(regex[0])) ) return 0;
+    while ( is_match_result(match_digit(regex[0])) ) regex++;
+    
+    if ( regex[0] == ',' )
+    {
+        regex++;
+        while ( is_match_result(match_digit(regex[0])) ) regex++;
+    }
+    
+    return regex[0] == '}';
+}
+
+
+/*
+ * Parses the bounds of a counted repetition, "{m}", "{m,}" or "{m,n}",
+ * with regex just past its '{', and leaves regex just past its '}'. The
+ * maximum of "{m,}" is REPEAT_UNBOUNDED.
+ */
+static int parse_bounds(const char** regex, unsigned int* min,
+        unsigned int* max)
+{
+    int result;
+    
+    result = parse_count(regex, min);
+    if ( is_bad_result(result) ) return result;
+    
+    *max = *min;
+    
+    if ( (*regex)[0] == ',' )
+    {
+        (*regex)++;
+    
+        if ( (*regex)[0] == '}' ) *max = REPEAT_UNBOUNDED;
+        else
+        {
+            result = parse_count(regex, max);
+            if ( is_bad_result(result) ) return result;
+        }
+    }
+    
+    if ( (*regex)[0] != '}' || *max < *min )
+        return SUBREG_RESULT_ILLEGAL_EXPRESSION;
+    
+    (*regex)++;
+    
+    return SUBREG_RESULT_INTERNAL_MATCH;
+}
+
+
+static int parse_group(state_t* state)
 {
     int result;
-    char c;
     char rc;
     mode_t mode;
-    const char* input_start;
+    unsigned long input_start;
     unsigned int next_capture_index;
-    subreg_capture_t* cap;
-    
-    c = state->input[0];
     
-    rc = state->regex[0];
-    if ( !is_end(rc) ) state->regex++;
+    state->depth++;
+
+    if ( state->depth > state->max_depth )
+            return SUBREG_RESULT_MAX_DEPTH_EXCEEDED;
     
-    if ( rc == '(' )
+    input_start = state->input;
+
+    if ( state->regex[0] == '?' )
     {
-        state->depth++;
-    
-        if ( state->depth > state->max_depth )
-                return SUBREG_RESULT_MAX_DEPTH_EXCEEDED;
+        state->regex++;
         
-        input_start = state->input;
-
-        if ( state->regex[0] == '?' )
+        if ( state->regex[0] == ':' ) mode = MODE_NON_CAPTURE;
+        else if ( state->regex[0] == '=' ) mode = MODE_POS_LOOK_AHEAD;
+        else if ( state->regex[0] == '!' ) mode = MODE_NEG_LOOK_AHEAD;
+        else if ( match_option(state->regex[0]) )
         {
-            state->regex++;
-            
-            if ( state->regex[0] == ':' ) mode = MODE_NON_CAPTURE;
-            else if ( state->regex[0] == '=' ) mode = MODE_POS_LOOK_AHEAD;
-            else if ( state->regex[0] == '!' ) mode = MODE_NEG_LOOK_AHEAD;
-            else if ( match_option(state->regex[0]) )
+            switch(state->regex[0])
             {
-                switch(state->regex[0])
-                {
-                case SUBREG_OPTION_CHAR_SET_NOCASE:
-                    state->options |= SUBREG_OPTION_NOCASE;
-                    break;
-
-                case SUBREG_OPTION_CHAR_CLEAR_NOCASE:
-                    state->options &= ~SUBREG_OPTION_NOCASE;
-                    break;
+            case SUBREG_OPTION_CHAR_SET_NOCASE:
+                state->options |= SUBREG_OPTION_NOCASE;
+                break;
 
-                default:
-                    return SUBREG_RESULT_INVALID_OPTION;
-                }
+            case SUBREG_OPTION_CHAR_CLEAR_NOCASE:
+                state->options &= ~SUBREG_OPTION_NOCASE;
+                break;
 
-                state->regex++;
+            default:
+                return SUBREG_RESULT_INVALID_OPTION;
+            }
 
-                rc = state->regex[0];
-                if ( rc != ')' ) return SUBREG_RESULT_MISSING_BRACKET;
+            state->regex++;
 
-                state->regex++;
+            rc = state->regex[0];
+            if ( rc != ')' ) return SUBREG_RESULT_MISSING_BRACKET;
 
-                return SUBREG_RESULT_INTERNAL_MATCH;
-            }
-            else return SUBREG_RESULT_ILLEGAL_EXPRESSION;
-            
             state->regex++;
+            state->depth--;
+
+            return SUBREG_RESULT_INTERNAL_MATCH;
         }
-        else if ( state->max_captures > 0 ) mode = MODE_CAPTURE;
-        else mode = MODE_NON_CAPTURE;
-        
-        result = parse_sub_expr(state);
-        if ( is_bad_result(result) ) return result;
-        
-        rc = state->regex[0];
-        if ( rc != ')' ) return SUBREG_RESULT_MISSING_BRACKET;
+        else return SUBREG_RESULT_ILLEGAL_EXPRESSION;
         
         state->regex++;
-        
-        if ( mode == MODE_CAPTURE )
+    }
+    else if ( state->max_captures > 0 ) mode = MODE_CAPTURE;
+    else mode = MODE_NON_CAPTURE;
+    
+    result = parse_sub_expr(state);
+    if ( is_bad_result(result) ) return result;
+    
+    rc = state->regex[0];
+    if ( rc != ')' ) return SUBREG_RESULT_MISSING_BRACKET;
+    
+    state->regex++;
+    
+    if ( mode == MODE_CAPTURE )
+    {
+        if ( is_match_result(result) )
         {
-            if ( is_match_result(result) )
+            next_capture_index = state->capture_index + 1;
+            
+            if ( next_capture_index > state->max_captures )
+                    return SUBREG_RESULT_CAPTURE_OVERFLOW;
+        
+            if ( state->spans )
+            {
+                state->spans[state->capture_index].offset = input_start;
+                state->spans[state->capture_index].length =
+                        state->input - input_start;
+            }
+            else
             {
-                next_capture_index = state->capture_index + 1;
+                subreg_capture_t* cap;
                 
-                if ( next_capture_index > state->max_captures )
-                        return SUBREG_RESULT_CAPTURE_OVERFLOW;
-            
                 cap = &state->captures[state->capture_index];
                 
-                cap->start = input_start;
-                cap->length = state->input - input_start;
-                
-                state->capture_index = next_capture_index;
+                cap->start = state->base + input_start;
+                cap->length = (unsigned int) (state->input - input_start);
             }
+            
+            state->capture_index = next_capture_index;
         }
-        else if ( mode == MODE_POS_LOOK_AHEAD )
-        {
-            state->input = input_start;
-        }
-        else if ( mode == MODE_NEG_LOOK_AHEAD )
-        {
-            state->input = input_start;
+    }
+    else if ( mode == MODE_POS_LOOK_AHEAD )
+    {
+        state->input = input_start;
+    }
+    else if ( mode == MODE_NEG_LOOK_AHEAD )
+    {
+        state->input = input_start;
 
-            result = is_match_result(result) ?
-                    SUBREG_RESULT_NO_MATCH : SUBREG_RESULT_INTERNAL_MATCH;
-        }
-        
-        state->depth--;
-        
-        return result;
+        result = is_match_result(result) ?
+                SUBREG_RESULT_NO_MATCH : SUBREG_RESULT_INTERNAL_MATCH;
     }
-    else if ( rc == '\\' )
+    
+    state->depth--;
+    
+    return result;
+}
+
+
+static int parse_escape(state_t* state, char c)
+{
+    int result;
+    char rc;
+    
+    rc = state->regex[0];
+    if ( is_end(rc) ) return SUBREG_RESULT_INVALID_METACHARACTER;
+    
+    switch (rc)
     {
+    case 'D':   result = invert_match(c, match_digit);          break;
+    case 'H':   result = invert_match(c, match_hexadecimal);    break;
+    case 'S':   result = invert_match(c, match_whitespace);     break;
+    case 'W':   result = invert_match(c, match_word);           break;
+    case 'd':   result = match_digit(c);                        break;
+    case 'h':   result = match_hexadecimal(c);                  break;
+    case 's':   result = match_whitespace(c);                   break;
+    case 'w':   result = match_word(c);                         break;
+    case '!':
+        state->regex++;
         rc = state->regex[0];
         if ( is_end(rc) ) return SUBREG_RESULT_INVALID_METACHARACTER;
-        
-        switch (rc)
+
+        state->regex++;
+
+        if ( rc == '\\' )
         {
-        case 'D':   result = invert_match(c, match_digit);          break;
-        case 'H':   result = invert_match(c, match_hexadecimal);    break;
-        case 'S':   result = invert_match(c, match_whitespace);     break;
-        case 'W':   result = invert_match(c, match_word);           break;
-        case 'd':   result = match_digit(c);                        break;
-        case 'h':   result = match_hexadecimal(c);                  break;
-        case 's':   result = match_whitespace(c);                   break;
-        case 'w':   result = match_word(c);                         break;
-        case '!':
-            state->regex++;
             rc = state->regex[0];
             if ( is_end(rc) ) return SUBREG_RESULT_INVALID_METACHARACTER;
 
-            if ( rc == '\\' )
-            {
-                state->regex++;
-                rc = state->regex[0];
-                if ( is_end(rc) ) return SUBREG_RESULT_INVALID_METACHARACTER;
+            result = decode_non_class_metacharacter(state, &rc);
+            if ( is_bad_result(result) ) return result;
+        }
 
-                result = decode_non_class_metacharacter(state, &rc);
-                if ( is_bad_result(result) ) return result;
-            }
+        if ( is_end(c) ) return SUBREG_RESULT_NO_MATCH;
+        
+        result = match_char(state, c, rc);
+        if ( is_bad_result(result) ) return result;
+        
+        result = is_match_result(result) ?
+                SUBREG_RESULT_NO_MATCH : SUBREG_RESULT_INTERNAL_MATCH;
 
-            if ( is_end(c) ) return SUBREG_RESULT_NO_MATCH;
-            
-            result = match_char(state, c, rc);
-            if ( is_bad_result(result) ) return result;
-            
-            result = is_match_result(result) ?
-                    SUBREG_RESULT_NO_MATCH : SUBREG_RESULT_INTERNAL_MATCH;
+        /* the escape has already been consumed */
+        if ( is_match_result(result) ) state->input++;
 
-            break;
+        return result;
+    
+    default:
+        result = decode_non_class_metacharacter(state, &rc);
+        if ( is_bad_result(result) ) return result;
         
-        default:
-            result = decode_non_class_metacharacter(state, &rc);
-            if ( is_bad_result(result) ) return result;
-            
-            result = match_char(state, c, rc);
-            if ( is_match_result(result) ) state->input++;
-            
-            return result;
-        }
+        result = match_char(state, c, rc);
+        if ( is_match_result(result) ) state->input++;
         
-        state->regex++;
-    }
-    else
-    {
-        switch (rc)
-        {
-        case '.':
-            result = is_end(c) ? SUBREG_RESULT_NO_MATCH :
-                    SUBREG_RESULT_INTERNAL_MATCH;
-            break;
-            
-        default:
-            result = match_char(state, c, rc);
-        }
+        return result;
     }
     
+    state->regex++;
+    
     if ( is_match_result(result) ) state->input++;
     
     return result;
 }
 
 
-static int parse_repetition(state_t* state)
+static int parse_literal(state_t* state)
 {
-    const char* regex_begin;
-    const char* regex_end;
-    const char* check_point;
     int result;
+    char c;
     char rc;
     
-    regex_begin = state->regex;
-    check_point = state->input;
+    if ( state->counters )
+    {
+        state->counters->steps++;
+        if ( state->input > state->counters->input_peak )
+            state->counters->input_peak = state->input;
+    }
     
-    result = parse_literal(state);
-    if ( is_bad_result(result) || is_end(state->regex[0]) ) return result;
+    c = input_char(state);
     
     rc = state->regex[0];
     
-    if ( rc == '?' )
-    {
-        state->regex++;
-        if ( !is_match_result(result) ) state->input = check_point;
-        return SUBREG_RESULT_INTERNAL_MATCH;
-    }
-    else if ( rc == '+' )
-    {
-        if ( !is_match_result(result) ) return SUBREG_RESULT_NO_MATCH;
-    }
-    else if ( rc == '*' )
+    /* an empty trailing branch matches without consuming input */
+    if ( is_end(rc) ) return SUBREG_RESULT_INTERNAL_MATCH;
+    
+    state->regex++;
+    
+    /*
+     * Plain characters and '.' make up most atoms, so they are tested first
+     * and groups and escapes are handled out of line.
+     */
+    if ( rc != '(' && rc != '\\' )
     {
-        if ( !is_match_result(result) )
+        if ( rc == '.' )
         {
-            state->regex++;
-            state->input = check_point;
-            return SUBREG_RESULT_INTERNAL_MATCH;
+            result = is_end(c) ? SUBREG_RESULT_NO_MATCH :
+                    SUBREG_RESULT_INTERNAL_MATCH;
         }
+        else result = match_char(state, c, rc);
+        
+        if ( is_match_result(result) ) state->input++;
+        
+        return result;
     }
-    else return result;
+    
+    if ( rc == '(' ) return parse_group(state);
+    
+    return parse_escape(state, c);
+}
+
+
+/*
+ * Repeats the atom at regex_begin, which has been tried once from
+ * check_point with the given result, for as many times as the bounds after
+ * it allow. The iterations are counted, so a large count costs no more
+ * regex or stack than a small one. A count of zero still tries the atom,
+ * like any other repetition, but gives back what it consumed and captured.
+ */
+static int parse_counted_repetition(state_t* state, const char* regex_begin,
+        unsigned long check_point, unsigned int capture_index, int result)
+{
+    const char* regex_end;
+    unsigned int min;
+    unsigned int max;
+    unsigned int count;
+    int bounds_result;
     
     regex_end = state->regex + 1;
     
-    for (;;)
+    bounds_result = parse_bounds(&regex_end, &min, &max);
+    if ( is_bad_result(bounds_result) ) return bounds_result;
+    
+    count = is_match_result(result) ? 1 : 0;
+    
+    if ( max == 0 )
     {
-        state->regex = regex_begin;
-        check_point = state->input;
+        state->capture_index = capture_index;
+        count = 0;
+    }
+    
+    while ( count > 0 && count < max )
+    {
+        /* an iteration that consumes no input would repeat identically */
+        if ( state->input == check_point )
+        {
+            count = max;
+            break;
+        }
+    
+        state->regex = regex_begin;
+        check_point = state->input;
+    
+        result = parse_literal(state);
+        if ( is_bad_result(result) ) return result;
+    
+        if ( !is_match_result(result) ) break;
+    
+        count++;
+    }
+    
+    if ( count == 0 || !is_match_result(result) ) state->input = check_point;
+    
+    state->regex = regex_end;
+    
+    return (count >= min) ? SUBREG_RESULT_INTERNAL_MATCH :
+            SUBREG_RESULT_NO_MATCH;
+}
+
+
+static int parse_repetition(state_t* state)
+{
+    const char* regex_begin;
+    const char* regex_end;
+    unsigned long check_point;
+    unsigned int capture_index;
+    int result;
+    char rc;
+    
+    regex_begin = state->regex;
+    check_point = state->input;
+    capture_index = state->capture_index;
+    
+    result = parse_literal(state);
+    if ( is_bad_result(result) || is_end(state->regex[0]) ) return result;
+    
+    rc = state->regex[0];
+    
+    if ( rc == '{' && is_count(state->regex) )
+    {
+        return parse_counted_repetition(state, regex_begin, check_point,
+                capture_index, result);
+    }
+    else if ( rc == '?' )
+    {
+        state->regex++;
+        if ( !is_match_result(result) ) state->input = check_point;
+        return SUBREG_RESULT_INTERNAL_MATCH;
+    }
+    else if ( rc == '+' )
+    {
+        if ( !is_match_result(result) ) return SUBREG_RESULT_NO_MATCH;
+    }
+    else if ( rc == '*' )
+    {
+        if ( !is_match_result(result) )
+        {
+            state->regex++;
+            state->input = check_point;
+            return SUBREG_RESULT_INTERNAL_MATCH;
+        }
+    }
+    else return result;
+    
+    regex_end = state->regex + 1;
+    
+    /* an iteration that consumes no input would repeat identically forever */
+    while ( state->input != check_point )
+    {
+        state->regex = regex_begin;
+        check_point = state->input;
 
         result = parse_literal(state);
         if ( is_bad_result(result) ) return result;
@@ -535,7 +804,7 @@ static int parse_concatenation(state_t* state)
 
 static int parse_alternation(state_t* state)
 {
-    const char* input_begin;
+    unsigned long input_begin;
     
     input_begin = state->input;
     
@@ -595,39 +864,74 @@ static int parse_expr(state_t* state)
     
     if ( is_match_result(result) )
     {
-        if ( state->regex[0] == '$' ) state->regex++;
+        int anchored;
+        
+        anchored = !state->unanchored;
+        
+        if ( state->regex[0] == '$' )
+        {
+            state->regex++;
+            anchored = 1;
+        }
         
         if ( !is_end(state->regex[0]) )
             return SUBREG_RESULT_ILLEGAL_EXPRESSION;
         
-        if ( is_end(state->input[0]) ) return SUBREG_RESULT_INTERNAL_MATCH;
-        else return SUBREG_RESULT_NO_MATCH;
+        /* a search only has to reach the end of the input if asked to */
+        if ( !anchored ) return SUBREG_RESULT_INTERNAL_MATCH;
+        
+        if ( state->input_length != NO_INPUT_LENGTH )
+        {
+            if ( state->input == state->input_length )
+                return SUBREG_RESULT_INTERNAL_MATCH;
+        }
+        else if ( is_end(state->base[state->input]) )
+        {
+            return SUBREG_RESULT_INTERNAL_MATCH;
+        }
     }
     
     return SUBREG_RESULT_NO_MATCH;
 }
 
 
-int subreg_match(const char* regex, const char* input,
-        subreg_capture_t captures[], unsigned int max_captures,
-        unsigned int max_depth)
+static void init_state(state_t* state, const char* regex,
+        unsigned int max_captures, unsigned int max_depth, int unanchored)
+{
+    state->regex = regex;
+    state->input = 0;
+    state->base = 0;
+    state->segments = 0;
+    state->num_segments = 0;
+    state->segment = 0;
+    state->segment_start = 0;
+    state->captures = 0;
+    state->spans = 0;
+    state->max_captures = max_captures;
+    state->max_depth = (int) max_depth;
+    state->capture_index = 1;
+    state->depth = 0;
+    state->options = 0;
+    state->counters = 0;
+    state->input_length = NO_INPUT_LENGTH;
+    state->unanchored = unanchored;
+}
+
+
+static int run_match(state_t* state, const char* input,
+        const char* input_end, subreg_capture_t captures[])
 {
-    state_t state;
     int result;
     
-    if ( !regex || !input || (max_captures > 0 && !captures) )
+    if ( !state->regex || !input || (state->max_captures > 0 && !captures) )
         return SUBREG_RESULT_INVALID_ARGUMENT;
     
-    state.regex = regex;
-    state.input = input;
-    state.captures = captures;
-    state.max_captures = max_captures;
-    state.max_depth = (int) max_depth;
-    state.capture_index = 1;
-    state.depth = 0;
-    state.options = 0;
+    state->base = input;
+    state->captures = captures;
     
-    result = parse_expr(&state);
+    if ( input_end ) state->input_length = (unsigned long) (input_end - input);
+    
+    result = parse_expr(state);
     
     if ( result <= 0 )
     {
@@ -635,12 +939,3188 @@ int subreg_match(const char* regex, const char* input,
     }
     else
     {
-        if ( max_captures > 0 )
+        if ( state->max_captures > 0 )
         {
             captures[0].start = input;
-            captures[0].length = state.input - input;
+            captures[0].length = (unsigned int) state->input;
         }
         
-        return (int) (state.capture_index);
+        return (int) (state->capture_index);
     } 
 }
+
+
+static int match(state_t* state, const char* regex, const char* input,
+        const char* input_end, subreg_capture_t captures[],
+        unsigned int max_captures, unsigned int max_depth, int unanchored)
+{
+    init_state(state, regex, max_captures, max_depth, unanchored);
+    
+    return run_match(state, input, input_end, captures);
+}
+
+
+int subreg_match(const char* regex, const char* input,
+        subreg_capture_t captures[], unsigned int max_captures,
+        unsigned int max_depth)
+{
+    state_t state;
+    
+    return match(&state, regex, input, 0, captures, max_captures,
+            max_depth, 0);
+}
+
+
+int subreg_match_n(const char* regex, const char* input,
+        unsigned int input_length, subreg_capture_t captures[],
+        unsigned int max_captures, unsigned int max_depth)
+{
+    state_t state;
+    
+    if ( !input ) return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    return match(&state, regex, input, input + input_length, captures,
+            max_captures, max_depth, 0);
+}
+
+
+int subreg_match_segments(const char* regex,
+        const subreg_segment_t segments[], unsigned int num_segments,
+        subreg_span_t captures[], unsigned int max_captures,
+        unsigned int max_depth)
+{
+    state_t state;
+    unsigned int i;
+    int result;
+    
+    init_state(&state, regex, max_captures, max_depth, 0);
+    
+    if ( !regex || (num_segments > 0 && !segments) ||
+            (max_captures > 0 && !captures) )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    state.input_length = 0;
+    
+    for (i = 0; i < num_segments; i++)
+    {
+        if ( !segments[i].start && segments[i].length > 0 )
+            return SUBREG_RESULT_INVALID_ARGUMENT;
+        
+        state.input_length += segments[i].length;
+    }
+    
+    if ( num_segments > 0 ) state.segments = segments;
+    state.num_segments = num_segments;
+    state.spans = captures;
+    
+    result = parse_expr(&state);
+    if ( result <= 0 ) return result;
+    
+    if ( max_captures > 0 )
+    {
+        captures[0].offset = 0;
+        captures[0].length = state.input;
+    }
+    
+    return (int) state.capture_index;
+}
+
+
+int subreg_locate(const subreg_segment_t segments[],
+        unsigned int num_segments, unsigned long offset,
+        unsigned int* segment, unsigned long* segment_offset)
+{
+    unsigned int i;
+    
+    if ( (num_segments > 0 && !segments) || !segment || !segment_offset )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    /* an offset at a boundary is in the segment it starts */
+    for (i = 0; i < num_segments; i++)
+    {
+        if ( offset < segments[i].length ) break;
+        if ( offset == segments[i].length && i == num_segments - 1 ) break;
+        
+        offset -= segments[i].length;
+    }
+    
+    if ( i == num_segments ) return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    *segment = i;
+    *segment_offset = offset;
+    
+    return 0;
+}
+
+
+static unsigned long hash_input(const char* input, unsigned int length,
+        unsigned int max_captures)
+{
+    unsigned long hash;
+    unsigned int i;
+    
+    /* 32-bit FNV-1a, seeded with max_captures */
+    hash = 2166136261UL ^ max_captures;
+    
+    for (i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char) input[i];
+        hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+    }
+    
+    return hash;
+}
+
+
+static int is_memo_hit(const subreg_memo_entry_t* entry, unsigned long hash,
+        const char* input, unsigned int length, unsigned int max_captures)
+{
+    unsigned int i;
+    
+    if ( !entry->occupied || entry->hash != hash ||
+            entry->input_length != length ||
+            entry->max_captures != max_captures ) return 0;
+    
+    for (i = 0; i < length; i++)
+        if ( entry->input[i] != input[i] ) return 0;
+    
+    return 1;
+}
+
+
+void subreg_memo_init(subreg_memo_t* memo, const char* regex,
+        unsigned int max_depth, subreg_memo_entry_t entries[],
+        unsigned int num_entries)
+{
+    unsigned int i;
+    
+    memo->regex = regex;
+    memo->max_depth = max_depth;
+    memo->entries = entries;
+    memo->num_entries = entries ? num_entries : 0;
+    memo->hits = 0;
+    memo->misses = 0;
+    memo->bypasses = 0;
+    memo->evictions = 0;
+    
+    for (i = 0; i < memo->num_entries; i++) entries[i].occupied = 0;
+}
+
+
+int subreg_memo_match(subreg_memo_t* memo, const char* input,
+        subreg_capture_t captures[], unsigned int max_captures)
+{
+    subreg_memo_entry_t* entry;
+    unsigned long hash;
+    unsigned int length;
+    unsigned int home;
+    unsigned int probe;
+    unsigned int i;
+    int result;
+    
+    if ( !memo || !input || (max_captures > 0 && !captures) )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    for (length = 0; length <= SUBREG_MEMO_MAX_INPUT; length++)
+        if ( is_end(input[length]) ) break;
+    
+    if ( length > SUBREG_MEMO_MAX_INPUT || memo->num_entries == 0 )
+    {
+        memo->bypasses++;
+        return subreg_match(memo->regex, input, captures, max_captures,
+                memo->max_depth);
+    }
+    
+    hash = hash_input(input, length, max_captures);
+    home = (unsigned int) (hash % memo->num_entries);
+    entry = 0;
+    
+    for (probe = 0; probe < SUBREG_MEMO_PROBE_LIMIT &&
+            probe < memo->num_entries; probe++)
+    {
+        subreg_memo_entry_t* candidate;
+        
+        candidate = &memo->entries[(home + probe) % memo->num_entries];
+        
+        if ( is_memo_hit(candidate, hash, input, length, max_captures) )
+        {
+            memo->hits++;
+            result = candidate->result;
+            
+            if ( max_captures > 0 )
+            {
+                for (i = 0; (int) i < result; i++)
+                {
+                    captures[i].start = input + candidate->capture_offsets[i];
+                    captures[i].length = candidate->capture_lengths[i];
+                }
+            }
+            
+            return result;
+        }
+        
+        if ( !entry && !candidate->occupied ) entry = candidate;
+    }
+    
+    result = subreg_match(memo->regex, input, captures, max_captures,
+            memo->max_depth);
+    
+    /* every lookup is counted once, as a hit, a miss or a bypass */
+    if ( max_captures > 0 && result > SUBREG_MEMO_MAX_CAPTURES )
+    {
+        memo->bypasses++;
+        return result;
+    }
+    
+    memo->misses++;
+    
+    if ( !entry )
+    {
+        entry = &memo->entries[home];
+        memo->evictions++;
+    }
+    
+    entry->hash = hash;
+    entry->occupied = 1;
+    entry->result = result;
+    entry->max_captures = max_captures;
+    entry->input_length = length;
+    
+    for (i = 0; i < length; i++) entry->input[i] = input[i];
+    
+    if ( max_captures > 0 )
+    {
+        for (i = 0; (int) i < result; i++)
+        {
+            entry->capture_offsets[i] = captures[i].start - input;
+            entry->capture_lengths[i] = captures[i].length;
+        }
+    }
+    
+    return result;
+}
+
+
+void subreg_stats_init(subreg_stats_t* stats)
+{
+    unsigned int i;
+    
+    stats->calls = 0;
+    stats->matches = 0;
+    stats->no_matches = 0;
+    stats->errors = 0;
+    stats->bytes = 0;
+    stats->steps = 0;
+    
+    for (i = 0; i < SUBREG_STATS_NUM_BUCKETS; i++) stats->histogram[i] = 0;
+}
+
+
+int subreg_match_stats(subreg_stats_t* stats, const char* regex,
+        const char* input, subreg_capture_t captures[],
+        unsigned int max_captures, unsigned int max_depth)
+{
+    state_t state;
+    counters_t counters;
+    unsigned long steps;
+    unsigned int bucket;
+    int result;
+    
+    if ( !stats )
+        return subreg_match(regex, input, captures, max_captures, max_depth);
+    
+    counters.steps = 0;
+    counters.input_peak = 0;
+    
+    init_state(&state, regex, max_captures, max_depth, 0);
+    state.counters = &counters;
+    
+    result = run_match(&state, input, 0, captures);
+    
+    stats->calls++;
+    
+    if ( is_bad_result(result) ) stats->errors++;
+    else if ( is_match_result(result) ) stats->matches++;
+    else stats->no_matches++;
+    
+    if ( state.input > counters.input_peak ) counters.input_peak = state.input;
+    
+    stats->bytes += counters.input_peak;
+    stats->steps += counters.steps;
+    
+    bucket = 0;
+    
+    for (steps = counters.steps; steps > 1; steps >>= 1)
+        if ( bucket < SUBREG_STATS_NUM_BUCKETS - 1 ) bucket++;
+    
+    stats->histogram[bucket]++;
+    
+    return result;
+}
+
+
+void subreg_stats_merge(subreg_stats_t* dest, const subreg_stats_t* src)
+{
+    unsigned int i;
+    
+    dest->calls += src->calls;
+    dest->matches += src->matches;
+    dest->no_matches += src->no_matches;
+    dest->errors += src->errors;
+    dest->bytes += src->bytes;
+    dest->steps += src->steps;
+    
+    for (i = 0; i < SUBREG_STATS_NUM_BUCKETS; i++)
+        dest->histogram[i] += src->histogram[i];
+}
+
+
+static unsigned int append_string(char* buffer, unsigned int size,
+        unsigned int length, const char* str)
+{
+    for (; !is_end(str[0]); str++, length++)
+        if ( length + 1 < size ) buffer[length] = str[0];
+    
+    return length;
+}
+
+
+static unsigned int append_ulong(char* buffer, unsigned int size,
+        unsigned int length, unsigned long value)
+{
+    char digits[24];
+    unsigned int i;
+    
+    i = sizeof(digits) - 1;
+    digits[i] = '\0';
+    
+    do
+    {
+        digits[--i] = (char) ('0' + (value % 10));
+        value /= 10;
+    
+    } while ( value > 0 );
+    
+    return append_string(buffer, size, length, &digits[i]);
+}
+
+
+unsigned int subreg_stats_format(const subreg_stats_t* stats,
+        const char* name, char* buffer, unsigned int size)
+{
+    unsigned int length;
+    unsigned int i;
+    
+    length = append_string(buffer, size, 0, name ? name : "");
+    length = append_string(buffer, size, length, " calls=");
+    length = append_ulong(buffer, size, length, stats->calls);
+    length = append_string(buffer, size, length, " matches=");
+    length = append_ulong(buffer, size, length, stats->matches);
+    length = append_string(buffer, size, length, " no_matches=");
+    length = append_ulong(buffer, size, length, stats->no_matches);
+    length = append_string(buffer, size, length, " errors=");
+    length = append_ulong(buffer, size, length, stats->errors);
+    length = append_string(buffer, size, length, " bytes=");
+    length = append_ulong(buffer, size, length, stats->bytes);
+    length = append_string(buffer, size, length, " steps=");
+    length = append_ulong(buffer, size, length, stats->steps);
+    length = append_string(buffer, size, length, " histogram=");
+    
+    for (i = 0; i < SUBREG_STATS_NUM_BUCKETS; i++)
+    {
+        if ( i > 0 ) length = append_string(buffer, size, length, ",");
+        length = append_ulong(buffer, size, length, stats->histogram[i]);
+    }
+    
+    if ( size > 0 ) buffer[length < size ? length : size - 1] = '\0';
+    
+    return length;
+}
+
+
+typedef struct
+{
+    unsigned long terms[SUBREG_COST_NUM_TERMS];
+    
+} poly_t;
+
+
+typedef struct
+{
+    const char* regex;
+    int max_depth;
+    int depth;
+    int deepest;
+    
+} analysis_t;
+
+
+static int analyze_alternation(analysis_t* an, poly_t* a, poly_t* b);
+
+
+static unsigned long saturating_add(unsigned long x, unsigned long y)
+{
+    return (x + y < x) ? ~0UL : x + y;
+}
+
+
+static void poly_zero(poly_t* p)
+{
+    unsigned int i;
+    
+    for (i = 0; i < SUBREG_COST_NUM_TERMS; i++) p->terms[i] = 0;
+}
+
+
+static void poly_add(poly_t* dest, const poly_t* src)
+{
+    unsigned int i;
+    
+    for (i = 0; i < SUBREG_COST_NUM_TERMS; i++)
+        dest->terms[i] = saturating_add(dest->terms[i], src->terms[i]);
+}
+
+
+static void poly_max(poly_t* dest, const poly_t* src)
+{
+    unsigned int i;
+    
+    for (i = 0; i < SUBREG_COST_NUM_TERMS; i++)
+        if ( src->terms[i] > dest->terms[i] ) dest->terms[i] = src->terms[i];
+}
+
+
+static void poly_add_scaled(poly_t* dest, const poly_t* src)
+{
+    unsigned int i;
+    
+    /* dest += src * (n + 1), folding any overflowing term into the last */
+    for (i = 0; i + 1 < SUBREG_COST_NUM_TERMS; i++)
+        dest->terms[i + 1] = saturating_add(dest->terms[i + 1], src->terms[i]);
+    
+    if ( src->terms[SUBREG_COST_NUM_TERMS - 1] )
+        dest->terms[SUBREG_COST_NUM_TERMS - 1] = ~0UL;
+}
+
+
+static int analyze_non_class_metacharacter(analysis_t* an)
+{
+    char rc;
+    unsigned int i;
+    
+    rc = an->regex[0];
+    if ( is_end(rc) ) return SUBREG_RESULT_INVALID_METACHARACTER;
+    
+    an->regex++;
+    
+    switch (rc)
+    {
+    case 'D':
+    case 'H':
+    case 'S':
+    case 'W':
+    case 'd':
+    case 'h':
+    case 's':
+    case 'w':
+    case '!':   return SUBREG_RESULT_ILLEGAL_EXPRESSION;
+    
+    case 'x':
+        for (i = 0; i < 2; i++, an->regex++)
+            if ( !match_hexadecimal(an->regex[0]) )
+                return SUBREG_RESULT_INVALID_METACHARACTER;
+        
+        break;
+    }
+    
+    return SUBREG_RESULT_INTERNAL_MATCH;
+}
+
+
+/*
+ * Each element is summarised by polynomials a and b in (n + 1), such that
+ * matching it at any input position takes at most a * consumed + b steps
+ * when it succeeds and a * (n + 1) + b steps when it fails, where consumed
+ * is the number of input characters it consumes.
+ */
+static int analyze_literal(analysis_t* an, poly_t* a, poly_t* b)
+{
+    poly_t sub_a;
+    poly_t sub_b;
+    mode_t mode;
+    char rc;
+    int result;
+    
+    poly_zero(a);
+    poly_zero(b);
+    b->terms[0] = 1;
+    
+    rc = an->regex[0];
+    if ( !is_end(rc) ) an->regex++;
+    
+    if ( rc == '(' )
+    {
+        an->depth++;
+        
+        if ( an->depth > an->max_depth )
+                return SUBREG_RESULT_MAX_DEPTH_EXCEEDED;
+        
+        if ( an->depth > an->deepest ) an->deepest = an->depth;
+        
+        mode = MODE_CAPTURE;
+        
+        if ( an->regex[0] == '?' )
+        {
+            an->regex++;
+            rc = an->regex[0];
+            
+            if ( rc == ':' ) mode = MODE_NON_CAPTURE;
+            else if ( rc == '=' ) mode = MODE_POS_LOOK_AHEAD;
+            else if ( rc == '!' ) mode = MODE_NEG_LOOK_AHEAD;
+            else if ( match_option(rc) )
+            {
+                if ( rc != SUBREG_OPTION_CHAR_SET_NOCASE &&
+                        rc != SUBREG_OPTION_CHAR_CLEAR_NOCASE )
+                    return SUBREG_RESULT_INVALID_OPTION;
+                
+                an->regex++;
+                if ( an->regex[0] != ')' ) return SUBREG_RESULT_MISSING_BRACKET;
+                
+                an->regex++;
+                an->depth--;
+                
+                return SUBREG_RESULT_INTERNAL_MATCH;
+            }
+            else return SUBREG_RESULT_ILLEGAL_EXPRESSION;
+            
+            an->regex++;
+        }
+        
+        result = analyze_alternation(an, &sub_a, &sub_b);
+        if ( is_bad_result(result) ) return result;
+        
+        if ( an->regex[0] != ')' ) return SUBREG_RESULT_MISSING_BRACKET;
+        
+        an->regex++;
+        an->depth--;
+        
+        poly_add(b, &sub_b);
+        
+        /* look-aheads consume nothing but may scan the rest of the input */
+        if ( mode == MODE_POS_LOOK_AHEAD || mode == MODE_NEG_LOOK_AHEAD )
+            poly_add_scaled(b, &sub_a);
+        else
+            poly_add(a, &sub_a);
+    }
+    else if ( rc == '\\' )
+    {
+        rc = an->regex[0];
+        if ( is_end(rc) ) return SUBREG_RESULT_INVALID_METACHARACTER;
+        
+        switch (rc)
+        {
+        case 'D':
+        case 'H':
+        case 'S':
+        case 'W':
+        case 'd':
+        case 'h':
+        case 's':
+        case 'w':
+            an->regex++;
+            break;
+        
+        case '!':
+            an->regex++;
+            rc = an->regex[0];
+            if ( is_end(rc) ) return SUBREG_RESULT_INVALID_METACHARACTER;
+            
+            an->regex++;
+            
+            if ( rc == '\\' )
+            {
+                if ( is_end(an->regex[0]) )
+                    return SUBREG_RESULT_INVALID_METACHARACTER;
+                
+                result = analyze_non_class_metacharacter(an);
+                if ( is_bad_result(result) ) return result;
+            }
+            
+            break;
+        
+        default:
+            result = analyze_non_class_metacharacter(an);
+            if ( is_bad_result(result) ) return result;
+        }
+    }
+    
+    return SUBREG_RESULT_INTERNAL_MATCH;
+}
+
+
+static int analyze_repetition(analysis_t* an, poly_t* a, poly_t* b)
+{
+    poly_t temp;
+    unsigned int min;
+    unsigned int max;
+    int repeated;
+    int result;
+    char rc;
+    
+    result = analyze_literal(an, a, b);
+    if ( is_bad_result(result) ) return result;
+    
+    rc = an->regex[0];
+    
+    if ( rc == '{' && is_count(an->regex) )
+    {
+        an->regex++;
+        
+        result = parse_bounds(&an->regex, &min, &max);
+        if ( is_bad_result(result) ) return result;
+        
+        repeated = (max > 1);
+    }
+    else if ( rc == '?' || rc == '*' || rc == '+' )
+    {
+        an->regex++;
+        repeated = (rc != '?');
+    }
+    else return SUBREG_RESULT_INTERNAL_MATCH;
+    
+    /*
+     * Every iteration but the last consumes at least one character, so
+     * a repetition's fixed cost becomes a per-character cost, plus one
+     * final attempt that may scan to the end of the input. A counted
+     * repetition stops no later than '*' would.
+     */
+    temp = *a;
+    if ( repeated ) poly_add(a, b);
+    poly_add_scaled(b, &temp);
+    
+    return SUBREG_RESULT_INTERNAL_MATCH;
+}
+
+
+static int analyze_concatenation(analysis_t* an, poly_t* a, poly_t* b)
+{
+    poly_t elem_a;
+    poly_t elem_b;
+    
+    poly_zero(a);
+    poly_zero(b);
+    
+    do
+    {
+        int result;
+        
+        if ( an->regex[0] == ')' ) break;
+        
+        result = analyze_repetition(an, &elem_a, &elem_b);
+        if ( is_bad_result(result) ) return result;
+        
+        poly_max(a, &elem_a);
+        poly_add(b, &elem_b);
+    
+    } while ( !is_block_boundary(an->regex[0]) );
+    
+    return SUBREG_RESULT_INTERNAL_MATCH;
+}
+
+
+static int analyze_alternation(analysis_t* an, poly_t* a, poly_t* b)
+{
+    const char* regex_begin;
+    poly_t branch_a;
+    poly_t branch_b;
+    unsigned long skip;
+    int result;
+    
+    regex_begin = an->regex;
+    skip = 1;
+    
+    poly_zero(a);
+    poly_zero(b);
+    
+    for (;;)
+    {
+        result = analyze_concatenation(an, &branch_a, &branch_b);
+        if ( is_bad_result(result) ) return result;
+        
+        poly_max(a, &branch_a);
+        poly_add(b, &branch_b);
+        skip++;
+        
+        if ( an->regex[0] != '|' ) break;
+        
+        /* a failing branch may scan the rest of the input first */
+        poly_add_scaled(b, &branch_a);
+        an->regex++;
+    }
+    
+    /* skipping over untried branches costs a step per regex character */
+    b->terms[0] = saturating_add(b->terms[0],
+            skip + (unsigned long) (an->regex - regex_begin));
+    
+    return SUBREG_RESULT_INTERNAL_MATCH;
+}
+
+
+int subreg_analyze(const char* regex, unsigned int max_depth,
+        subreg_cost_t* cost)
+{
+    analysis_t an;
+    poly_t a;
+    poly_t b;
+    unsigned int i;
+    int result;
+    
+    if ( !regex || !cost ) return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    an.regex = regex;
+    an.max_depth = (int) max_depth;
+    an.depth = 0;
+    an.deepest = 0;
+    
+    if ( an.regex[0] == '^' ) an.regex++;
+    
+    result = analyze_alternation(&an, &a, &b);
+    if ( is_bad_result(result) ) return result;
+    
+    if ( an.regex[0] == '$' ) an.regex++;
+    if ( !is_end(an.regex[0]) ) return SUBREG_RESULT_ILLEGAL_EXPRESSION;
+    
+    poly_add_scaled(&b, &a);
+    
+    cost->depth = (unsigned int) an.deepest;
+    cost->degree = 0;
+    
+    for (i = 0; i < SUBREG_COST_NUM_TERMS; i++)
+    {
+        cost->coefficients[i] = b.terms[i];
+        if ( b.terms[i] ) cost->degree = i;
+    }
+    
+    return SUBREG_RESULT_NO_MATCH;
+}
+
+
+unsigned long subreg_cost_steps(const subreg_cost_t* cost,
+        unsigned long input_length)
+{
+    unsigned long n;
+    unsigned long steps;
+    unsigned int i;
+    
+    n = saturating_add(input_length, 1);
+    steps = 0;
+    
+    /* Horner's method, saturating on overflow */
+    for (i = SUBREG_COST_NUM_TERMS; i-- > 0; )
+    {
+        if ( steps > ~0UL / n ) return ~0UL;
+        steps = saturating_add(steps * n, cost->coefficients[i]);
+    }
+    
+    return steps;
+}
+
+
+/*
+ * Pattern image layout. All fields are 32-bit little-endian and all
+ * references are byte offsets from the start of the image.
+ * 
+ *    0  magic "SRIM"
+ *    4  format version
+ *    8  total image size
+ *   12  CRC-32 of bytes 16 to end of image
+ *   16  number of regular expressions
+ *   20  table of (regex offset, group depth) pairs
+ *  ...  null-terminated regular expressions
+ */
+#define IMAGE_HEADER_SIZE                   20
+#define IMAGE_ENTRY_SIZE                    8
+
+
+static unsigned long get_u32(const unsigned char* p)
+{
+    return (unsigned long) p[0] | ((unsigned long) p[1] << 8) |
+            ((unsigned long) p[2] << 16) | ((unsigned long) p[3] << 24);
+}
+
+
+static void put_u32(unsigned char* p, unsigned long value)
+{
+    p[0] = (unsigned char) value;
+    p[1] = (unsigned char) (value >> 8);
+    p[2] = (unsigned char) (value >> 16);
+    p[3] = (unsigned char) (value >> 24);
+}
+
+
+static unsigned long crc32(const unsigned char* data, unsigned long length)
+{
+    unsigned long crc;
+    int bit;
+    
+    crc = 0xFFFFFFFFUL;
+    
+    while ( length-- )
+    {
+        crc ^= *data++;
+        
+        for (bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1)));
+    }
+    
+    return crc ^ 0xFFFFFFFFUL;
+}
+
+
+static unsigned long string_length(const char* str)
+{
+    unsigned long length;
+    
+    for (length = 0; !is_end(str[length]); length++) {}
+    
+    return length;
+}
+
+
+unsigned long subreg_image_size(const char* const regexes[],
+        unsigned int count)
+{
+    unsigned long size;
+    unsigned int i;
+    
+    size = IMAGE_HEADER_SIZE + (unsigned long) count * IMAGE_ENTRY_SIZE;
+    
+    for (i = 0; i < count; i++) size += string_length(regexes[i]) + 1;
+    
+    return size;
+}
+
+
+int subreg_image_build(void* image, unsigned long size,
+        const char* const regexes[], unsigned int count,
+        unsigned int max_depth)
+{
+    unsigned char* p;
+    unsigned long offset;
+    unsigned long length;
+    unsigned long j;
+    subreg_cost_t cost;
+    unsigned int i;
+    int result;
+    
+    if ( !image || (count > 0 && !regexes) ||
+            size < subreg_image_size(regexes, count) )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    p = (unsigned char*) image;
+    offset = IMAGE_HEADER_SIZE + (unsigned long) count * IMAGE_ENTRY_SIZE;
+    
+    for (i = 0; i < count; i++)
+    {
+        result = subreg_analyze(regexes[i], max_depth, &cost);
+        if ( is_bad_result(result) ) return result;
+        
+        put_u32(&p[IMAGE_HEADER_SIZE + i * IMAGE_ENTRY_SIZE], offset);
+        put_u32(&p[IMAGE_HEADER_SIZE + i * IMAGE_ENTRY_SIZE + 4], cost.depth);
+        
+        length = string_length(regexes[i]) + 1;
+        
+        for (j = 0; j < length; j++)
+            p[offset++] = (unsigned char) regexes[i][j];
+    }
+    
+    p[0] = 'S';
+    p[1] = 'R';
+    p[2] = 'I';
+    p[3] = 'M';
+    put_u32(&p[4], SUBREG_IMAGE_VERSION);
+    put_u32(&p[8], offset);
+    put_u32(&p[16], count);
+    put_u32(&p[12], crc32(&p[16], offset - 16));
+    
+    return SUBREG_RESULT_NO_MATCH;
+}
+
+
+int subreg_image_check(const void* image, unsigned long size)
+{
+    const unsigned char* p;
+    unsigned long image_size;
+    unsigned long count;
+    unsigned long offset;
+    unsigned long i;
+    
+    p = (const unsigned char*) image;
+    
+    if ( !p || size < IMAGE_HEADER_SIZE ) return SUBREG_RESULT_INVALID_IMAGE;
+    
+    if ( p[0] != 'S' || p[1] != 'R' || p[2] != 'I' || p[3] != 'M' ||
+            get_u32(&p[4]) != SUBREG_IMAGE_VERSION )
+        return SUBREG_RESULT_INVALID_IMAGE;
+    
+    image_size = get_u32(&p[8]);
+    count = get_u32(&p[16]);
+    
+    /* the size is checked before anything is computed from it */
+    if ( image_size < IMAGE_HEADER_SIZE || image_size > size ||
+            count > (image_size - IMAGE_HEADER_SIZE) /
+            IMAGE_ENTRY_SIZE || count > 0x7FFF )
+        return SUBREG_RESULT_INVALID_IMAGE;
+    
+    if ( crc32(&p[16], image_size - 16) != get_u32(&p[12]) )
+        return SUBREG_RESULT_INVALID_IMAGE;
+    
+    /* every regex must be null-terminated within the image */
+    for (i = 0; i < count; i++)
+    {
+        offset = get_u32(&p[IMAGE_HEADER_SIZE + i * IMAGE_ENTRY_SIZE]);
+        
+        if ( offset < IMAGE_HEADER_SIZE + count * IMAGE_ENTRY_SIZE )
+            return SUBREG_RESULT_INVALID_IMAGE;
+        
+        while ( offset < image_size && p[offset] ) offset++;
+        
+        if ( offset >= image_size ) return SUBREG_RESULT_INVALID_IMAGE;
+    }
+    
+    return (int) count;
+}
+
+
+const char* subreg_image_regex(const void* image, unsigned int index,
+        unsigned int* max_depth)
+{
+    const unsigned char* p;
+    const unsigned char* entry;
+    
+    p = (const unsigned char*) image;
+    
+    if ( !p || index >= get_u32(&p[16]) ) return 0;
+    
+    entry = &p[IMAGE_HEADER_SIZE + (unsigned long) index * IMAGE_ENTRY_SIZE];
+    
+    if ( max_depth ) *max_depth = (unsigned int) get_u32(&entry[4]);
+    
+    return (const char*) &p[get_u32(entry)];
+}
+
+
+int subreg_image_match(const void* image, unsigned int index,
+        const char* input, subreg_capture_t captures[],
+        unsigned int max_captures)
+{
+    const char* regex;
+    unsigned int max_depth;
+    
+    regex = subreg_image_regex(image, index, &max_depth);
+    if ( !regex ) return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    return subreg_match(regex, input, captures, max_captures, max_depth);
+}
+
+
+static int is_plain_char(char c)
+{
+    const char* special;
+    
+    for (special = "()|.\\$*+?^{"; *special; special++)
+        if ( c == *special ) return 0;
+    
+    return !is_end(c);
+}
+
+
+static char fold_char(char c)
+{
+    return (c >= 'a' && c <= 'z') ? (char) (c - 'a' + 'A') : c;
+}
+
+
+/*
+ * Returns the character that every match of regex must start with, or '\0'
+ * if there is none that can be found cheaply. The regex must start with a
+ * plain character that is not optional and have no top-level alternatives.
+ */
+static char required_first_char(const char* regex)
+{
+    char first;
+    int depth;
+    
+    first = regex[0];
+    
+    if ( !is_plain_char(first) || regex[1] == '?' || regex[1] == '*' ||
+            (regex[1] == '{' && is_count(&regex[1])) )
+        return '\0';
+    
+    for (depth = 0; !is_end(regex[0]); regex++)
+    {
+        if ( regex[0] == '\\' )
+        {
+            if ( is_end(regex[1]) ) break;
+            regex++;
+            
+            /* the operand of \! is a character, even if it is '(' */
+            if ( regex[0] == '!' && !is_end(regex[1]) )
+            {
+                regex++;
+                if ( regex[0] == '\\' && !is_end(regex[1]) ) regex++;
+            }
+        }
+        else if ( regex[0] == '(' ) depth++;
+        else if ( regex[0] == ')' ) depth--;
+        else if ( regex[0] == '|' && depth == 0 ) return '\0';
+    }
+    
+    return first;
+}
+
+
+static int search(state_t* state, const char* regex, const char* input,
+        subreg_capture_t captures[], unsigned int max_captures,
+        unsigned int max_depth)
+{
+    const char* start;
+    char first;
+    int result;
+    
+    if ( !regex || !input ) return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    first = required_first_char(regex);
+    
+    /*
+     * An attempt at an offset that does not start with first fails on the
+     * first atom and then takes the same path through the regex as an
+     * attempt at the end of the input does, so that one attempt can stand
+     * in for all of them.
+     */
+    if ( !is_end(first) )
+    {
+        result = match(state, regex, "", 0, captures, max_captures,
+                max_depth, 1);
+        if ( is_bad_result(result) ) return result;
+    }
+    
+    for (start = input;; start++)
+    {
+        if ( !is_end(first) )
+        {
+            while ( !is_end(start[0]) && start[0] != first ) start++;
+            if ( is_end(start[0]) ) break;
+        }
+    
+        result = match(state, regex, start, 0, captures, max_captures,
+                max_depth, 1);
+        if ( result != SUBREG_RESULT_NO_MATCH ) return result;
+    
+        if ( regex[0] == '^' || is_end(start[0]) ) break;
+    }
+    
+    return SUBREG_RESULT_NO_MATCH;
+}
+
+
+int subreg_search(const char* regex, const char* input,
+        subreg_capture_t captures[], unsigned int max_captures,
+        unsigned int max_depth)
+{
+    state_t state;
+    
+    return search(&state, regex, input, captures, max_captures, max_depth);
+}
+
+
+/*
+ * Aho-Corasick automaton layout in a searcher's arena. States are numbered
+ * in breadth-first order, so the children of each state are contiguous,
+ * sorted by byte and immediately follow those of the state before it:
+ *
+ *   literal bytes      decoded (and folded) literals, end to end
+ *   literal offsets    start of each literal in literal bytes, plus the end
+ *   sorted             literals that can match, in lexicographic order
+ *   first child        first child of each state, plus the number of states
+ *   edge bytes         byte on the edge into each state
+ *   fail               failure link of each state
+ *   output             first literal that ends at each state
+ *   dict               next state along the failure links with an output
+ *   depth              length of the string each state stands for
+ */
+#define AC_NONE                             ((unsigned int) -1)
+
+
+static unsigned long align_size(unsigned long size)
+{
+    return (size + sizeof(unsigned long) - 1) / sizeof(unsigned long) *
+            sizeof(unsigned long);
+}
+
+
+/*
+ * Skips a leading "(?i)" or "(?I)", which the searcher's engines take to
+ * apply to the whole regex.
+ */
+static const char* skip_case_option(const char* regex, int* nocase)
+{
+    *nocase = 0;
+    
+    if ( regex[0] == '(' && regex[1] == '?' && (regex[2] == 'i' ||
+            regex[2] == 'I') && regex[3] == ')' )
+    {
+        *nocase = (regex[2] == 'i');
+        regex += 4;
+    }
+    
+    return regex;
+}
+
+
+/*
+ * Scans regex as an alternation of non-empty plain literals, optionally
+ * preceded by "(?i)" or "(?I)". If bytes is not NULL, the decoded literals
+ * are written to it end to end and their offsets to offsets.
+ * 
+ * Returns the number of literals, or <0 if regex is not such an
+ * alternation.
+ */
+static int scan_literals(const char* regex, unsigned char* bytes,
+        unsigned int* offsets, unsigned long* total, int* nocase)
+{
+    state_t state;
+    unsigned long length;
+    unsigned long start;
+    unsigned int count;
+    int result;
+    char c;
+    
+    state.regex = skip_case_option(regex, nocase);
+    length = 0;
+    
+    for (count = 0;; count++)
+    {
+        if ( offsets ) offsets[count] = length;
+    
+        for (start = length;; length++)
+        {
+            c = state.regex[0];
+            if ( is_end(c) || c == '|' ) break;
+    
+            state.regex++;
+    
+            if ( c == '\\' )
+            {
+                result = decode_non_class_metacharacter(&state, &c);
+                if ( is_bad_result(result) ) return result;
+            }
+            else if ( !is_plain_char(c) )
+            {
+                return SUBREG_RESULT_ILLEGAL_EXPRESSION;
+            }
+    
+            if ( bytes ) bytes[length] = (unsigned char) (*nocase ?
+                    fold_char(c) : c);
+        }
+    
+        if ( length == start ) return SUBREG_RESULT_ILLEGAL_EXPRESSION;
+    
+        if ( is_end(state.regex[0]) ) break;
+        state.regex++;
+    }
+    
+    count++;
+    
+    if ( offsets ) offsets[count] = length;
+    *total = length;
+    
+    return (int) count;
+}
+
+
+static unsigned long ac_arena_size(unsigned int count, unsigned long total)
+{
+    unsigned long num_states;
+    
+    num_states = total + 1;
+    
+    return align_size(total) +
+            align_size((count + 1) * sizeof(unsigned int)) +
+            align_size(count * sizeof(unsigned int)) +
+            align_size((num_states + 1) * sizeof(unsigned int)) +
+            align_size(num_states) +
+            4 * align_size(num_states * sizeof(unsigned int));
+}
+
+
+static int compare_literals(const unsigned char* bytes,
+        const unsigned int* offsets, unsigned int a, unsigned int b)
+{
+    unsigned int length_a;
+    unsigned int length_b;
+    unsigned int i;
+    
+    length_a = offsets[a + 1] - offsets[a];
+    length_b = offsets[b + 1] - offsets[b];
+    
+    for (i = 0; i < length_a && i < length_b; i++)
+    {
+        if ( bytes[offsets[a] + i] != bytes[offsets[b] + i] )
+            return (bytes[offsets[a] + i] < bytes[offsets[b] + i]) ? -1 : 1;
+    }
+    
+    return (length_a < length_b) ? -1 : (length_a > length_b);
+}
+
+
+static void sift_down(unsigned int* heap, unsigned int root,
+        unsigned int count, const unsigned char* bytes,
+        const unsigned int* offsets)
+{
+    for (;;)
+    {
+        unsigned int child;
+        unsigned int temp;
+    
+        child = 2 * root + 1;
+        if ( child >= count ) break;
+    
+        if ( child + 1 < count && compare_literals(bytes, offsets,
+                heap[child], heap[child + 1]) < 0 )
+            child++;
+    
+        if ( compare_literals(bytes, offsets, heap[root], heap[child]) >= 0 )
+            break;
+    
+        temp = heap[root];
+        heap[root] = heap[child];
+        heap[child] = temp;
+    
+        root = child;
+    }
+}
+
+
+/* heapsort, as it needs no memory beyond the array being sorted */
+static void sort_literals(unsigned int* sorted, unsigned int count,
+        const unsigned char* bytes, const unsigned int* offsets)
+{
+    unsigned int temp;
+    unsigned int i;
+    
+    for (i = count / 2; i > 0; i--)
+        sift_down(sorted, i - 1, count, bytes, offsets);
+    
+    for (i = count; i > 1; i--)
+    {
+        temp = sorted[0];
+        sorted[0] = sorted[i - 1];
+        sorted[i - 1] = temp;
+    
+        sift_down(sorted, 0, i - 1, bytes, offsets);
+    }
+}
+
+
+static unsigned int ac_goto(const subreg_searcher_t* searcher,
+        unsigned int state, unsigned char c)
+{
+    unsigned int low;
+    unsigned int high;
+    
+    low = searcher->first_child[state];
+    high = searcher->first_child[state + 1];
+    
+    while ( low < high )
+    {
+        unsigned int mid;
+    
+        mid = low + (high - low) / 2;
+    
+        if ( searcher->edge_bytes[mid] == c ) return mid;
+        else if ( searcher->edge_bytes[mid] < c ) low = mid + 1;
+        else high = mid;
+    }
+    
+    return AC_NONE;
+}
+
+
+static void *carve(unsigned char** arena, unsigned long size)
+{
+    void* p;
+    
+    p = *arena;
+    *arena += align_size(size);
+    
+    return p;
+}
+
+
+static void build_automaton(subreg_searcher_t* searcher, const char* regex,
+        unsigned char* arena, unsigned int count, unsigned long total)
+{
+    unsigned char* bytes;
+    unsigned int* offsets;
+    unsigned int* sorted;
+    unsigned int* lows;
+    unsigned int* highs;
+    unsigned int num_sorted;
+    unsigned int num_states;
+    unsigned int state;
+    unsigned int i;
+    unsigned int j;
+    int nocase;
+    
+    bytes = carve(&arena, total);
+    offsets = carve(&arena, (count + 1) * sizeof(unsigned int));
+    sorted = carve(&arena, count * sizeof(unsigned int));
+    searcher->first_child = carve(&arena, (total + 2) * sizeof(unsigned int));
+    searcher->edge_bytes = carve(&arena, total + 1);
+    searcher->fail = carve(&arena, (total + 1) * sizeof(unsigned int));
+    searcher->output = carve(&arena, (total + 1) * sizeof(unsigned int));
+    searcher->dict = carve(&arena, (total + 1) * sizeof(unsigned int));
+    searcher->depth = carve(&arena, (total + 1) * sizeof(unsigned int));
+    
+    scan_literals(regex, bytes, offsets, &total, &nocase);
+    
+    searcher->nocase = nocase;
+    searcher->max_length = 0;
+    
+    /* literals containing a null character can never match */
+    for (i = 0, num_sorted = 0; i < count; i++)
+    {
+        for (j = offsets[i]; j < offsets[i + 1] && bytes[j]; j++) {}
+        if ( j == offsets[i + 1] ) sorted[num_sorted++] = i;
+    
+        if ( offsets[i + 1] - offsets[i] > searcher->max_length )
+            searcher->max_length = offsets[i + 1] - offsets[i];
+    }
+    
+    sort_literals(sorted, num_sorted, bytes, offsets);
+    
+    /*
+     * Each state stands for the prefix shared by a run of sorted literals,
+     * held in fail and dict until the failure links are worked out.
+     */
+    lows = searcher->fail;
+    highs = searcher->dict;
+    
+    lows[0] = 0;
+    highs[0] = num_sorted;
+    searcher->depth[0] = 0;
+    searcher->output[0] = AC_NONE;
+    num_states = 1;
+    
+    for (state = 0; state < num_states; state++)
+    {
+        unsigned int depth;
+    
+        depth = searcher->depth[state];
+        searcher->first_child[state] = num_states;
+    
+        for (i = lows[state]; i < highs[state]; i = j)
+        {
+            unsigned int literal;
+            unsigned char c;
+    
+            literal = sorted[i];
+            j = i + 1;
+    
+            if ( offsets[literal + 1] - offsets[literal] == depth )
+            {
+                if ( literal < searcher->output[state] )
+                    searcher->output[state] = literal;
+    
+                continue;
+            }
+    
+            c = bytes[offsets[literal] + depth];
+    
+            while ( j < highs[state] &&
+                    bytes[offsets[sorted[j]] + depth] == c )
+                j++;
+    
+            searcher->edge_bytes[num_states] = c;
+            searcher->depth[num_states] = depth + 1;
+            searcher->output[num_states] = AC_NONE;
+            lows[num_states] = i;
+            highs[num_states] = j;
+            num_states++;
+        }
+    }
+    
+    searcher->first_child[num_states] = num_states;
+    searcher->num_states = num_states;
+    
+    searcher->fail[0] = 0;
+    searcher->dict[0] = AC_NONE;
+    
+    for (state = 0; state < num_states; state++)
+    {
+        for (i = searcher->first_child[state];
+                i < searcher->first_child[state + 1]; i++)
+        {
+            unsigned int fail;
+            unsigned int next;
+    
+            fail = searcher->fail[state];
+            next = AC_NONE;
+    
+            while ( state > 0 )
+            {
+                next = ac_goto(searcher, fail, searcher->edge_bytes[i]);
+                if ( next != AC_NONE || fail == 0 ) break;
+    
+                fail = searcher->fail[fail];
+            }
+    
+            searcher->fail[i] = (next != AC_NONE) ? next : 0;
+    
+            fail = searcher->fail[i];
+            searcher->dict[i] = (searcher->output[fail] != AC_NONE) ?
+                    fail : searcher->dict[fail];
+        }
+    }
+}
+
+
+static unsigned int ac_next(const subreg_searcher_t* searcher,
+        unsigned int state, char c)
+{
+    unsigned int next;
+    
+    if ( searcher->nocase ) c = fold_char(c);
+    
+    for (;;)
+    {
+        next = ac_goto(searcher, state, (unsigned char) c);
+        if ( next != AC_NONE || state == 0 ) break;
+        
+        state = searcher->fail[state];
+    }
+    
+    return (next != AC_NONE) ? next : 0;
+}
+
+
+/*
+ * Finds the leftmost match and, of the literals matching there, the first
+ * in the alternation, exactly as search() would.
+ */
+static int ac_search(const subreg_searcher_t* searcher, const char* input,
+        subreg_capture_t captures[], unsigned int max_captures)
+{
+    unsigned long position;
+    unsigned long best_start;
+    unsigned int best_length;
+    unsigned int best;
+    unsigned int state;
+    
+    best = AC_NONE;
+    best_start = 0;
+    best_length = 0;
+    state = 0;
+    
+    for (position = 0; !is_end(input[position]); position++)
+    {
+        unsigned int out;
+    
+        /* nothing that ends from here on can start any earlier */
+        if ( best != AC_NONE && position >= best_start + searcher->max_length )
+            break;
+    
+        state = ac_next(searcher, state, input[position]);
+    
+        out = (searcher->output[state] != AC_NONE) ? state :
+                searcher->dict[state];
+    
+        for (; out != AC_NONE; out = searcher->dict[out])
+        {
+            unsigned long start;
+    
+            start = position + 1 - searcher->depth[out];
+    
+            if ( best == AC_NONE || start < best_start ||
+                    (start == best_start && searcher->output[out] < best) )
+            {
+                best = searcher->output[out];
+                best_start = start;
+                best_length = searcher->depth[out];
+            }
+        }
+    }
+    
+    if ( best == AC_NONE ) return SUBREG_RESULT_NO_MATCH;
+    
+    if ( max_captures > 0 )
+    {
+        captures[0].start = input + best_start;
+        captures[0].length = best_length;
+    }
+    
+    return SUBREG_RESULT_INTERNAL_MATCH;
+}
+
+
+/*
+ * Shift-And (bitap) engine. Bit k of the state is set when atom k of the
+ * pattern has just matched, so one word tracks every start at once. A
+ * block of optional atoms a..b is closed over in a single subtraction: with
+ * the bit for b forced on, subtracting the bit for a-1 borrows up to the
+ * lowest state bit in a-1..b, and the bits it flips are exactly the ones
+ * below where the skipped atoms should be filled in from.
+ *
+ * Possessive '?' can reject a path the automaton takes, so the automaton
+ * only proposes match ends and the interpreter confirms the starts that
+ * could reach one. Leading and trailing optional atoms are dropped from
+ * the forward automaton, which only makes it propose more. The starts are
+ * found by running the pattern, less its trailing optional atoms, in
+ * reverse from each proposed end, so the interpreter is only run where a
+ * match could begin.
+ */
+#define BITAP_MAX_ATOMS                     (sizeof(unsigned long) * 8)
+#define BITAP_ARENA_SIZE                    (2 * 256 * sizeof(unsigned long))
+
+
+typedef struct
+{
+    char type;
+    char c;
+    unsigned int min;
+    unsigned int max;
+    unsigned int copies;
+    int optional;
+    
+} atom_t;
+
+
+/*
+ * Reads the next atom of a regex made only of plain characters, escapes and
+ * '.', each optionally followed by '?' or by counted repetition bounds,
+ * which are left in min and max. Returns SUBREG_RESULT_INTERNAL_MATCH,
+ * SUBREG_RESULT_NO_MATCH at the end of regex, or <0 if regex is not made
+ * only of such atoms.
+ */
+static int next_atom(state_t* state, atom_t* atom)
+{
+    int result;
+    char rc;
+    
+    rc = state->regex[0];
+    if ( is_end(rc) ) return SUBREG_RESULT_NO_MATCH;
+    
+    state->regex++;
+    atom->type = rc;
+    atom->c = rc;
+    
+    if ( rc == '\\' )
+    {
+        rc = state->regex[0];
+        
+        switch (rc)
+        {
+        case 'D':
+        case 'H':
+        case 'S':
+        case 'W':
+        case 'd':
+        case 'h':
+        case 's':
+        case 'w':
+            atom->type = rc;
+            state->regex++;
+            break;
+            
+        case '!':
+            atom->type = rc;
+            state->regex++;
+            
+            rc = state->regex[0];
+            if ( is_end(rc) ) return SUBREG_RESULT_INVALID_METACHARACTER;
+            
+            state->regex++;
+            atom->c = rc;
+            
+            if ( rc == '\\' )
+            {
+                result = decode_non_class_metacharacter(state, &atom->c);
+                if ( is_bad_result(result) ) return result;
+            }
+            
+            break;
+            
+        default:
+            atom->type = '\0';
+            
+            result = decode_non_class_metacharacter(state, &atom->c);
+            if ( is_bad_result(result) ) return result;
+        }
+    }
+    else if ( rc == '.' ) atom->type = rc;
+    else if ( is_plain_char(rc) || rc == '{' ) atom->type = '\0';
+    else return SUBREG_RESULT_ILLEGAL_EXPRESSION;
+    
+    atom->min = 1;
+    atom->max = 1;
+    
+    if ( state->regex[0] == '?' )
+    {
+        state->regex++;
+        atom->min = 0;
+    }
+    else if ( state->regex[0] == '{' && is_count(state->regex) )
+    {
+        state->regex++;
+        
+        result = parse_bounds(&state->regex, &atom->min, &atom->max);
+        if ( is_bad_result(result) ) return result;
+    }
+    
+    atom->optional = (atom->min == 0);
+    
+    return SUBREG_RESULT_INTERNAL_MATCH;
+}
+
+
+/*
+ * Reads the atoms of a regex as next_atom() does, but with "x{m,n}" taken
+ * as m copies of x followed by n - m copies of "x?". Possessive repetition
+ * of a single character consumes the same input either way, and the copies
+ * are what the bitap engine and the validator need, each one bit of the
+ * state. Unbounded repetition has no such expansion. atom->copies is the
+ * number of copies of the current atom still to come, and must be 0 before
+ * the first call.
+ */
+static int next_copy(state_t* state, atom_t* atom)
+{
+    int result;
+    
+    while ( atom->copies == 0 )
+    {
+        result = next_atom(state, atom);
+        if ( result != SUBREG_RESULT_INTERNAL_MATCH ) return result;
+        
+        if ( atom->max == REPEAT_UNBOUNDED )
+            return SUBREG_RESULT_ILLEGAL_EXPRESSION;
+        
+        atom->copies = atom->max;
+    }
+    
+    atom->optional = (atom->max - atom->copies >= atom->min);
+    atom->copies--;
+    
+    return SUBREG_RESULT_INTERNAL_MATCH;
+}
+
+
+static int atom_matches(const atom_t* atom, char c, int nocase)
+{
+    switch (atom->type)
+    {
+    case '.':   return 1;
+    case 'D':   return !is_match_result(match_digit(c));
+    case 'H':   return !is_match_result(match_hexadecimal(c));
+    case 'S':   return !is_match_result(match_whitespace(c));
+    case 'W':   return !is_match_result(match_word(c));
+    case 'd':   return is_match_result(match_digit(c));
+    case 'h':   return is_match_result(match_hexadecimal(c));
+    case 's':   return is_match_result(match_whitespace(c));
+    case 'w':   return is_match_result(match_word(c));
+    case '!':   return nocase ? (fold_char(c) != fold_char(atom->c)) :
+                        (c != atom->c);
+    default:    return nocase ? (fold_char(c) == fold_char(atom->c)) :
+                        (c == atom->c);
+    }
+}
+
+
+/*
+ * Scans regex for the bitap engine. If masks is not NULL, the automaton is
+ * built into it and searcher.
+ * 
+ * Returns 0 if regex can be searched for with the bitap engine, or <0 if
+ * it cannot.
+ */
+static int scan_bitap(subreg_searcher_t* searcher, const char* regex,
+        unsigned long* masks)
+{
+    state_t state;
+    atom_t atom;
+    unsigned int count;
+    unsigned int first;
+    unsigned int last;
+    unsigned int i;
+    int nocase;
+    int result;
+    
+    /* find the first and last atoms that must match */
+    state.regex = skip_case_option(regex, &nocase);
+    atom.optional = 0;
+    atom.copies = 0;
+    first = 0;
+    last = 0;
+    
+    for (count = 0;; count++)
+    {
+        result = next_copy(&state, &atom);
+        if ( result == SUBREG_RESULT_NO_MATCH ) break;
+        if ( is_bad_result(result) ) return result;
+        
+        if ( !atom.optional )
+        {
+            if ( last == 0 ) first = count;
+            last = count + 1;
+        }
+    }
+    
+    if ( last == 0 || count > BITAP_MAX_ATOMS )
+        return SUBREG_RESULT_ILLEGAL_EXPRESSION;
+    
+    if ( !masks ) return 0;
+    
+    for (i = 0; i < 2 * 256; i++) masks[i] = 0;
+    
+    searcher->nocase = nocase;
+    searcher->max_length = count;
+    searcher->masks = masks;
+    searcher->bitap_accept = 1UL << (last - first - 1);
+    searcher->bitap_optional = 0;
+    searcher->bitap_initial = 0;
+    searcher->bitap_final = 0;
+    searcher->reverse_masks = masks + 256;
+    searcher->reverse_accept = 1UL << (last - 1);
+    searcher->reverse_optional = 0;
+    searcher->reverse_initial = 0;
+    searcher->reverse_final = 0;
+    
+    state.regex = skip_case_option(regex, &nocase);
+    atom.optional = 0;
+    atom.copies = 0;
+    
+    for (count = 0; count < last; count++)
+    {
+        unsigned long bit;
+        unsigned long reverse_bit;
+        int previous_optional;
+        
+        previous_optional = atom.optional;
+        next_copy(&state, &atom);
+        
+        bit = (count >= first) ? 1UL << (count - first) : 0;
+        reverse_bit = 1UL << (last - 1 - count);
+        
+        /* null characters end the input rather than match */
+        for (i = 1; i < 256; i++)
+        {
+            if ( atom_matches(&atom, (char) i, nocase) )
+            {
+                masks[i] |= bit;
+                searcher->reverse_masks[i] |= reverse_bit;
+            }
+        }
+        
+        if ( atom.optional )
+        {
+            searcher->bitap_optional |= bit;
+            if ( !previous_optional ) searcher->bitap_initial |= bit >> 1;
+            
+            searcher->reverse_optional |= reverse_bit;
+            if ( count == 0 || !previous_optional )
+                searcher->reverse_final |= reverse_bit;
+        }
+        else if ( previous_optional )
+        {
+            if ( count > first ) searcher->bitap_final |= bit >> 1;
+            searcher->reverse_initial |= reverse_bit;
+        }
+    }
+    
+    return 0;
+}
+
+
+static unsigned long bitap_next(const subreg_searcher_t* searcher,
+        unsigned long d, char c)
+{
+    unsigned long df;
+    
+    d = ((d << 1) | 1) & searcher->masks[(unsigned char) c];
+    
+    df = d | searcher->bitap_final;
+    
+    return d | (searcher->bitap_optional &
+            ~((df - searcher->bitap_initial) ^ df));
+}
+
+
+/*
+ * Runs the reversed automaton back from a match end proposed by the forward
+ * one, over at most limit characters. Returns a mask with bit k set if a
+ * match can start k characters before end. If ring_size is not 0, input is
+ * a ring buffer of that size.
+ */
+static unsigned long bitap_starts(const subreg_searcher_t* searcher,
+        const char* input, unsigned long ring_size, unsigned long end,
+        unsigned long limit)
+{
+    unsigned long starts;
+    unsigned long r;
+    unsigned long rf;
+    unsigned long i;
+    unsigned int k;
+    
+    starts = 0;
+    r = 1;
+    
+    for (k = 0; k < searcher->max_length && k < limit && r; k++)
+    {
+        i = ring_size ? (end - k) % ring_size : end - k;
+        r &= searcher->reverse_masks[(unsigned char) input[i]];
+        
+        rf = r | searcher->reverse_final;
+        r |= searcher->reverse_optional &
+                ~((rf - searcher->reverse_initial) ^ rf);
+        
+        if ( r & searcher->reverse_accept ) starts |= 1UL << k;
+        
+        r <<= 1;
+    }
+    
+    return starts;
+}
+
+
+static int bitap_search(const subreg_searcher_t* searcher, state_t* state,
+        const char* input, subreg_capture_t captures[],
+        unsigned int max_captures)
+{
+    subreg_capture_t best;
+    subreg_capture_t capture;
+    unsigned long position;
+    unsigned long tried;
+    unsigned long d;
+    int result;
+    
+    best.start = 0;
+    best.length = 0;
+    tried = 0;
+    d = 0;
+    
+    for (position = 0; !is_end(input[position]); position++)
+    {
+        unsigned long starts;
+        unsigned int k;
+        
+        /* nothing that ends from here on can start any earlier */
+        if ( best.start && position + 1 >= (unsigned long)
+                (best.start - input) + searcher->max_length )
+            break;
+        
+        d = bitap_next(searcher, d, input[position]);
+        
+        /* bit k of tried is set if the start k characters back failed */
+        tried <<= 1;
+        
+        if ( !(d & searcher->bitap_accept) ) continue;
+        
+        starts = bitap_starts(searcher, input, 0, position, position + 1) &
+                ~tried;
+        
+        for (k = searcher->max_length; k-- > 0;)
+        {
+            if ( !(starts & (1UL << k)) ) continue;
+            if ( best.start && input + position - k >= best.start ) break;
+            
+            result = match(state, searcher->regex, input + position - k, 0,
+                    &capture, 1, searcher->max_depth, 1);
+            if ( is_bad_result(result) ) return result;
+            
+            if ( is_match_result(result) )
+            {
+                best = capture;
+                break;
+            }
+            
+            tried |= 1UL << k;
+        }
+    }
+    
+    if ( !best.start ) return SUBREG_RESULT_NO_MATCH;
+    
+    if ( max_captures > 0 ) captures[0] = best;
+    
+    return SUBREG_RESULT_INTERNAL_MATCH;
+}
+
+
+unsigned long subreg_searcher_arena_size(const char* regex)
+{
+    unsigned long total;
+    int count;
+    int nocase;
+    
+    if ( !regex ) return 0;
+    
+    count = scan_literals(regex, 0, 0, &total, &nocase);
+    if ( count > 0 ) return ac_arena_size((unsigned int) count, total);
+    
+    if ( scan_bitap(0, regex, 0) == 0 ) return BITAP_ARENA_SIZE;
+    
+    return 0;
+}
+
+
+int subreg_searcher_init(subreg_searcher_t* searcher, const char* regex,
+        unsigned int max_depth, void* arena, unsigned long arena_size)
+{
+    subreg_cost_t cost;
+    unsigned long total;
+    int count;
+    int nocase;
+    int result;
+    
+    if ( !searcher || !regex ) return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    result = subreg_analyze(regex, max_depth, &cost);
+    if ( is_bad_result(result) ) return result;
+    
+    searcher->regex = regex;
+    searcher->max_depth = max_depth;
+    searcher->engine = SUBREG_ENGINE_INTERPRETER;
+    
+    if ( !arena ) return 0;
+    
+    count = scan_literals(regex, 0, 0, &total, &nocase);
+    
+    if ( count > 0 && arena_size >= ac_arena_size((unsigned int) count,
+            total) )
+    {
+        build_automaton(searcher, regex, (unsigned char*) arena,
+                (unsigned int) count, total);
+        searcher->engine = SUBREG_ENGINE_AHO_CORASICK;
+    }
+    else if ( arena_size >= BITAP_ARENA_SIZE &&
+            scan_bitap(searcher, regex, (unsigned long*) arena) == 0 )
+    {
+        searcher->engine = SUBREG_ENGINE_BITAP;
+    }
+    
+    return 0;
+}
+
+
+int subreg_searcher_search(const subreg_searcher_t* searcher,
+        const char* input, subreg_capture_t captures[],
+        unsigned int max_captures)
+{
+    state_t state;
+    
+    if ( !searcher || !input || (max_captures > 0 && !captures) )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    if ( searcher->engine == SUBREG_ENGINE_AHO_CORASICK )
+        return ac_search(searcher, input, captures, max_captures);
+    
+    if ( searcher->engine == SUBREG_ENGINE_BITAP )
+    {
+        return bitap_search(searcher, &state, input, captures,
+                max_captures);
+    }
+    
+    return search(&state, searcher->regex, input, captures, max_captures,
+            searcher->max_depth);
+}
+
+
+int subreg_searcher_literal(const subreg_searcher_t* searcher,
+        const subreg_capture_t* match)
+{
+    unsigned int state;
+    unsigned int i;
+    
+    if ( !searcher || !match || !match->start ||
+            searcher->engine != SUBREG_ENGINE_AHO_CORASICK )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    for (state = 0, i = 0; i < match->length && state != AC_NONE; i++)
+    {
+        char c;
+    
+        c = match->start[i];
+        if ( searcher->nocase ) c = fold_char(c);
+    
+        state = ac_goto(searcher, state, (unsigned char) c);
+    }
+    
+    if ( state == AC_NONE || searcher->output[state] == AC_NONE )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    return (int) searcher->output[state];
+}
+
+
+/*
+ * Streaming search. Matches of the Aho-Corasick and bitap engines are never
+ * longer than the searcher's max_length, so the stream only has to hold
+ * back that many bytes, in a ring buffer:
+ *
+ *   ring               last max_length bytes fed, at their offsets modulo
+ *                      max_length
+ *   scratch            (bitap only) a match candidate, copied out of the
+ *                      ring for the interpreter to confirm
+ *
+ * The Aho-Corasick engine keeps the best match so far until no match that
+ * ends later can start any earlier, reports it, and then rescans from the
+ * end of that match. The bitap engine collects the starts its reversed
+ * automaton proposes and confirms each once every byte a match from it
+ * could use has arrived, in order of start.
+ */
+unsigned long subreg_stream_buffer_size(const subreg_searcher_t* searcher)
+{
+    if ( !searcher ) return 0;
+    
+    if ( searcher->engine == SUBREG_ENGINE_AHO_CORASICK )
+        return searcher->max_length;
+    
+    if ( searcher->engine == SUBREG_ENGINE_BITAP )
+        return 2 * (unsigned long) searcher->max_length;
+    
+    return 0;
+}
+
+
+int subreg_stream_init(subreg_stream_t* stream,
+        const subreg_searcher_t* searcher, void* buffer,
+        unsigned long buffer_size, subreg_stream_callback_t callback,
+        void* context)
+{
+    if ( !stream || !searcher || !buffer || !callback )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    if ( subreg_stream_buffer_size(searcher) == 0 ||
+            buffer_size < subreg_stream_buffer_size(searcher) )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    stream->searcher = searcher;
+    stream->callback = callback;
+    stream->context = context;
+    stream->position = 0;
+    stream->buffer = (char*) buffer;
+    stream->scan = 0;
+    stream->next_start = 0;
+    stream->state = 0;
+    stream->pending = 0;
+    stream->best_length = 0;
+    
+    return 0;
+}
+
+
+static void ac_stream_report(subreg_stream_t* stream)
+{
+    stream->callback(stream->context, stream->best_start,
+            stream->best_length);
+    
+    stream->next_start = stream->best_start + stream->best_length;
+    stream->best_length = 0;
+    stream->state = 0;
+    stream->scan = stream->next_start;
+}
+
+
+static void ac_stream_advance(subreg_stream_t* stream)
+{
+    const subreg_searcher_t* searcher;
+    unsigned long length;
+    
+    searcher = stream->searcher;
+    length = searcher->max_length;
+    
+    while ( stream->scan < stream->position )
+    {
+        unsigned long position;
+        unsigned int out;
+        
+        position = stream->scan++;
+        
+        stream->state = ac_next(searcher, (unsigned int) stream->state,
+                stream->buffer[position % length]);
+        
+        out = (searcher->output[stream->state] != AC_NONE) ?
+                (unsigned int) stream->state :
+                searcher->dict[stream->state];
+        
+        for (; out != AC_NONE; out = searcher->dict[out])
+        {
+            unsigned long start;
+            
+            start = position + 1 - searcher->depth[out];
+            
+            if ( stream->best_length == 0 || start < stream->best_start ||
+                    (start == stream->best_start &&
+                    searcher->output[out] < stream->best_literal) )
+            {
+                stream->best_start = start;
+                stream->best_length = searcher->depth[out];
+                stream->best_literal = searcher->output[out];
+            }
+        }
+        
+        /* nothing that ends from here on can start any earlier */
+        if ( stream->best_length > 0 &&
+                position + 1 >= stream->best_start + length )
+            ac_stream_report(stream);
+    }
+}
+
+
+/*
+ * Confirms a start proposed by the bitap engine with the interpreter, using
+ * the bytes fed so far. Reports and returns nonzero if there is a match.
+ */
+static int bitap_stream_confirm(subreg_stream_t* stream, unsigned long start)
+{
+    const subreg_searcher_t* searcher;
+    subreg_capture_t capture;
+    state_t state;
+    unsigned long length;
+    unsigned long end;
+    unsigned long i;
+    char* scratch;
+    
+    searcher = stream->searcher;
+    length = searcher->max_length;
+    scratch = stream->buffer + length;
+    
+    end = (stream->position - start < length) ? stream->position :
+            start + length;
+    
+    for (i = start; i < end; i++) scratch[i - start] = stream->buffer[i % length];
+    
+    if ( !is_match_result(match(&state, searcher->regex, scratch,
+            scratch + (end - start), &capture, 1, searcher->max_depth, 1)) )
+        return 0;
+    
+    stream->callback(stream->context, start, capture.length);
+    stream->next_start = start + capture.length;
+    
+    return 1;
+}
+
+
+static void bitap_stream_advance(subreg_stream_t* stream)
+{
+    const subreg_searcher_t* searcher;
+    unsigned long length;
+    unsigned long oldest;
+    
+    searcher = stream->searcher;
+    length = searcher->max_length;
+    oldest = 1UL << (length - 1);
+    
+    while ( stream->scan < stream->position )
+    {
+        unsigned long position;
+        
+        position = stream->scan++;
+        
+        stream->state = bitap_next(searcher, stream->state,
+                stream->buffer[position % length]);
+        
+        /* bit k of pending is set if a match could start k bytes back */
+        stream->pending <<= 1;
+        
+        if ( stream->state & searcher->bitap_accept )
+        {
+            stream->pending |= bitap_starts(searcher, stream->buffer, length,
+                    position, position + 1 - stream->next_start);
+        }
+        
+        /* every start that could reach this byte has now been proposed */
+        if ( stream->pending & oldest )
+        {
+            stream->pending &= ~oldest;
+            
+            if ( bitap_stream_confirm(stream, position + 1 - length) )
+            {
+                stream->pending &= (1UL << (position + 1 -
+                        stream->next_start)) - 1;
+            }
+        }
+    }
+}
+
+
+int subreg_stream_feed(subreg_stream_t* stream, const char* data,
+        unsigned long length)
+{
+    unsigned long ring_size;
+    unsigned long i;
+    
+    if ( !stream || (length > 0 && !data) )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    ring_size = stream->searcher->max_length;
+    
+    for (i = 0; i < length; i++)
+    {
+        stream->buffer[stream->position % ring_size] = data[i];
+        stream->position++;
+        
+        if ( stream->searcher->engine == SUBREG_ENGINE_AHO_CORASICK )
+            ac_stream_advance(stream);
+        else bitap_stream_advance(stream);
+    }
+    
+    return 0;
+}
+
+
+int subreg_stream_finish(subreg_stream_t* stream)
+{
+    if ( !stream ) return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    if ( stream->searcher->engine == SUBREG_ENGINE_AHO_CORASICK )
+    {
+        while ( stream->best_length > 0 )
+        {
+            ac_stream_report(stream);
+            ac_stream_advance(stream);
+        }
+    }
+    else
+    {
+        unsigned long last;
+        unsigned int k;
+        
+        /* the remaining starts can only match the bytes there are */
+        last = stream->position - 1;
+        
+        for (k = stream->searcher->max_length; k-- > 0;)
+        {
+            if ( !(stream->pending & (1UL << k)) ) continue;
+            if ( last - k < stream->next_start ) continue;
+            
+            bitap_stream_confirm(stream, last - k);
+        }
+        
+        stream->pending = 0;
+    }
+    
+    return 0;
+}
+
+
+/*
+ * Push validator. The interpreter's path through a regex made only of
+ * atoms (as for the bitap engine) is decided one character at a time:
+ * optional atoms the character does not match are skipped, and the first
+ * atom left must then match it. The validator's state is the position on
+ * that path, as a single set bit, so each character is one table lookup
+ * and a few bitwise operations whatever the pattern.
+ *
+ * Since nothing backtracks into a group, a group that is not repeated does
+ * not change the path, so if groups is not 0 the brackets of plain and
+ * non-capturing groups are skipped over.
+ */
+static int scan_validator(subreg_validator_t* validator, const char* regex,
+        unsigned long* masks, int groups)
+{
+    state_t state;
+    atom_t atom;
+    unsigned int count;
+    unsigned int i;
+    int nocase;
+    int result;
+    char rc;
+    
+    if ( regex[0] == '^' ) regex++;
+    
+    state.regex = skip_case_option(regex, &nocase);
+    atom.copies = 0;
+    
+    if ( masks )
+    {
+        for (i = 0; i < 256; i++) masks[i] = 0;
+        
+        validator->masks = masks;
+        validator->mandatory = 0;
+        validator->dead = 0;
+    }
+    
+    for (count = 0;; count++)
+    {
+        unsigned long bit;
+        int matchable;
+        
+        while ( groups && atom.copies == 0 &&
+                (state.regex[0] == '(' || state.regex[0] == ')') )
+        {
+            if ( state.regex[0] == ')' )
+            {
+                rc = state.regex[1];
+                if ( rc == '?' || rc == '*' || rc == '+' ||
+                        (rc == '{' && is_count(&state.regex[1])) )
+                    return SUBREG_RESULT_ILLEGAL_EXPRESSION;
+            }
+            else if ( state.regex[1] == '?' )
+            {
+                if ( state.regex[2] != ':' )
+                    return SUBREG_RESULT_ILLEGAL_EXPRESSION;
+                
+                state.regex += 2;
+            }
+            
+            state.regex++;
+        }
+        
+        if ( count > 0 && atom.copies == 0 && state.regex[0] == '$' &&
+                is_end(state.regex[1]) )
+            break;
+        
+        result = next_copy(&state, &atom);
+        if ( result == SUBREG_RESULT_NO_MATCH ) break;
+        if ( is_bad_result(result) ) return result;
+        
+        /* the bit after the last atom marks the end of the path */
+        if ( count + 1 >= BITAP_MAX_ATOMS )
+            return SUBREG_RESULT_ILLEGAL_EXPRESSION;
+        
+        if ( !masks ) continue;
+        
+        bit = 1UL << count;
+        matchable = 0;
+        
+        for (i = 1; i < 256; i++)
+        {
+            if ( atom_matches(&atom, (char) i, nocase) )
+            {
+                masks[i] |= bit;
+                matchable = 1;
+            }
+        }
+        
+        if ( !atom.optional )
+        {
+            validator->mandatory |= bit;
+            if ( !matchable ) validator->dead |= bit;
+        }
+    }
+    
+    return 0;
+}
+
+
+unsigned long subreg_validator_arena_size(const char* regex)
+{
+    if ( !regex || scan_validator(0, regex, 0, 0) != 0 ) return 0;
+    
+    return 256 * sizeof(unsigned long);
+}
+
+
+int subreg_validator_init(subreg_validator_t* validator, const char* regex,
+        void* arena, unsigned long arena_size)
+{
+    int result;
+    
+    if ( !validator || !regex || !arena ) return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    result = scan_validator(0, regex, 0, 0);
+    if ( is_bad_result(result) ) return result;
+    
+    if ( arena_size < 256 * sizeof(unsigned long) )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    scan_validator(validator, regex, (unsigned long*) arena, 0);
+    subreg_validator_reset(validator);
+    
+    return 0;
+}
+
+
+void subreg_validator_reset(subreg_validator_t* validator)
+{
+    validator->state = 1;
+}
+
+
+int subreg_validator_push(subreg_validator_t* validator, char c)
+{
+    unsigned long m;
+    unsigned long candidates;
+    
+    m = validator->masks[(unsigned char) c];
+    
+    /* the first atom from here on that either matches c or must match */
+    candidates = (m | validator->mandatory) & ~(validator->state - 1);
+    candidates &= ~candidates + 1;
+    
+    validator->state = (candidates & m) << 1;
+    
+    return validator->state != 0 &&
+            (validator->dead & ~(validator->state - 1)) == 0;
+}
+
+
+int subreg_validator_accepts(const subreg_validator_t* validator)
+{
+    return validator->state != 0 &&
+            (validator->mandatory & ~(validator->state - 1)) == 0;
+}
+
+
+/*
+ * Tracker. The validator's state after a character depends only on its
+ * state before it and the character, so once the state at the end of a span
+ * after an edit is the same as it was before the edit, it is the same at
+ * the end of every later span too. The input is divided into spans, every
+ * one but the last at least span_size long, and each span's checkpoint
+ * holds the state at its end. An edit replaces the spans it touches with
+ * new ones scanned from the state before them, then rescans the spans after
+ * them until the state converges with the old one.
+ */
+static unsigned long count_spans(unsigned long span_size,
+        unsigned long length)
+{
+    /* the last span takes what is left over */
+    if ( length > 0 && length < span_size ) return 1;
+    
+    return length / span_size;
+}
+
+
+static unsigned long scan_span(const subreg_validator_t* validator,
+        unsigned long state, const char* input, unsigned long length)
+{
+    subreg_validator_t copy;
+    
+    copy = *validator;
+    copy.state = state;
+    
+    /* no character can take the validator out of the state 0 */
+    for (; length > 0 && copy.state != 0; length--)
+        subreg_validator_push(&copy, *input++);
+    
+    return copy.state;
+}
+
+
+/*
+ * Scans length characters of input from start into count spans, writing
+ * their checkpoints from index on, and returns the state after them.
+ */
+static unsigned long scan_spans(subreg_tracker_t* tracker, const char* input,
+        unsigned long start, unsigned long length, unsigned long index,
+        unsigned long count, unsigned long state)
+{
+    for (; count > 0; count--, index++)
+    {
+        subreg_checkpoint_t* checkpoint;
+        
+        checkpoint = &tracker->checkpoints[index];
+        checkpoint->length = (count > 1) ? tracker->span_size : length;
+        checkpoint->state = scan_span(tracker->validator, state,
+                &input[start], checkpoint->length);
+        
+        state = checkpoint->state;
+        start += checkpoint->length;
+        length -= checkpoint->length;
+    }
+    
+    return state;
+}
+
+
+int subreg_tracker_init(subreg_tracker_t* tracker,
+        const subreg_validator_t* validator, subreg_checkpoint_t checkpoints[],
+        unsigned long max_checkpoints, unsigned long span_size,
+        const char* input, unsigned long length)
+{
+    unsigned long count;
+    
+    if ( !tracker || !validator || !checkpoints || span_size == 0 ||
+            (length > 0 && !input) )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    count = count_spans(span_size, length);
+    if ( count > max_checkpoints ) return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    tracker->validator = validator;
+    tracker->length = length;
+    tracker->checkpoints = checkpoints;
+    tracker->max_checkpoints = max_checkpoints;
+    tracker->num_checkpoints = count;
+    tracker->span_size = span_size;
+    
+    scan_spans(tracker, input, 0, length, 0, count, 1);
+    
+    return 0;
+}
+
+
+int subreg_tracker_edit(subreg_tracker_t* tracker, const char* input,
+        unsigned long offset, unsigned long removed, unsigned long inserted)
+{
+    subreg_checkpoint_t* checkpoints;
+    unsigned long num_checkpoints;
+    unsigned long first;
+    unsigned long last;
+    unsigned long start;
+    unsigned long end;
+    unsigned long replaced;
+    unsigned long count;
+    unsigned long length;
+    unsigned long state;
+    unsigned long previous;
+    unsigned long i;
+    
+    if ( !tracker || offset > tracker->length ||
+            removed > tracker->length - offset ||
+            (tracker->length - removed + inserted > 0 && !input) )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    checkpoints = tracker->checkpoints;
+    num_checkpoints = tracker->num_checkpoints;
+    first = 0;
+    last = 0;
+    start = 0;
+    end = 0;
+    
+    if ( num_checkpoints > 0 )
+    {
+        /* find the span containing the edit... */
+        while ( first + 1 < num_checkpoints &&
+                start + checkpoints[first].length <= offset )
+        {
+            start += checkpoints[first].length;
+            first++;
+        }
+        
+        /* ...and the span containing its end */
+        last = first;
+        end = start + checkpoints[first].length;
+        
+        while ( last + 1 < num_checkpoints && end < offset + removed )
+        {
+            last++;
+            end += checkpoints[last].length;
+        }
+    }
+    
+    /* only the last span may be shorter than span_size */
+    while ( end - start - removed + inserted < tracker->span_size &&
+            last + 1 < num_checkpoints )
+    {
+        last++;
+        end += checkpoints[last].length;
+    }
+    
+    length = end - start - removed + inserted;
+    replaced = (num_checkpoints > 0) ? last + 1 - first : 0;
+    count = count_spans(tracker->span_size, length);
+    
+    if ( num_checkpoints - replaced + count > tracker->max_checkpoints )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    /* the state where the input after the replaced spans begins */
+    state = (first > 0) ? checkpoints[first - 1].state : 1;
+    previous = (replaced > 0) ? checkpoints[last].state : state;
+    
+    /* move the checkpoints after the edit to follow the new ones */
+    if ( count > replaced )
+    {
+        for (i = num_checkpoints; i-- > first + replaced;)
+            checkpoints[i + count - replaced] = checkpoints[i];
+    }
+    else if ( count < replaced )
+    {
+        for (i = first + replaced; i < num_checkpoints; i++)
+            checkpoints[i + count - replaced] = checkpoints[i];
+    }
+    
+    tracker->num_checkpoints = num_checkpoints - replaced + count;
+    tracker->length = tracker->length - removed + inserted;
+    
+    state = scan_spans(tracker, input, start, length, first, count, state);
+    
+    /* rescan the unchanged input only until the state converges */
+    start += length;
+    
+    for (i = first + count; i < tracker->num_checkpoints &&
+            state != previous; i++)
+    {
+        previous = checkpoints[i].state;
+        state = scan_span(tracker->validator, state, &input[start],
+                checkpoints[i].length);
+        
+        checkpoints[i].state = state;
+        start += checkpoints[i].length;
+    }
+    
+    return 0;
+}
+
+
+int subreg_tracker_accepts(const subreg_tracker_t* tracker)
+{
+    subreg_validator_t copy;
+    
+    copy = *tracker->validator;
+    copy.state = (tracker->num_checkpoints > 0) ?
+            tracker->checkpoints[tracker->num_checkpoints - 1].state : 1;
+    
+    return subreg_validator_accepts(&copy);
+}
+
+
+/*
+ * Matcher. The plan is chosen from the cheapest up: a regex of plain
+ * characters is compared with the input directly, one a validator can run
+ * (ignoring the brackets of groups) goes through a validator, and anything
+ * else is left to the interpreter. When a regex the validator can run has
+ * capturing groups, the validator still decides whether there is a match
+ * and the interpreter is only run to make the captures, unless so few
+ * captures are allowed that the interpreter would report
+ * SUBREG_RESULT_CAPTURE_OVERFLOW, which only it can decide.
+ */
+static unsigned int scan_features(const char* regex, unsigned int* groups)
+{
+    state_t state;
+    atom_t atom;
+    unsigned int features;
+    unsigned int atoms;
+    int nocase;
+    char rc;
+    
+    features = 0;
+    atoms = 0;
+    *groups = 0;
+    
+    if ( regex[0] == '^' ) regex++;
+    state.regex = skip_case_option(regex, &nocase);
+    
+    while ( !is_end(state.regex[0]) )
+    {
+        rc = state.regex[0];
+    
+        switch (rc)
+        {
+        case '(':
+            if ( state.regex[1] != '?' )
+            {
+                features |= SUBREG_FEATURE_CAPTURES;
+                (*groups)++;
+            }
+            else if ( state.regex[2] == '=' || state.regex[2] == '!' )
+            {
+                features |= SUBREG_FEATURE_LOOK_AHEAD;
+                state.regex += 2;
+            }
+            else if ( state.regex[2] == ':' ) state.regex += 2;
+            else features |= SUBREG_FEATURE_OPTION;
+            
+            break;
+    
+        case ')':
+            rc = state.regex[1];
+            if ( rc == '?' || rc == '*' || rc == '+' )
+                features |= SUBREG_FEATURE_REPETITION;
+            
+            /* any other '{' is read as an atom */
+            if ( rc == '{' && is_count(&state.regex[1]) )
+            {
+                features |= SUBREG_FEATURE_REPETITION;
+                while ( state.regex[0] != '}' ) state.regex++;
+            }
+            
+            break;
+    
+        case '|':
+            features |= SUBREG_FEATURE_ALTERNATION;
+            break;
+    
+        case '*':
+        case '+':
+            features |= SUBREG_FEATURE_REPETITION;
+            break;
+    
+        case '^':
+            features |= SUBREG_FEATURE_ANCHOR;
+            break;
+    
+        case '$':
+            if ( !is_end(state.regex[1]) ) features |= SUBREG_FEATURE_ANCHOR;
+            break;
+    
+        case '?':
+            break;
+    
+        default:
+            /* the regex has been validated, so every escape is complete */
+            next_atom(&state, &atom);
+            
+            if ( atom.max == REPEAT_UNBOUNDED )
+            {
+                features |= SUBREG_FEATURE_REPETITION;
+                atoms += atom.min + 1;
+            }
+            else atoms += atom.max;
+            
+            continue;
+        }
+    
+        state.regex++;
+    }
+    
+    /* the validator needs a bit after the last atom */
+    if ( atoms + 1 >= BITAP_MAX_ATOMS ) features |= SUBREG_FEATURE_LONG;
+    
+    return features;
+}
+
+
+static int is_literal(const char* regex)
+{
+    int nocase;
+    
+    for (regex = skip_case_option(regex, &nocase); !is_end(regex[0]); regex++)
+        if ( !is_plain_char(regex[0]) ) return 0;
+    
+    return 1;
+}
+
+
+unsigned long subreg_matcher_arena_size(const char* regex)
+{
+    if ( !regex || is_literal(regex) || scan_validator(0, regex, 0, 1) != 0 )
+        return 0;
+    
+    return 256 * sizeof(unsigned long);
+}
+
+
+int subreg_matcher_init(subreg_matcher_t* matcher, const char* regex,
+        unsigned int max_depth, void* arena, unsigned long arena_size)
+{
+    subreg_cost_t cost;
+    int result;
+    
+    if ( !matcher || !regex ) return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    result = subreg_analyze(regex, max_depth, &cost);
+    if ( is_bad_result(result) ) return result;
+    
+    matcher->regex = regex;
+    matcher->max_depth = max_depth;
+    matcher->depth = cost.depth;
+    matcher->features = scan_features(regex, &matcher->groups);
+    
+    if ( is_literal(regex) )
+    {
+        matcher->plan = SUBREG_PLAN_LITERAL;
+    }
+    else if ( arena && arena_size >= 256 * sizeof(unsigned long) &&
+            scan_validator(0, regex, 0, 1) == 0 )
+    {
+        scan_validator(&matcher->validator, regex, (unsigned long*) arena, 1);
+        
+        matcher->plan = matcher->groups ? SUBREG_PLAN_PREFILTER :
+                SUBREG_PLAN_AUTOMATON;
+    }
+    else matcher->plan = SUBREG_PLAN_INTERPRETER;
+    
+    return 0;
+}
+
+
+static int literal_matches(const char* regex, const char* input,
+        unsigned int* length)
+{
+    unsigned int i;
+    int nocase;
+    
+    regex = skip_case_option(regex, &nocase);
+    
+    for (i = 0; !is_end(regex[i]); i++)
+    {
+        if ( nocase ? fold_char(regex[i]) != fold_char(input[i]) :
+                regex[i] != input[i] )
+            return 0;
+    }
+    
+    *length = i;
+    
+    return is_end(input[i]);
+}
+
+
+int subreg_matcher_match(const subreg_matcher_t* matcher, const char* input,
+        subreg_capture_t captures[], unsigned int max_captures)
+{
+    subreg_validator_t validator;
+    unsigned int length;
+    
+    if ( !matcher || !input || (max_captures > 0 && !captures) )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    if ( matcher->plan == SUBREG_PLAN_LITERAL )
+    {
+        if ( !literal_matches(matcher->regex, input, &length) )
+            return SUBREG_RESULT_NO_MATCH;
+    }
+    else if ( matcher->plan == SUBREG_PLAN_INTERPRETER ||
+            (max_captures > 0 && max_captures <= matcher->groups) )
+    {
+        return subreg_match(matcher->regex, input, captures, max_captures,
+                matcher->max_depth);
+    }
+    else
+    {
+        /* the validator is copied so that matchers can be shared */
+        validator = matcher->validator;
+        subreg_validator_reset(&validator);
+        
+        for (length = 0; !is_end(input[length]); length++)
+        {
+            if ( !subreg_validator_push(&validator, input[length]) )
+                return SUBREG_RESULT_NO_MATCH;
+        }
+        
+        if ( !subreg_validator_accepts(&validator) )
+            return SUBREG_RESULT_NO_MATCH;
+        
+        if ( matcher->plan == SUBREG_PLAN_PREFILTER && max_captures > 0 )
+        {
+            return subreg_match(matcher->regex, input, captures,
+                    max_captures, matcher->max_depth);
+        }
+    }
+    
+    if ( max_captures > 0 )
+    {
+        captures[0].start = input;
+        captures[0].length = length;
+    }
+    
+    return 1;
+}
+
+
+unsigned int subreg_matcher_explain(const subreg_matcher_t* matcher,
+        char* buffer, unsigned int size)
+{
+    static const char* const PLANS[] =
+    {
+        "interpreter", "literal", "automaton", "prefilter"
+    };
+    
+    static const char* const FEATURES[] =
+    {
+        "captures", "alternation", "repetition", "look-ahead", "option",
+        "anchor", "long"
+    };
+    
+    unsigned int features;
+    unsigned int length;
+    unsigned int i;
+    
+    features = matcher->features;
+    
+    /* only what ruled out a cheaper plan is a reason */
+    if ( matcher->plan == SUBREG_PLAN_INTERPRETER )
+        features &= ~SUBREG_FEATURE_CAPTURES;
+    else if ( matcher->plan == SUBREG_PLAN_PREFILTER )
+        features = SUBREG_FEATURE_CAPTURES;
+    else features = 0;
+    
+    length = append_string(buffer, size, 0, "plan=");
+    length = append_string(buffer, size, length, PLANS[matcher->plan]);
+    length = append_string(buffer, size, length, " reason=");
+    
+    if ( matcher->plan == SUBREG_PLAN_LITERAL )
+        length = append_string(buffer, size, length, "plain");
+    else if ( matcher->plan == SUBREG_PLAN_AUTOMATON )
+        length = append_string(buffer, size, length, "atoms");
+    else if ( matcher->plan == SUBREG_PLAN_INTERPRETER && features == 0 )
+    {
+        length = append_string(buffer, size, length,
+                scan_validator(0, matcher->regex, 0, 1) == 0 ?
+                "no-arena" : "unsupported");
+    }
+    
+    for (i = 0; i < sizeof(FEATURES) / sizeof(FEATURES[0]); i++)
+    {
+        if ( !(features & (1U << i)) ) continue;
+        
+        if ( features & ((1U << i) - 1) )
+            length = append_string(buffer, size, length, ",");
+        
+        length = append_string(buffer, size, length, FEATURES[i]);
+    }
+    
+    length = append_string(buffer, size, length, " depth=");
+    length = append_ulong(buffer, size, length, matcher->depth);
+    length = append_string(buffer, size, length, " groups=");
+    length = append_ulong(buffer, size, length, matcher->groups);
+    
+    if ( size > 0 ) buffer[length < size ? length : size - 1] = '\0';
+    
+    return length;
+}
+
+
+/*
+ * Lexer. Patterns are tried in turn at each position, as the interpreter
+ * cannot combine them, but a dispatch table indexed by the character at
+ * the position has bit i set only if pattern i could make a non-empty
+ * match starting with it, so most patterns are never tried at most
+ * positions. The first characters are found by walking each pattern as
+ * far as its first part that must consume something. Anything whose first
+ * character is hard to pin down (look-aheads, options part-way through)
+ * makes the pattern opaque, and it is then tried everywhere.
+ */
+#define FIRST_NULLABLE                      1
+#define FIRST_OPAQUE                        2
+
+
+static int first_alternation(state_t* state, unsigned long* dispatch,
+        unsigned long bit, int nocase, int add);
+
+
+static int first_unit(state_t* state, unsigned long* dispatch,
+        unsigned long bit, int nocase, int add)
+{
+    atom_t atom;
+    unsigned int i;
+    int flags;
+    char rc;
+    
+    rc = state->regex[0];
+    
+    if ( rc == '(' )
+    {
+        state->regex++;
+        rc = state->regex[0];
+        
+        if ( rc == '?' && state->regex[1] != ':' &&
+                state->regex[1] != '=' && state->regex[1] != '!' )
+        {
+            /* an option changes how everything after it matches */
+            while ( state->regex[0] != ')' ) state->regex++;
+            state->regex++;
+            
+            return FIRST_OPAQUE | FIRST_NULLABLE;
+        }
+        
+        if ( rc == '?' )
+        {
+            rc = state->regex[1];
+            state->regex += 2;
+        }
+        
+        flags = first_alternation(state, dispatch, bit, nocase,
+                add && rc != '=' && rc != '!');
+        state->regex++;
+        
+        if ( rc == '=' || rc == '!' ) flags = FIRST_OPAQUE | FIRST_NULLABLE;
+    }
+    else if ( next_atom(state, &atom) == SUBREG_RESULT_INTERNAL_MATCH )
+    {
+        if ( add )
+        {
+            for (i = 1; i < 256; i++)
+                if ( atom_matches(&atom, (char) i, nocase) ) dispatch[i] |= bit;
+        }
+        
+        flags = atom.optional ? FIRST_NULLABLE : 0;
+        
+        /* next_atom() has read its quantifier, and one after that is literal */
+        if ( atom.optional ) return flags;
+    }
+    else return FIRST_OPAQUE;
+    
+    rc = state->regex[0];
+    
+    if ( rc == '*' || rc == '?' ) flags |= FIRST_NULLABLE;
+    if ( rc == '*' || rc == '+' || rc == '?' ) state->regex++;
+    
+    if ( rc == '{' && is_count(state->regex) )
+    {
+        state->regex++;
+        parse_bounds(&state->regex, &atom.min, &atom.max);
+        if ( atom.min == 0 ) flags |= FIRST_NULLABLE;
+    }
+    
+    return flags;
+}
+
+
+static int first_concatenation(state_t* state, unsigned long* dispatch,
+        unsigned long bit, int nocase, int add)
+{
+    const char* start;
+    int flags;
+    int unit_flags;
+    char rc;
+    
+    start = state->regex;
+    flags = FIRST_NULLABLE;
+    
+    for (;;)
+    {
+        rc = state->regex[0];
+        if ( is_end(rc) || rc == '|' || rc == ')' ) break;
+    
+        /* '$' is a literal at the start and the end of input elsewhere */
+        if ( rc == '$' && state->regex != start )
+        {
+            state->regex++;
+            continue;
+        }
+    
+        unit_flags = first_unit(state, dispatch, bit, nocase,
+                add && (flags & FIRST_NULLABLE));
+    
+        flags = (flags & unit_flags & FIRST_NULLABLE) |
+                ((flags | unit_flags) & FIRST_OPAQUE);
+    }
+    
+    return flags;
+}
+
+
+static int first_alternation(state_t* state, unsigned long* dispatch,
+        unsigned long bit, int nocase, int add)
+{
+    int flags;
+    
+    flags = first_concatenation(state, dispatch, bit, nocase, add);
+    
+    while ( state->regex[0] == '|' )
+    {
+        state->regex++;
+        flags |= first_concatenation(state, dispatch, bit, nocase, add);
+    }
+    
+    return flags;
+}
+
+
+unsigned long subreg_lexer_arena_size(unsigned int num_patterns)
+{
+    if ( num_patterns > BITAP_MAX_ATOMS ) return 0;
+    
+    return 256 * sizeof(unsigned long);
+}
+
+
+int subreg_lexer_init(subreg_lexer_t* lexer, const char* const patterns[],
+        unsigned int num_patterns, unsigned int max_depth, void* arena,
+        unsigned long arena_size)
+{
+    subreg_cost_t cost;
+    state_t state;
+    unsigned long* dispatch;
+    unsigned int i;
+    unsigned int c;
+    int nocase;
+    int result;
+    
+    if ( !lexer || !patterns || !arena || num_patterns > BITAP_MAX_ATOMS ||
+            arena_size < 256 * sizeof(unsigned long) )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    for (i = 0; i < num_patterns; i++)
+    {
+        if ( !patterns[i] ) return SUBREG_RESULT_INVALID_ARGUMENT;
+        
+        result = subreg_analyze(patterns[i], max_depth, &cost);
+        if ( is_bad_result(result) ) return result;
+    }
+    
+    dispatch = (unsigned long*) arena;
+    for (c = 0; c < 256; c++) dispatch[c] = 0;
+    
+    for (i = 0; i < num_patterns; i++)
+    {
+        state.regex = patterns[i];
+        if ( state.regex[0] == '^' ) state.regex++;
+        
+        state.regex = skip_case_option(state.regex, &nocase);
+        
+        if ( first_alternation(&state, dispatch, 1UL << i, nocase, 1) &
+                FIRST_OPAQUE )
+        {
+            for (c = 0; c < 256; c++) dispatch[c] |= 1UL << i;
+        }
+    }
+    
+    lexer->patterns = patterns;
+    lexer->num_patterns = num_patterns;
+    lexer->max_depth = max_depth;
+    lexer->dispatch = dispatch;
+    
+    return 0;
+}
+
+
+int subreg_lexer_run(const subreg_lexer_t* lexer, const char* input,
+        unsigned long length, subreg_token_t tokens[],
+        unsigned int max_tokens, unsigned long* consumed)
+{
+    state_t state;
+    unsigned long position;
+    unsigned int count;
+    int result;
+    
+    if ( !lexer || (length > 0 && !input) || (max_tokens > 0 && !tokens) ||
+            !consumed )
+        return SUBREG_RESULT_INVALID_ARGUMENT;
+    
+    position = 0;
+    count = 0;
+    
+    while ( position < length && count < max_tokens )
+    {
+        unsigned long candidates;
+        unsigned long best_length;
+        unsigned int best;
+        unsigned int i;
+    
+        candidates = lexer->dispatch[(unsigned char) input[position]];
+        best_length = 0;
+        best = 0;
+    
+        /* only a longer match displaces an earlier pattern's */
+        for (i = 0; candidates; i++, candidates >>= 1)
+        {
+            if ( !(candidates & 1) ) continue;
+            
+            result = match(&state, lexer->patterns[i], input + position,
+                    input + length, 0, 0, lexer->max_depth, 1);
+            if ( is_bad_result(result) ) return result;
+            
+            if ( result > 0 && state.input > best_length )
+            {
+                best_length = state.input;
+                best = i;
+            }
+        }
+    
+        if ( best_length == 0 ) break;
+    
+        tokens[count].id = best;
+        tokens[count].offset = position;
+        tokens[count].length = best_length;
+        count++;
+    
+        position += best_length;
+    }
+    
+    *consumed = position;
+    
+    return (int) count;
+}
@@ -27,6 +27,17 @@
 #ifndef _SUBREG_H_
 #define _SUBREG_H_
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * Result code. Pattern image is malformed, corrupt or of an unsupported
+ * version.
+ */
+#define SUBREG_RESULT_INVALID_IMAGE             -9
+
 
 /**
  * Result code. Invalid inline option specified.
@@ -87,6 +98,13 @@
 #define SUBREG_RESULT_NO_MATCH                  0
 
 
+/**
+ * Largest count allowed in a counted repetition such as "x{m,n}". A larger
+ * count is a syntax error.
+ */
+#define SUBREG_REPEAT_MAX                       1000
+
+
 /**
  * Represents a capture as an input string fragment.
  */
@@ -140,4 +158,1274 @@ int subreg_match(const char* regex, const char* input,
         subreg_capture_t captures[], unsigned int max_captures,
         unsigned int max_depth);
 
+
+/**
+ * As subreg_match(), but matches the first input_length characters of
+ * input, which need not be null-terminated. A null character within them
+ * can never be matched.
+ * 
+ * \param input         String to match against regex.
+ * 
+ * \param input_length  Number of characters in input.
+ */
+int subreg_match_n(const char* regex, const char* input,
+        unsigned int input_length, subreg_capture_t captures[],
+        unsigned int max_captures, unsigned int max_depth);
+
+
+/**
+ * Segment of an input made of several separate pieces of memory.
+ */
+typedef struct subreg_segment_t
+{
+    /**
+     * Pointer to first character of segment.
+     */
+    const char* start;
+    
+    
+    /**
+     * Number of characters in segment.
+     */
+    unsigned long length;
+    
+} subreg_segment_t;
+
+
+/**
+ * Represents a capture as a range of offsets into an input.
+ */
+typedef struct subreg_span_t
+{
+    /**
+     * Offset of beginning of capture from start of input.
+     */
+    unsigned long offset;
+    
+    
+    /**
+     * Number of characters in capture.
+     */
+    unsigned long length;
+    
+} subreg_span_t;
+
+
+/**
+ * As subreg_match_n(), but matches an input made of a sequence of segments
+ * (for example a chain of packet buffers, or the two halves of a wrapped
+ * ring buffer) without copying them together. Segments may be empty.
+ * 
+ * \param segments      Array of segments, in input order.
+ * 
+ * \param num_segments  Number of elements in segments.
+ * 
+ * \param captures      Pointer to array of captures to populate, as offsets
+ *                      from the start of the first segment. Use
+ *                      subreg_locate() to find the segment an offset is in.
+ */
+int subreg_match_segments(const char* regex,
+        const subreg_segment_t segments[], unsigned int num_segments,
+        subreg_span_t captures[], unsigned int max_captures,
+        unsigned int max_depth);
+
+
+/**
+ * Finds the segment that holds the character at an offset into an input
+ * made of segments.
+ * 
+ * \param segments      Array of segments, in input order.
+ * 
+ * \param num_segments  Number of elements in segments.
+ * 
+ * \param offset        Offset from the start of the first segment. The
+ *                      offset of the end of input is located at the end of
+ *                      the last segment.
+ * 
+ * \param segment       Receives index of segment.
+ * 
+ * \param segment_offset Receives offset from start of segment.
+ * 
+ * \return              0 on success or SUBREG_RESULT_INVALID_ARGUMENT if
+ *                      offset is beyond the end of input.
+ */
+int subreg_locate(const subreg_segment_t segments[],
+        unsigned int num_segments, unsigned long offset,
+        unsigned int* segment, unsigned long* segment_offset);
+
+
+/**
+ * Maximum number of input characters that a match-result memo entry can
+ * hold. Longer inputs are matched without consulting the memo. May be
+ * overridden at compile time.
+ */
+#ifndef SUBREG_MEMO_MAX_INPUT
+#define SUBREG_MEMO_MAX_INPUT                   64
+#endif
+
+
+/**
+ * Maximum number of captures that a match-result memo entry can hold.
+ * Results with more captures are not memoised. May be overridden at compile
+ * time.
+ */
+#ifndef SUBREG_MEMO_MAX_CAPTURES
+#define SUBREG_MEMO_MAX_CAPTURES                4
+#endif
+
+
+/**
+ * Number of consecutive slots probed when looking up or inserting an entry
+ * in a match-result memo.
+ */
+#define SUBREG_MEMO_PROBE_LIMIT                 4
+
+
+/**
+ * Match-result memo entry. Treat as opaque.
+ */
+typedef struct subreg_memo_entry_t
+{
+    unsigned long hash;
+    int occupied;
+    int result;
+    unsigned int max_captures;
+    unsigned int input_length;
+    char input[SUBREG_MEMO_MAX_INPUT];
+    unsigned int capture_offsets[SUBREG_MEMO_MAX_CAPTURES];
+    unsigned int capture_lengths[SUBREG_MEMO_MAX_CAPTURES];
+    
+} subreg_memo_entry_t;
+
+
+/**
+ * Memo of match results for a single regular expression. Entries are held
+ * in a caller-provided array, so SubReg still performs no allocation of its
+ * own. A memo is not thread-safe; give each thread its own memo.
+ */
+typedef struct subreg_memo_t
+{
+    /**
+     * Regular expression results are memoised for.
+     */
+    const char* regex;
+    
+    
+    /**
+     * Maximum depth of nested groups to allow in regex.
+     */
+    unsigned int max_depth;
+    
+    
+    /**
+     * Array of entries provided to subreg_memo_init().
+     */
+    subreg_memo_entry_t* entries;
+    
+    
+    /**
+     * Number of elements in entries.
+     */
+    unsigned int num_entries;
+    
+    
+    /**
+     * Number of lookups answered from the memo.
+     */
+    unsigned long hits;
+    
+    
+    /**
+     * Number of lookups that ran the matcher and memoised its result.
+     */
+    unsigned long misses;
+    
+    
+    /**
+     * Number of lookups that ran the matcher but could not memoise its
+     * result (input too long, too many captures or no entries). The sum of
+     * hits, misses and bypasses is the number of lookups.
+     */
+    unsigned long bypasses;
+    
+    
+    /**
+     * Number of entries overwritten to make room for new results.
+     */
+    unsigned long evictions;
+    
+} subreg_memo_t;
+
+
+/**
+ * Initialises a match-result memo.
+ * 
+ * \param memo          Memo to initialise.
+ * 
+ * \param regex         Null-terminated string containing regular expression.
+ *                      Must remain valid for the lifetime of the memo.
+ * 
+ * \param max_depth     Maximum depth of nested groups to allow in regex (see
+ *                      subreg_match()).
+ * 
+ * \param entries       Array of entries to hold memoised results.
+ * 
+ * \param num_entries   Number of elements in entries.
+ */
+void subreg_memo_init(subreg_memo_t* memo, const char* regex,
+        unsigned int max_depth, subreg_memo_entry_t entries[],
+        unsigned int num_entries);
+
+
+/**
+ * Matches input string against the memo's regular expression, returning a
+ * memoised result if the same input has been matched before with the same
+ * value of max_captures. Arguments and return value are as for
+ * subreg_match(), with capture start pointers always referring to input.
+ */
+int subreg_memo_match(subreg_memo_t* memo, const char* input,
+        subreg_capture_t captures[], unsigned int max_captures);
+
+
+/**
+ * Number of buckets in a subreg_stats_t step histogram.
+ */
+#define SUBREG_STATS_NUM_BUCKETS                24
+
+
+/**
+ * Per-pattern matching statistics. Steps (calls into the matcher's literal
+ * and block skipping loops) are used as the unit of cost, as they are
+ * deterministic and proportional to the CPU time spent matching.
+ * 
+ * To record without contention, give each thread its own instance for each
+ * pattern and combine them with subreg_stats_merge() when read.
+ */
+typedef struct subreg_stats_t
+{
+    /**
+     * Number of calls recorded.
+     */
+    unsigned long calls;
+    
+    
+    /**
+     * Number of calls that matched.
+     */
+    unsigned long matches;
+    
+    
+    /**
+     * Number of calls that did not match.
+     */
+    unsigned long no_matches;
+    
+    
+    /**
+     * Number of calls that returned an error.
+     */
+    unsigned long errors;
+    
+    
+    /**
+     * Total number of input characters scanned.
+     */
+    unsigned long bytes;
+    
+    
+    /**
+     * Total number of matcher steps.
+     */
+    unsigned long steps;
+    
+    
+    /**
+     * Log-bucketed step histogram. Bucket 0 counts calls taking fewer than
+     * 2 steps, bucket n counts calls taking 2^n to 2^(n+1)-1 steps. The last
+     * bucket also counts all calls taking more steps.
+     */
+    unsigned long histogram[SUBREG_STATS_NUM_BUCKETS];
+    
+} subreg_stats_t;
+
+
+/**
+ * Zeroes statistics.
+ */
+void subreg_stats_init(subreg_stats_t* stats);
+
+
+/**
+ * As subreg_match(), but also records the call in stats.
+ * 
+ * \param stats         Statistics to update. May be NULL, in which case
+ *                      nothing is recorded.
+ */
+int subreg_match_stats(subreg_stats_t* stats, const char* regex,
+        const char* input, subreg_capture_t captures[],
+        unsigned int max_captures, unsigned int max_depth);
+
+
+/**
+ * Adds the statistics in src to dest.
+ */
+void subreg_stats_merge(subreg_stats_t* dest, const subreg_stats_t* src);
+
+
+/**
+ * Formats statistics as a single line of plain text of the form
+ * "<name> calls=N matches=N no_matches=N errors=N bytes=N steps=N
+ * histogram=N,N,...".
+ * 
+ * \param stats         Statistics to format.
+ * 
+ * \param name          Label for the line (typically the pattern). May be
+ *                      NULL.
+ * 
+ * \param buffer        Buffer to write null-terminated text to.
+ * 
+ * \param size          Size of buffer. Output is truncated to fit.
+ * 
+ * \return              Length of the untruncated text, excluding the null
+ *                      terminator.
+ */
+unsigned int subreg_stats_format(const subreg_stats_t* stats,
+        const char* name, char* buffer, unsigned int size);
+
+
+/**
+ * Number of terms in a subreg_cost_t polynomial. Higher degree terms are
+ * folded into the last term.
+ */
+#define SUBREG_COST_NUM_TERMS                   8
+
+
+/**
+ * Worst-case cost of a regular expression, as computed by subreg_analyze().
+ */
+typedef struct subreg_cost_t
+{
+    /**
+     * Deepest nesting of groups in the regular expression. This is the
+     * smallest max_depth that can be passed to subreg_match() for the
+     * regular expression, and SubReg's system stack usage grows linearly
+     * with it.
+     */
+    unsigned int depth;
+    
+    
+    /**
+     * Degree of the step bound polynomial. 1 means matching cost grows
+     * linearly with input length, 2 quadratically and so on.
+     */
+    unsigned int degree;
+    
+    
+    /**
+     * Coefficients of the step bound polynomial. Matching an input of length
+     * n takes at most the sum of coefficients[i] * (n + 1)^i steps, where
+     * steps are counted as for subreg_stats_t. Coefficients saturate at
+     * ULONG_MAX.
+     */
+    unsigned long coefficients[SUBREG_COST_NUM_TERMS];
+    
+} subreg_cost_t;
+
+
+/**
+ * Validates a regular expression and computes an upper bound on the number
+ * of steps subreg_match() can take to match it against an input of a given
+ * length. Intended for admission control of untrusted regular expressions.
+ * 
+ * \param regex         Null-terminated string containing regular expression.
+ * 
+ * \param max_depth     Maximum depth of nested groups to allow in regex.
+ * 
+ * \param cost          Populated with worst-case cost if regex is valid.
+ * 
+ * \return              0 if regex is valid or <0 if it is not (or an error
+ *                      occurred).
+ * 
+ * \note    Validation is stricter than subreg_match(), which only reports
+ *          syntax errors it encounters whilst matching.
+ */
+int subreg_analyze(const char* regex, unsigned int max_depth,
+        subreg_cost_t* cost);
+
+
+/**
+ * Evaluates the step bound in cost for an input of the given length.
+ * Saturates at ULONG_MAX.
+ */
+unsigned long subreg_cost_steps(const subreg_cost_t* cost,
+        unsigned long input_length);
+
+
+/**
+ * Version of the pattern image format produced by subreg_image_build().
+ */
+#define SUBREG_IMAGE_VERSION                    1
+
+
+/**
+ * Computes the size of the pattern image subreg_image_build() produces for
+ * a set of regular expressions.
+ * 
+ * \param regexes       Array of null-terminated regular expressions.
+ * 
+ * \param count         Number of elements in regexes.
+ * 
+ * \return              Size of image in bytes.
+ */
+unsigned long subreg_image_size(const char* const regexes[],
+        unsigned int count);
+
+
+/**
+ * Builds a pattern image: a position-independent, versioned and checksummed
+ * blob holding a set of validated regular expressions, intended to be built
+ * offline and used in place from ROM, a const array or a read-only memory
+ * mapped file.
+ * 
+ * \param image         Buffer to write image to. Needs no particular
+ *                      alignment.
+ * 
+ * \param size          Size of buffer. Must be at least the value returned
+ *                      by subreg_image_size().
+ * 
+ * \param regexes       Array of null-terminated regular expressions.
+ * 
+ * \param count         Number of elements in regexes.
+ * 
+ * \param max_depth     Maximum depth of nested groups to allow in each
+ *                      regular expression.
+ * 
+ * \return              0 on success, or <0 if a regular expression is
+ *                      invalid (as reported by subreg_analyze()) or an
+ *                      invalid argument was passed.
+ */
+int subreg_image_build(void* image, unsigned long size,
+        const char* const regexes[], unsigned int count,
+        unsigned int max_depth);
+
+
+/**
+ * Verifies a pattern image's header and checksum. Must be called (once)
+ * before an image from an untrusted location is used.
+ * 
+ * \param image         Pointer to image.
+ * 
+ * \param size          Number of bytes available at image.
+ * 
+ * \return              Number of regular expressions in image, or
+ *                      SUBREG_RESULT_INVALID_IMAGE.
+ */
+int subreg_image_check(const void* image, unsigned long size);
+
+
+/**
+ * Returns a regular expression held in a verified pattern image. The
+ * returned string lies within the image; nothing is copied.
+ * 
+ * \param image         Pointer to verified image.
+ * 
+ * \param index         Index of regular expression.
+ * 
+ * \param max_depth     If not NULL, receives the group depth required by
+ *                      the regular expression, suitable for passing to
+ *                      subreg_match().
+ * 
+ * \return              Regular expression or NULL if index is out of range.
+ */
+const char* subreg_image_regex(const void* image, unsigned int index,
+        unsigned int* max_depth);
+
+
+/**
+ * Matches input string against a regular expression held in a verified
+ * pattern image. Arguments and return value are otherwise as for
+ * subreg_match().
+ */
+int subreg_image_match(const void* image, unsigned int index,
+        const char* input, subreg_capture_t captures[],
+        unsigned int max_captures);
+
+/**
+ * Finds the leftmost substring of input matching a regular expression. At
+ * each offset the match is made as by subreg_match(), except that it need
+ * not reach the end of input unless regex ends with '$'. A regex starting
+ * with '^' is only tried at the start of input.
+ * 
+ * Arguments are as for subreg_match(). The first capture holds the matched
+ * substring.
+ * 
+ * \return              Number of captures made, SUBREG_RESULT_NO_MATCH if no
+ *                      substring of input matches, or <0 if an error
+ *                      occurred.
+ */
+int subreg_search(const char* regex, const char* input,
+        subreg_capture_t captures[], unsigned int max_captures,
+        unsigned int max_depth);
+
+
+/**
+ * Searcher engine that tries the regular expression at each offset of the
+ * input in turn, as subreg_search() does.
+ */
+#define SUBREG_ENGINE_INTERPRETER               0
+
+
+/**
+ * Searcher engine that scans the input once with an Aho-Corasick automaton,
+ * used for alternations of plain literals.
+ */
+#define SUBREG_ENGINE_AHO_CORASICK              1
+
+
+/**
+ * Searcher engine that runs a bit-parallel Shift-And automaton over the
+ * input, used for patterns of up to one machine word's worth of plain
+ * characters, escapes (including character classes) and '.', each
+ * optionally followed by '?' or a bounded count {m} or {m,n}, which takes
+ * n of the word's positions. Candidate matches are confirmed by the
+ * interpreter.
+ */
+#define SUBREG_ENGINE_BITAP                     2
+
+
+/**
+ * Searcher for a single regular expression, selecting the faster engine
+ * its pattern allows. Fields other than those documented are private.
+ */
+typedef struct subreg_searcher_t
+{
+    /**
+     * Regular expression.
+     */
+    const char* regex;
+    
+    
+    /**
+     * Maximum depth of nested groups to allow in regex.
+     */
+    unsigned int max_depth;
+    
+    
+    /**
+     * Engine selected by subreg_searcher_init(), one of SUBREG_ENGINE_*.
+     */
+    int engine;
+    
+    
+    int nocase;
+    unsigned int num_states;
+    unsigned int max_length;
+    unsigned int* first_child;
+    unsigned char* edge_bytes;
+    unsigned int* fail;
+    unsigned int* output;
+    unsigned int* dict;
+    unsigned int* depth;
+    unsigned long* masks;
+    unsigned long bitap_accept;
+    unsigned long bitap_optional;
+    unsigned long bitap_initial;
+    unsigned long bitap_final;
+    unsigned long* reverse_masks;
+    unsigned long reverse_accept;
+    unsigned long reverse_optional;
+    unsigned long reverse_initial;
+    unsigned long reverse_final;
+    
+} subreg_searcher_t;
+
+
+/**
+ * Computes the size of the arena subreg_searcher_init() needs to search for
+ * a regular expression with an engine faster than the interpreter. An
+ * alternation of one or more non-empty literals made of plain characters
+ * and escapes other than character classes, optionally preceded by "(?i)"
+ * or "(?I)", can use SUBREG_ENGINE_AHO_CORASICK, with an arena that grows
+ * linearly with the total length of the literals. Other patterns may be
+ * able to use SUBREG_ENGINE_BITAP, with a fixed size arena.
+ * 
+ * \param regex         Null-terminated string containing regular expression.
+ * 
+ * \return              Size of arena in bytes, or 0 if regex can only be
+ *                      searched for with the interpreter.
+ */
+unsigned long subreg_searcher_arena_size(const char* regex);
+
+
+/**
+ * Validates a regular expression (as subreg_analyze() does) and initialises
+ * a searcher for it. The Aho-Corasick or bitap engine is selected if the
+ * regular expression allows it and arena is large enough, and the
+ * interpreter otherwise.
+ * 
+ * \param searcher      Searcher to initialise.
+ * 
+ * \param regex         Null-terminated string containing regular expression.
+ *                      Must remain valid for the lifetime of the searcher.
+ * 
+ * \param max_depth     Maximum depth of nested groups to allow in regex.
+ * 
+ * \param arena         Memory to build automaton in, aligned for unsigned
+ *                      long. Must remain valid for the lifetime of the
+ *                      searcher. May be NULL.
+ * 
+ * \param arena_size    Size of arena.
+ * 
+ * \return              0 on success, or <0 if regex is invalid or an
+ *                      invalid argument was passed.
+ */
+int subreg_searcher_init(subreg_searcher_t* searcher, const char* regex,
+        unsigned int max_depth, void* arena, unsigned long arena_size);
+
+
+/**
+ * Finds the leftmost substring of input matching the searcher's regular
+ * expression. Arguments and return value are as for subreg_search(), which
+ * both engines agree with.
+ */
+int subreg_searcher_search(const subreg_searcher_t* searcher,
+        const char* input, subreg_capture_t captures[],
+        unsigned int max_captures);
+
+
+/**
+ * Identifies the literal an Aho-Corasick searcher matched.
+ * 
+ * \param searcher      Searcher using SUBREG_ENGINE_AHO_CORASICK.
+ * 
+ * \param match         First capture made by subreg_searcher_search().
+ * 
+ * \return              Index of the first alternative in the regular
+ *                      expression matching the captured text, or <0 if
+ *                      there is none or searcher uses another engine.
+ */
+int subreg_searcher_literal(const subreg_searcher_t* searcher,
+        const subreg_capture_t* match);
+
+/**
+ * Function called by a stream for each match it finds.
+ * 
+ * \param context       Context passed to subreg_stream_init().
+ * 
+ * \param offset        Offset of the match from the start of the stream.
+ * 
+ * \param length        Length of the match.
+ */
+typedef void (*subreg_stream_callback_t)(void* context, unsigned long offset,
+        unsigned long length);
+
+
+/**
+ * State of a search through a stream of input that arrives in chunks.
+ * Fields other than those documented are private.
+ */
+typedef struct subreg_stream_t
+{
+    /**
+     * Searcher used.
+     */
+    const subreg_searcher_t* searcher;
+    
+    
+    /**
+     * Function called for each match.
+     */
+    subreg_stream_callback_t callback;
+    
+    
+    /**
+     * Context passed to callback.
+     */
+    void* context;
+    
+    
+    /**
+     * Number of bytes fed so far.
+     */
+    unsigned long position;
+    
+    
+    char* buffer;
+    unsigned long scan;
+    unsigned long next_start;
+    unsigned long state;
+    unsigned long pending;
+    unsigned long best_start;
+    unsigned long best_length;
+    unsigned int best_literal;
+    
+} subreg_stream_t;
+
+
+/**
+ * Computes the size of the buffer a stream needs to hold back input between
+ * chunks. This is at most twice the length of the longest match the
+ * searcher's regular expression can make.
+ * 
+ * \param searcher      Initialised searcher.
+ * 
+ * \return              Size of buffer in bytes, or 0 if searcher uses
+ *                      SUBREG_ENGINE_INTERPRETER, which cannot search a
+ *                      stream.
+ */
+unsigned long subreg_stream_buffer_size(const subreg_searcher_t* searcher);
+
+
+/**
+ * Initialises a stream. Each time a stream is fed, the leftmost match that
+ * starts at or after the end of the last match reported is reported, as
+ * repeated calls to subreg_searcher_search() on the whole input would, as
+ * soon as no more input can change it. Matches never include null
+ * characters, but unlike subreg_searcher_search() the search carries on
+ * past them.
+ * 
+ * \param stream        Stream to initialise.
+ * 
+ * \param searcher      Searcher using SUBREG_ENGINE_AHO_CORASICK or
+ *                      SUBREG_ENGINE_BITAP. Must remain valid for the
+ *                      lifetime of the stream.
+ * 
+ * \param buffer        Buffer of at least subreg_stream_buffer_size() bytes
+ *                      to hold back input in. Must remain valid for the
+ *                      lifetime of the stream.
+ * 
+ * \param buffer_size   Size of buffer.
+ * 
+ * \param callback      Function to call for each match.
+ * 
+ * \param context       Passed to callback.
+ * 
+ * \return              0 on success or SUBREG_RESULT_INVALID_ARGUMENT.
+ */
+int subreg_stream_init(subreg_stream_t* stream,
+        const subreg_searcher_t* searcher, void* buffer,
+        unsigned long buffer_size, subreg_stream_callback_t callback,
+        void* context);
+
+
+/**
+ * Feeds the next chunk of input to a stream, calling its callback for any
+ * matches that are complete. The chunk need not be null-terminated and is
+ * not referred to after the call returns.
+ * 
+ * \param stream        Initialised stream.
+ * 
+ * \param data          Chunk of input.
+ * 
+ * \param length        Length of chunk.
+ * 
+ * \return              0 on success or SUBREG_RESULT_INVALID_ARGUMENT.
+ */
+int subreg_stream_feed(subreg_stream_t* stream, const char* data,
+        unsigned long length);
+
+
+/**
+ * Ends the input to a stream, calling its callback for any matches held
+ * back in case more input arrived.
+ * 
+ * \param stream        Initialised stream.
+ * 
+ * \return              0 on success or SUBREG_RESULT_INVALID_ARGUMENT.
+ */
+int subreg_stream_finish(subreg_stream_t* stream);
+
+
+/**
+ * Validator that checks input one character at a time as it arrives, for
+ * example from a serial port. All fields are private.
+ */
+typedef struct subreg_validator_t
+{
+    const unsigned long* masks;
+    unsigned long mandatory;
+    unsigned long dead;
+    unsigned long state;
+    
+} subreg_validator_t;
+
+
+/**
+ * Computes the size of the arena subreg_validator_init() needs for a
+ * regular expression. Validators support a sequence of up to one less than
+ * the number of bits in an unsigned long of plain characters, escapes
+ * (including character classes) and '.', each optionally followed by '?'
+ * or a bounded count {m} or {m,n}, which counts as n of them, preceded by
+ * "(?i)" or "(?I)" if at all, and with an optional leading '^' and
+ * trailing '$'.
+ * 
+ * \param regex         Null-terminated string containing regular expression.
+ * 
+ * \return              Size of arena in bytes, or 0 if regex is not
+ *                      supported.
+ */
+unsigned long subreg_validator_arena_size(const char* regex);
+
+
+/**
+ * Initialises a validator and resets it to expect the start of input.
+ * 
+ * \param validator     Validator to initialise.
+ * 
+ * \param regex         Null-terminated string containing regular
+ *                      expression. Not referred to after the call returns.
+ * 
+ * \param arena         Memory to build tables in, aligned for unsigned long.
+ *                      Must remain valid for the lifetime of the validator,
+ *                      and may be shared by validators for the same regex.
+ * 
+ * \param arena_size    Size of arena.
+ * 
+ * \return              0 on success, SUBREG_RESULT_ILLEGAL_EXPRESSION if
+ *                      regex is not supported or another result <0 if regex
+ *                      is invalid or an invalid argument was passed.
+ */
+int subreg_validator_init(subreg_validator_t* validator, const char* regex,
+        void* arena, unsigned long arena_size);
+
+
+/**
+ * Resets a validator to expect the start of a new input.
+ */
+void subreg_validator_reset(subreg_validator_t* validator);
+
+
+/**
+ * Adds a character to a validator's input.
+ * 
+ * \param validator     Initialised validator.
+ * 
+ * \param c             Next character of input.
+ * 
+ * \return              1 if the input so far can still be extended to one
+ *                      subreg_match() matches, or 0 if no extension of it
+ *                      can match, in which case the validator returns 0
+ *                      until it is reset.
+ */
+int subreg_validator_push(subreg_validator_t* validator, char c);
+
+
+/**
+ * Checks whether a validator's input so far is matched by its regular
+ * expression, as subreg_match() would.
+ * 
+ * \return              1 if it is or 0 if it is not.
+ */
+int subreg_validator_accepts(const subreg_validator_t* validator);
+
+
+/**
+ * Validator state at the end of one span of a tracker's input.
+ */
+typedef struct subreg_checkpoint_t
+{
+    /**
+     * Length of span.
+     */
+    unsigned long length;
+    
+    
+    /**
+     * State of the validator after the input up to the end of the span.
+     */
+    unsigned long state;
+    
+} subreg_checkpoint_t;
+
+
+/**
+ * Tracker that keeps track of whether a large input, such as a document
+ * being edited, is matched by a validator's regular expression, so that
+ * after each small edit only the input from the edit to where the
+ * validator's state converges with its previous run has to be scanned
+ * again. Fields other than those documented are private.
+ */
+typedef struct subreg_tracker_t
+{
+    /**
+     * Validator used.
+     */
+    const subreg_validator_t* validator;
+    
+    
+    /**
+     * Length of input tracked.
+     */
+    unsigned long length;
+    
+    
+    subreg_checkpoint_t* checkpoints;
+    unsigned long max_checkpoints;
+    unsigned long num_checkpoints;
+    unsigned long span_size;
+    
+} subreg_tracker_t;
+
+
+/**
+ * Initialises a tracker by pushing the whole of an input through a
+ * validator. The input is divided into spans of at least span_size
+ * characters, and one checkpoint per span records the validator's state at
+ * its end.
+ * 
+ * \param tracker       Tracker to initialise.
+ * 
+ * \param validator     Initialised validator. Only its tables are used, so
+ *                      it may go on being used for other input. Must remain
+ *                      valid for the lifetime of the tracker.
+ * 
+ * \param checkpoints   Array of checkpoints. Must remain valid for the
+ *                      lifetime of the tracker.
+ * 
+ * \param max_checkpoints Size of checkpoints array. An input of length
+ *                      characters needs at most length / span_size + 1.
+ * 
+ * \param span_size     Minimum length of a span. Larger spans need fewer
+ *                      checkpoints but make each edit rescan more input.
+ * 
+ * \param input         Input, which need not be null-terminated.
+ * 
+ * \param length        Length of input.
+ * 
+ * \return              0 on success or SUBREG_RESULT_INVALID_ARGUMENT.
+ */
+int subreg_tracker_init(subreg_tracker_t* tracker,
+        const subreg_validator_t* validator, subreg_checkpoint_t checkpoints[],
+        unsigned long max_checkpoints, unsigned long span_size,
+        const char* input, unsigned long length);
+
+
+/**
+ * Updates a tracker after an edit that replaced removed characters at
+ * offset with inserted characters. Scanning resumes from the checkpoint
+ * before the edit and stops at the first checkpoint after it at which the
+ * validator's state is the same as before the edit, since the input from
+ * there on is unchanged.
+ * 
+ * \param tracker       Initialised tracker.
+ * 
+ * \param input         Input after the edit.
+ * 
+ * \param offset        Offset of the edit.
+ * 
+ * \param removed       Number of characters removed.
+ * 
+ * \param inserted      Number of characters inserted.
+ * 
+ * \return              0 on success or SUBREG_RESULT_INVALID_ARGUMENT if
+ *                      an invalid argument was passed or there are not
+ *                      enough checkpoints, in which case the tracker is
+ *                      left unchanged.
+ */
+int subreg_tracker_edit(subreg_tracker_t* tracker, const char* input,
+        unsigned long offset, unsigned long removed, unsigned long inserted);
+
+
+/**
+ * Checks whether a tracker's input is matched by its validator's regular
+ * expression, as subreg_match() would.
+ * 
+ * \return              1 if it is or 0 if it is not.
+ */
+int subreg_tracker_accepts(const subreg_tracker_t* tracker);
+
+
+/**
+ * Plan a matcher uses when no other plan applies: the input is matched by the
+ * interpreter, as subreg_match() would.
+ */
+#define SUBREG_PLAN_INTERPRETER                 0
+
+
+/**
+ * Plan a matcher uses when the regular expression is made only of plain
+ * characters: the input is compared with it directly.
+ */
+#define SUBREG_PLAN_LITERAL                     1
+
+
+/**
+ * Plan a matcher uses when the regular expression is one a validator could
+ * run, ignoring the brackets of groups that are not repeated, and has no
+ * capturing groups: the input is run through a validator.
+ */
+#define SUBREG_PLAN_AUTOMATON                   2
+
+
+/**
+ * Plan a matcher uses when the regular expression would use
+ * SUBREG_PLAN_AUTOMATON but has capturing groups: the input is run through
+ * a validator first, and the interpreter only makes the captures of inputs
+ * that match.
+ */
+#define SUBREG_PLAN_PREFILTER                   3
+
+
+/**
+ * Regular expression feature flags, reported by a matcher to explain its
+ * choice of plan.
+ */
+#define SUBREG_FEATURE_CAPTURES                 0x01
+#define SUBREG_FEATURE_ALTERNATION              0x02
+#define SUBREG_FEATURE_REPETITION               0x04
+#define SUBREG_FEATURE_LOOK_AHEAD               0x08
+#define SUBREG_FEATURE_OPTION                   0x10
+#define SUBREG_FEATURE_ANCHOR                   0x20
+#define SUBREG_FEATURE_LONG                     0x40
+
+
+/**
+ * Matcher that picks the cheapest way of matching a regular expression
+ * that gives the same results as subreg_match(). Fields other than those
+ * documented are private.
+ */
+typedef struct subreg_matcher_t
+{
+    /**
+     * Regular expression matched.
+     */
+    const char* regex;
+    
+    
+    /**
+     * Maximum depth of nested groups.
+     */
+    unsigned int max_depth;
+    
+    
+    /**
+     * Plan chosen, one of SUBREG_PLAN_INTERPRETER, SUBREG_PLAN_LITERAL,
+     * SUBREG_PLAN_AUTOMATON or SUBREG_PLAN_PREFILTER.
+     */
+    int plan;
+    
+    
+    /**
+     * SUBREG_FEATURE_* flags for the features of the regular expression
+     * that rule out cheaper plans. SUBREG_FEATURE_ANCHOR is set for a '^'
+     * or '$' anywhere but the start or end, and SUBREG_FEATURE_LONG for
+     * more characters than a validator can hold.
+     */
+    unsigned int features;
+    
+    
+    /**
+     * Deepest nesting of groups.
+     */
+    unsigned int depth;
+    
+    
+    /**
+     * Number of capturing groups.
+     */
+    unsigned int groups;
+    
+    
+    subreg_validator_t validator;
+    
+} subreg_matcher_t;
+
+
+/**
+ * Computes the size of the arena subreg_matcher_init() needs to use
+ * SUBREG_PLAN_AUTOMATON or SUBREG_PLAN_PREFILTER for a regular expression.
+ * 
+ * \param regex         Null-terminated string containing regular expression.
+ * 
+ * \return              Size of arena in bytes, or 0 if regex needs none.
+ */
+unsigned long subreg_matcher_arena_size(const char* regex);
+
+
+/**
+ * Initialises a matcher, validating its regular expression as
+ * subreg_analyze() does and choosing a plan for it.
+ * 
+ * \param matcher       Matcher to initialise.
+ * 
+ * \param regex         Null-terminated string containing regular
+ *                      expression. Must remain valid for the lifetime of the
+ *                      matcher.
+ * 
+ * \param max_depth     Maximum depth of nested groups.
+ * 
+ * \param arena         Memory to build tables in, aligned for unsigned long,
+ *                      or NULL. Must remain valid for the lifetime of the
+ *                      matcher.
+ * 
+ * \param arena_size    Size of arena. Plans needing more than this are not
+ *                      chosen.
+ * 
+ * \return              0 on success or <0 if regex is invalid or an invalid
+ *                      argument was passed.
+ */
+int subreg_matcher_init(subreg_matcher_t* matcher, const char* regex,
+        unsigned int max_depth, void* arena, unsigned long arena_size);
+
+
+/**
+ * Matches an input against a matcher's regular expression.
+ * 
+ * \param matcher       Initialised matcher.
+ * 
+ * \param input         Null-terminated string containing input.
+ * 
+ * \param captures      Array to hold captures.
+ * 
+ * \param max_captures  Maximum number of captures to make.
+ * 
+ * \return              Same as subreg_match().
+ */
+int subreg_matcher_match(const subreg_matcher_t* matcher, const char* input,
+        subreg_capture_t captures[], unsigned int max_captures);
+
+
+/**
+ * Formats a one-line description of the plan a matcher chose and why, as
+ * "plan=... reason=... depth=... groups=...", where reason is a
+ * comma-separated list of the features that ruled out cheaper plans.
+ * 
+ * \param matcher       Initialised matcher.
+ * 
+ * \param buffer        Buffer to write null-terminated text to. May be NULL
+ *                      if size is 0.
+ * 
+ * \param size          Size of buffer. Text that does not fit is truncated.
+ * 
+ * \return              Length of the untruncated text, excluding the null
+ *                      terminator.
+ */
+unsigned int subreg_matcher_explain(const subreg_matcher_t* matcher,
+        char* buffer, unsigned int size);
+
+
+/**
+ * Token found by a lexer.
+ */
+typedef struct subreg_token_t
+{
+    /**
+     * Index of the pattern that matched.
+     */
+    unsigned int id;
+    
+    
+    /**
+     * Offset of token from start of input.
+     */
+    unsigned long offset;
+    
+    
+    /**
+     * Length of token.
+     */
+    unsigned long length;
+    
+} subreg_token_t;
+
+
+/**
+ * Lexer that splits input into tokens, each the longest match of any of a
+ * list of patterns. Fields other than those documented are private.
+ */
+typedef struct subreg_lexer_t
+{
+    /**
+     * Token patterns.
+     */
+    const char* const* patterns;
+    
+    
+    /**
+     * Number of token patterns.
+     */
+    unsigned int num_patterns;
+    
+    
+    /**
+     * Maximum depth of nested groups.
+     */
+    unsigned int max_depth;
+    
+    
+    const unsigned long* dispatch;
+    
+} subreg_lexer_t;
+
+
+/**
+ * Computes the size of the arena subreg_lexer_init() needs.
+ * 
+ * \param num_patterns  Number of token patterns.
+ * 
+ * \return              Size of arena in bytes, or 0 if there are more
+ *                      patterns than the number of bits in an unsigned long.
+ */
+unsigned long subreg_lexer_arena_size(unsigned int num_patterns);
+
+
+/**
+ * Initialises a lexer, validating its patterns as subreg_analyze() does.
+ * 
+ * \param lexer         Lexer to initialise.
+ * 
+ * \param patterns      Array of null-terminated strings containing token
+ *                      patterns, in order of priority. Must remain valid for
+ *                      the lifetime of the lexer.
+ * 
+ * \param num_patterns  Number of patterns, up to the number of bits in an
+ *                      unsigned long.
+ * 
+ * \param max_depth     Maximum depth of nested groups.
+ * 
+ * \param arena         Memory to build a dispatch table in, aligned for
+ *                      unsigned long. Must remain valid for the lifetime of
+ *                      the lexer.
+ * 
+ * \param arena_size    Size of arena.
+ * 
+ * \return              0 on success or <0 if a pattern is invalid or an
+ *                      invalid argument was passed.
+ */
+int subreg_lexer_init(subreg_lexer_t* lexer, const char* const patterns[],
+        unsigned int num_patterns, unsigned int max_depth, void* arena,
+        unsigned long arena_size);
+
+
+/**
+ * Splits input into tokens. At each position, each pattern that could
+ * match there is matched as a prefix of the rest of the input, as
+ * subreg_search() would, and the longest non-empty match becomes the next
+ * token, with the earliest pattern winning ties. Lexing stops at the end
+ * of input, when tokens is full or where no pattern matches.
+ * 
+ * \param lexer         Initialised lexer.
+ * 
+ * \param input         Input, which need not be null-terminated.
+ * 
+ * \param length        Length of input.
+ * 
+ * \param tokens        Array to hold tokens.
+ * 
+ * \param max_tokens    Size of tokens array.
+ * 
+ * \param consumed      Receives the offset lexing stopped at, which is
+ *                      length if all of input was split into tokens.
+ * 
+ * \return              Number of tokens found or <0 if an invalid argument
+ *                      was passed.
+ */
+int subreg_lexer_run(const subreg_lexer_t* lexer, const char* input,
+        unsigned long length, subreg_token_t tokens[],
+        unsigned int max_tokens, unsigned long* consumed);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* _SUBREG_H_ */
@@ -0,0 +1,1301 @@
+/**
+ * SubReg - A small footprint regular expression engine written in ANSI C.
+ *
+ * https://github.com/mattbucknall/subreg
+ *
+ * Copyright (c) 2016-2021 Matthew T. Bucknall
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISIN
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _SUBREG_HPP_
+#define _SUBREG_HPP_
+
+/*
+ * C++20 interface to SubReg. Regular expressions given as template
+ * arguments are parsed and validated at compile time, and each one is
+ * matched by code specialised for it, with no run-time parsing:
+ *
+ *     int result = subreg::match<"(\\d+)\\.(\\d+)">(input, captures, 3);
+ *
+ * Results and captures are exactly those subreg_match() would give for the
+ * same regular expression and max_depth. An invalid regular expression
+ * fails to compile, with the SUBREG_RESULT_* code as the diagnostic.
+ *
+ * Regular expressions only known at run time are validated once by
+ * constructing a subreg::regex, and used through a drop-in replacement for
+ * std::regex_match():
+ *
+ *     subreg::regex version("(\\d+)\\.(\\d+)");
+ *     subreg::match_results m;
+ *
+ *     if ( subreg::regex_match(input, m, version) ) use(m[1], m[2]);
+ *
+ * Inputs are std::string_view and need not be null-terminated, so nothing
+ * is copied, and captures are std::string_view into the input.
+ */
+
+#include <climits>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "subreg.h"
+
+
+/**
+ * Most captures the std::span and match_results interfaces can return.
+ */
+#ifndef SUBREG_HPP_MAX_CAPTURES
+#define SUBREG_HPP_MAX_CAPTURES 16
+#endif
+
+
+namespace subreg
+{
+
+/**
+ * String literal usable as a template argument.
+ */
+template<std::size_t N>
+struct fixed_string
+{
+    char data[N];
+
+    constexpr fixed_string(const char (&str)[N]) noexcept
+    {
+        for (std::size_t i = 0; i < N; i++) data[i] = str[i];
+    }
+};
+
+
+namespace detail
+{
+
+enum class node_kind
+{
+    empty,
+    character,
+    any,
+    char_class,
+    not_character,
+    option,
+    group,
+    repeat,
+    concatenation,
+    alternation
+};
+
+
+enum class group_mode
+{
+    non_capture,
+    capture,
+    pos_look_ahead,
+    neg_look_ahead
+};
+
+
+inline constexpr int option_nocase = 1;
+inline constexpr unsigned int repeat_unbounded = static_cast<unsigned int>(-1);
+
+
+struct node
+{
+    node_kind kind = node_kind::empty;
+
+    /* character, not_character: character; char_class: class letter;
+       option: option letter; repeat: quantifier */
+    char c = '\0';
+
+    /* repeat '{': bounds, max being repeat_unbounded for "{m,}" */
+    unsigned int min = 0;
+    unsigned int max = 0;
+
+    group_mode mode = group_mode::non_capture;
+
+    /* group, repeat: the repeated or grouped element;
+       concatenation, alternation: first element or branch */
+    int child = -1;
+
+    /* next element of the enclosing concatenation or alternation */
+    int next = -1;
+};
+
+
+/*
+ * A regular expression of length N - 1 never needs more nodes than this:
+ * every literal, group and quantifier consumes at least one character, and
+ * there is at most one concatenation and one alternation per group.
+ */
+constexpr std::size_t max_nodes(std::size_t n) noexcept
+{
+    return 3 * n + 4;
+}
+
+
+template<std::size_t N>
+struct program
+{
+    node nodes[max_nodes(N)];
+    int num_nodes = 0;
+    int root = -1;
+    int result = SUBREG_RESULT_NO_MATCH;
+    bool uses_options = false;
+};
+
+
+/*
+ * Recursive descent parser for compile-time use. It follows the same rules
+ * as subreg.c, and reports the same errors, as subreg_analyze() does.
+ */
+template<std::size_t N>
+class parser
+{
+public:
+    constexpr parser(const char* regex, int max_depth) noexcept :
+        regex(regex), max_depth(max_depth)
+    {
+    }
+
+
+    constexpr program<N> parse() noexcept
+    {
+        if ( regex[0] == '^' ) regex++;
+
+        prog.root = parse_alternation();
+        if ( prog.result < 0 ) return prog;
+
+        if ( regex[0] == '$' ) regex++;
+        if ( regex[0] != '\0' ) prog.result = SUBREG_RESULT_ILLEGAL_EXPRESSION;
+
+        return prog;
+    }
+
+
+private:
+    const char* regex;
+    int max_depth;
+    int depth = 0;
+    program<N> prog;
+
+
+    constexpr int fail(int result) noexcept
+    {
+        if ( prog.result == SUBREG_RESULT_NO_MATCH ) prog.result = result;
+        return -1;
+    }
+
+
+    constexpr int new_node(node_kind kind, char c = '\0') noexcept
+    {
+        int index;
+
+        index = prog.num_nodes++;
+        prog.nodes[index].kind = kind;
+        prog.nodes[index].c = c;
+
+        return index;
+    }
+
+
+    static constexpr bool is_hex(char c) noexcept
+    {
+        return ((c >= '0') && (c <= '9')) || ((c >= 'A') && (c <= 'F')) ||
+                ((c >= 'a') && (c <= 'f'));
+    }
+
+
+    static constexpr int hex_value(char c) noexcept
+    {
+        if ( c <= '9' ) return c - '0';
+        if ( c <= 'F' ) return c - 'A' + 10;
+        return c - 'a' + 10;
+    }
+
+
+    static constexpr bool is_class(char c) noexcept
+    {
+        return (c == 'D') || (c == 'H') || (c == 'S') || (c == 'W') ||
+                (c == 'd') || (c == 'h') || (c == 's') || (c == 'w');
+    }
+
+
+    constexpr bool parse_non_class_metacharacter(char& c) noexcept
+    {
+        char rc;
+
+        rc = *regex;
+        if ( rc == '\0' ) return fail(SUBREG_RESULT_INVALID_METACHARACTER), false;
+
+        regex++;
+
+        if ( is_class(rc) || rc == '!' )
+            return fail(SUBREG_RESULT_ILLEGAL_EXPRESSION), false;
+
+        switch (rc)
+        {
+        case 'b':   c = '\b';   break;
+        case 'f':   c = '\f';   break;
+        case 'n':   c = '\n';   break;
+        case 'r':   c = '\r';   break;
+        case 't':   c = '\t';   break;
+        case 'v':   c = '\v';   break;
+
+        case 'x':
+            if ( !is_hex(regex[0]) || !is_hex(regex[1]) )
+                return fail(SUBREG_RESULT_INVALID_METACHARACTER), false;
+
+            c = static_cast<char>((hex_value(regex[0]) << 4) |
+                    hex_value(regex[1]));
+            regex += 2;
+            break;
+
+        default:
+            c = rc;
+        }
+
+        return true;
+    }
+
+
+    constexpr int parse_group() noexcept
+    {
+        int index;
+        int child;
+        char rc;
+
+        depth++;
+        if ( depth > max_depth ) return fail(SUBREG_RESULT_MAX_DEPTH_EXCEEDED);
+
+        index = new_node(node_kind::group);
+        prog.nodes[index].mode = group_mode::capture;
+
+        if ( regex[0] == '?' )
+        {
+            regex++;
+            rc = regex[0];
+
+            if ( rc == ':' ) prog.nodes[index].mode = group_mode::non_capture;
+            else if ( rc == '=' ) prog.nodes[index].mode = group_mode::pos_look_ahead;
+            else if ( rc == '!' ) prog.nodes[index].mode = group_mode::neg_look_ahead;
+            else if ( ((rc >= 'A') && (rc <= 'Z')) || ((rc >= 'a') && (rc <= 'z')) )
+            {
+                if ( rc != 'i' && rc != 'I' ) return fail(SUBREG_RESULT_INVALID_OPTION);
+
+                regex++;
+                if ( regex[0] != ')' ) return fail(SUBREG_RESULT_MISSING_BRACKET);
+
+                regex++;
+                depth--;
+
+                prog.nodes[index].kind = node_kind::option;
+                prog.nodes[index].c = rc;
+                prog.uses_options = true;
+
+                return index;
+            }
+            else return fail(SUBREG_RESULT_ILLEGAL_EXPRESSION);
+
+            regex++;
+        }
+
+        child = parse_alternation();
+        if ( prog.result < 0 ) return -1;
+
+        if ( regex[0] != ')' ) return fail(SUBREG_RESULT_MISSING_BRACKET);
+
+        regex++;
+        depth--;
+
+        prog.nodes[index].child = child;
+
+        return index;
+    }
+
+
+    constexpr int parse_literal() noexcept
+    {
+        char rc;
+        char c;
+
+        rc = regex[0];
+        if ( rc == '\0' ) return new_node(node_kind::empty);
+
+        regex++;
+
+        if ( rc == '(' ) return parse_group();
+        if ( rc == '.' ) return new_node(node_kind::any);
+        if ( rc != '\\' ) return new_node(node_kind::character, rc);
+
+        rc = regex[0];
+        if ( rc == '\0' ) return fail(SUBREG_RESULT_INVALID_METACHARACTER);
+
+        if ( is_class(rc) )
+        {
+            regex++;
+            return new_node(node_kind::char_class, rc);
+        }
+        else if ( rc == '!' )
+        {
+            regex++;
+            rc = regex[0];
+            if ( rc == '\0' ) return fail(SUBREG_RESULT_INVALID_METACHARACTER);
+
+            regex++;
+
+            if ( rc == '\\' && !parse_non_class_metacharacter(rc) ) return -1;
+
+            return new_node(node_kind::not_character, rc);
+        }
+
+        c = '\0';
+        if ( !parse_non_class_metacharacter(c) ) return -1;
+
+        return new_node(node_kind::character, c);
+    }
+
+
+    constexpr bool parse_count(unsigned int& count) noexcept
+    {
+        if ( regex[0] < '0' || regex[0] > '9' )
+            return fail(SUBREG_RESULT_ILLEGAL_EXPRESSION), false;
+
+        for (count = 0; regex[0] >= '0' && regex[0] <= '9'; regex++)
+        {
+            count = count * 10 + static_cast<unsigned int>(regex[0] - '0');
+
+            if ( count > SUBREG_REPEAT_MAX )
+                return fail(SUBREG_RESULT_ILLEGAL_EXPRESSION), false;
+        }
+
+        return true;
+    }
+
+
+    constexpr bool is_count() const noexcept
+    {
+        const char* p = regex + 1;
+
+        /* as in PCRE, a '{' that does not start bounds is a plain character */
+        if ( p[0] < '0' || p[0] > '9' ) return false;
+        while ( p[0] >= '0' && p[0] <= '9' ) p++;
+
+        if ( p[0] == ',' )
+        {
+            p++;
+            while ( p[0] >= '0' && p[0] <= '9' ) p++;
+        }
+
+        return p[0] == '}';
+    }
+
+
+    constexpr bool parse_bounds(node& n) noexcept
+    {
+        if ( !parse_count(n.min) ) return false;
+
+        n.max = n.min;
+
+        if ( regex[0] == ',' )
+        {
+            regex++;
+
+            if ( regex[0] == '}' ) n.max = repeat_unbounded;
+            else if ( !parse_count(n.max) ) return false;
+        }
+
+        if ( regex[0] != '}' || n.max < n.min )
+            return fail(SUBREG_RESULT_ILLEGAL_EXPRESSION), false;
+
+        regex++;
+
+        return true;
+    }
+
+
+    constexpr int parse_repetition() noexcept
+    {
+        int atom;
+        int index;
+        char rc;
+
+        atom = parse_literal();
+        if ( prog.result < 0 ) return -1;
+
+        rc = regex[0];
+        if ( rc != '?' && rc != '*' && rc != '+' && (rc != '{' || !is_count()) )
+            return atom;
+
+        regex++;
+
+        index = new_node(node_kind::repeat, rc);
+        prog.nodes[index].child = atom;
+
+        if ( rc == '{' && !parse_bounds(prog.nodes[index]) ) return -1;
+
+        return index;
+    }
+
+
+    constexpr int parse_concatenation() noexcept
+    {
+        int index;
+        int last;
+
+        index = new_node(node_kind::concatenation);
+        last = -1;
+
+        do
+        {
+            int element;
+
+            if ( regex[0] == ')' ) break;
+
+            element = parse_repetition();
+            if ( prog.result < 0 ) return -1;
+
+            if ( last < 0 ) prog.nodes[index].child = element;
+            else prog.nodes[last].next = element;
+
+            last = element;
+
+        } while ( regex[0] != '\0' && regex[0] != '|' && regex[0] != '$' );
+
+        return index;
+    }
+
+
+    constexpr int parse_alternation() noexcept
+    {
+        int index;
+        int last;
+
+        index = new_node(node_kind::alternation);
+        last = -1;
+
+        for (;;)
+        {
+            int branch;
+
+            branch = parse_concatenation();
+            if ( prog.result < 0 ) return -1;
+
+            if ( last < 0 ) prog.nodes[index].child = branch;
+            else prog.nodes[last].next = branch;
+
+            last = branch;
+
+            if ( regex[0] != '|' ) break;
+            regex++;
+        }
+
+        return index;
+    }
+};
+
+
+template<std::size_t N>
+constexpr program<N> compile(const char (&regex)[N], unsigned int max_depth) noexcept
+{
+    return parser<N>(regex, static_cast<int>(max_depth)).parse();
+}
+
+
+/*
+ * Each SubReg error gets its own assertion, so that the compiler's
+ * diagnostic names the error.
+ */
+template<int Result>
+constexpr bool check_result() noexcept
+{
+    static_assert(Result != SUBREG_RESULT_ILLEGAL_EXPRESSION,
+            "SUBREG_RESULT_ILLEGAL_EXPRESSION: illegal regular expression");
+    static_assert(Result != SUBREG_RESULT_MISSING_BRACKET,
+            "SUBREG_RESULT_MISSING_BRACKET: missing closing bracket");
+    static_assert(Result != SUBREG_RESULT_INVALID_METACHARACTER,
+            "SUBREG_RESULT_INVALID_METACHARACTER: malformed \\ escape sequence");
+    static_assert(Result != SUBREG_RESULT_MAX_DEPTH_EXCEEDED,
+            "SUBREG_RESULT_MAX_DEPTH_EXCEEDED: groups nested deeper than max_depth");
+    static_assert(Result != SUBREG_RESULT_INVALID_OPTION,
+            "SUBREG_RESULT_INVALID_OPTION: invalid inline option");
+
+    return true;
+}
+
+
+struct context
+{
+    const char* input;
+
+    /* end of a length-bounded input, or nullptr if null-terminated */
+    const char* end;
+
+    subreg_capture_t* captures;
+    unsigned int max_captures;
+    unsigned int capture_index;
+    int options;
+    int error;
+
+
+    char peek() const noexcept
+    {
+        return (input == end) ? '\0' : input[0];
+    }
+};
+
+
+constexpr bool is_digit(char c) noexcept
+{
+    return (c >= '0') && (c <= '9');
+}
+
+
+constexpr bool is_class_member(char cls, char c) noexcept
+{
+    switch (cls)
+    {
+    case 'd':
+    case 'D':
+        return is_digit(c);
+
+    case 'h':
+    case 'H':
+        return is_digit(c) || ((c >= 'A') && (c <= 'F')) ||
+                ((c >= 'a') && (c <= 'f'));
+
+    case 's':
+    case 'S':
+        return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\v') ||
+                (c == '\f') || (c == '\r');
+
+    default:
+        return is_digit(c) || ((c >= 'A') && (c <= 'Z')) ||
+                ((c >= 'a') && (c <= 'z')) || (c == '_');
+    }
+}
+
+
+constexpr char fold(char c) noexcept
+{
+    return ((c >= 'a') && (c <= 'z')) ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+
+template<const auto& Prog>
+class matcher
+{
+public:
+    static int match(const char* input, const char* end,
+            subreg_capture_t captures[], unsigned int max_captures) noexcept
+    {
+        context ctx = {input, end, captures, max_captures, 1, 0, 0};
+
+        if ( !input || (max_captures > 0 && !captures) )
+            return SUBREG_RESULT_INVALID_ARGUMENT;
+
+        if ( !match_node<Prog.root>(ctx) )
+            return ctx.error ? ctx.error : SUBREG_RESULT_NO_MATCH;
+
+        if ( end ? (ctx.input != end) : (ctx.peek() != '\0') )
+            return SUBREG_RESULT_NO_MATCH;
+
+        if ( max_captures > 0 )
+        {
+            captures[0].start = input;
+            captures[0].length = static_cast<unsigned int>(ctx.input - input);
+        }
+
+        return static_cast<int>(ctx.capture_index);
+    }
+
+
+private:
+    static bool match_char(const context& ctx, char c, char rc) noexcept
+    {
+        if ( c == '\0' ) return false;
+
+        if constexpr ( Prog.uses_options )
+        {
+            if ( ctx.options & option_nocase ) return fold(c) == fold(rc);
+        }
+
+        return c == rc;
+    }
+
+
+    template<int Index>
+    static bool match_sequence(context& ctx) noexcept
+    {
+        if constexpr ( Index < 0 )
+        {
+            return true;
+        }
+        else
+        {
+            return match_node<Index>(ctx) &&
+                    match_sequence<Prog.nodes[Index].next>(ctx);
+        }
+    }
+
+
+    /* the first branch that matches wins */
+    template<int Index>
+    static bool match_branches(context& ctx, const char* begin) noexcept
+    {
+        if constexpr ( Index < 0 )
+        {
+            return false;
+        }
+        else
+        {
+            if ( match_node<Index>(ctx) ) return true;
+            if ( ctx.error ) return false;
+
+            ctx.input = begin;
+
+            return match_branches<Prog.nodes[Index].next>(ctx, begin);
+        }
+    }
+
+
+    template<int Index>
+    static bool match_group(context& ctx) noexcept
+    {
+        constexpr node n = Prog.nodes[Index];
+        const char* start;
+        int saved_options;
+        bool result;
+
+        start = ctx.input;
+        saved_options = ctx.options;
+
+        result = match_node<n.child>(ctx);
+
+        ctx.options = saved_options;
+        if ( ctx.error ) return false;
+
+        if constexpr ( n.mode == group_mode::capture )
+        {
+            if ( result && ctx.max_captures > 0 )
+            {
+                if ( ctx.capture_index + 1 > ctx.max_captures )
+                {
+                    ctx.error = SUBREG_RESULT_CAPTURE_OVERFLOW;
+                    return false;
+                }
+
+                ctx.captures[ctx.capture_index].start = start;
+                ctx.captures[ctx.capture_index].length =
+                        static_cast<unsigned int>(ctx.input - start);
+                ctx.capture_index++;
+            }
+        }
+        else if constexpr ( n.mode == group_mode::pos_look_ahead )
+        {
+            ctx.input = start;
+        }
+        else if constexpr ( n.mode == group_mode::neg_look_ahead )
+        {
+            ctx.input = start;
+            result = !result;
+        }
+
+        return result;
+    }
+
+
+    /* counted rather than unrolled, as in subreg.c */
+    template<int Index>
+    static bool match_counted(context& ctx) noexcept
+    {
+        constexpr node n = Prog.nodes[Index];
+        const char* check_point;
+        unsigned int capture_index;
+        unsigned int count;
+
+        check_point = ctx.input;
+        capture_index = ctx.capture_index;
+        count = 0;
+
+        if ( match_node<n.child>(ctx) ) count = 1;
+        else if ( ctx.error ) return false;
+
+        /* a count of zero still tries the element, but gives it back */
+        if constexpr ( n.max == 0 )
+        {
+            ctx.capture_index = capture_index;
+            count = 0;
+        }
+
+        while ( count > 0 && count < n.max )
+        {
+            /* an iteration that consumes no input would repeat identically */
+            if ( ctx.input == check_point ) return true;
+
+            check_point = ctx.input;
+
+            if ( !match_node<n.child>(ctx) )
+            {
+                if ( ctx.error ) return false;
+
+                ctx.input = check_point;
+                return count >= n.min;
+            }
+
+            count++;
+        }
+
+        if ( count == 0 ) ctx.input = check_point;
+
+        return count >= n.min;
+    }
+
+
+    /* greedy and possessive, as in subreg.c */
+    template<int Index>
+    static bool match_repeat(context& ctx) noexcept
+    {
+        constexpr node n = Prog.nodes[Index];
+        const char* check_point;
+
+        check_point = ctx.input;
+
+        if ( !match_node<n.child>(ctx) )
+        {
+            if ( ctx.error ) return false;
+            if constexpr ( n.c == '+' ) return false;
+
+            ctx.input = check_point;
+            return true;
+        }
+
+        if constexpr ( n.c != '?' )
+        {
+            /* an iteration that consumes no input would repeat forever */
+            while ( ctx.input != check_point )
+            {
+                check_point = ctx.input;
+
+                if ( !match_node<n.child>(ctx) )
+                {
+                    if ( ctx.error ) return false;
+
+                    ctx.input = check_point;
+                    break;
+                }
+            }
+        }
+
+        return true;
+    }
+
+
+    template<int Index>
+    static bool match_node(context& ctx) noexcept
+    {
+        constexpr node n = Prog.nodes[Index];
+
+        if constexpr ( n.kind == node_kind::empty )
+        {
+            return true;
+        }
+        else if constexpr ( n.kind == node_kind::character )
+        {
+            if ( !match_char(ctx, ctx.peek(), n.c) ) return false;
+        }
+        else if constexpr ( n.kind == node_kind::any )
+        {
+            if ( ctx.peek() == '\0' ) return false;
+        }
+        else if constexpr ( n.kind == node_kind::char_class )
+        {
+            if ( ctx.peek() == '\0' ) return false;
+
+            /* upper case classes are the inverse of lower case ones */
+            if constexpr ( n.c >= 'a' )
+            {
+                if ( !is_class_member(n.c, ctx.peek()) ) return false;
+            }
+            else
+            {
+                if ( is_class_member(n.c, ctx.peek()) ) return false;
+            }
+        }
+        else if constexpr ( n.kind == node_kind::not_character )
+        {
+            if ( ctx.peek() == '\0' || match_char(ctx, ctx.peek(), n.c) )
+                return false;
+        }
+        else if constexpr ( n.kind == node_kind::option )
+        {
+            if constexpr ( n.c == 'i' ) ctx.options |= option_nocase;
+            else ctx.options &= ~option_nocase;
+
+            return true;
+        }
+        else if constexpr ( n.kind == node_kind::group )
+        {
+            return match_group<Index>(ctx);
+        }
+        else if constexpr ( n.kind == node_kind::repeat && n.c == '{' )
+        {
+            return match_counted<Index>(ctx);
+        }
+        else if constexpr ( n.kind == node_kind::repeat )
+        {
+            return match_repeat<Index>(ctx);
+        }
+        else if constexpr ( n.kind == node_kind::concatenation )
+        {
+            return match_sequence<n.child>(ctx);
+        }
+        else
+        {
+            return match_branches<n.child>(ctx, ctx.input);
+        }
+
+        ctx.input++;
+
+        return true;
+    }
+};
+
+
+template<fixed_string Regex, unsigned int MaxDepth>
+inline constexpr auto compiled = compile(Regex.data, MaxDepth);
+
+
+constexpr const char* result_name(int result) noexcept
+{
+    switch (result)
+    {
+    case SUBREG_RESULT_INVALID_IMAGE:           return "SUBREG_RESULT_INVALID_IMAGE";
+    case SUBREG_RESULT_INVALID_OPTION:          return "SUBREG_RESULT_INVALID_OPTION";
+    case SUBREG_RESULT_CAPTURE_OVERFLOW:        return "SUBREG_RESULT_CAPTURE_OVERFLOW";
+    case SUBREG_RESULT_MAX_DEPTH_EXCEEDED:      return "SUBREG_RESULT_MAX_DEPTH_EXCEEDED";
+    case SUBREG_RESULT_INVALID_METACHARACTER:   return "SUBREG_RESULT_INVALID_METACHARACTER";
+    case SUBREG_RESULT_SURPLUS_BRACKET:         return "SUBREG_RESULT_SURPLUS_BRACKET";
+    case SUBREG_RESULT_MISSING_BRACKET:         return "SUBREG_RESULT_MISSING_BRACKET";
+    case SUBREG_RESULT_ILLEGAL_EXPRESSION:      return "SUBREG_RESULT_ILLEGAL_EXPRESSION";
+    case SUBREG_RESULT_INVALID_ARGUMENT:        return "SUBREG_RESULT_INVALID_ARGUMENT";
+    default:                                    return "SubReg error";
+    }
+}
+
+
+/* a default constructed std::string_view has no data, but is still "" */
+inline const char* input_data(std::string_view input) noexcept
+{
+    return input.data() ? input.data() : "";
+}
+
+} /* namespace detail */
+
+
+/**
+ * Exception thrown by the std::string_view interfaces when SubReg reports
+ * an error.
+ */
+class error : public std::runtime_error
+{
+public:
+    explicit error(int code) :
+        std::runtime_error(detail::result_name(code)), result(code)
+    {
+    }
+
+
+    /**
+     * Returns the error's SUBREG_RESULT_* code.
+     */
+    int code() const noexcept
+    {
+        return result;
+    }
+
+
+private:
+    int result;
+};
+
+
+namespace detail
+{
+
+/*
+ * Runs match, which fills in up to max_captures SubReg captures, and
+ * converts its result into std::string_view captures.
+ */
+template<typename Match>
+std::span<std::string_view> match_views(std::span<std::string_view> captures,
+        Match match)
+{
+    subreg_capture_t buffer[SUBREG_HPP_MAX_CAPTURES];
+    unsigned int max_captures;
+    int result;
+
+    max_captures = (captures.size() < SUBREG_HPP_MAX_CAPTURES) ?
+            static_cast<unsigned int>(captures.size()) : SUBREG_HPP_MAX_CAPTURES;
+
+    result = match(buffer, max_captures);
+    if ( result < 0 ) throw error(result);
+
+    if ( max_captures == 0 ) return captures.first(0);
+
+    for (int i = 0; i < result; i++)
+        captures[i] = std::string_view(buffer[i].start, buffer[i].length);
+
+    return captures.first(static_cast<std::size_t>(result));
+}
+
+} /* namespace detail */
+
+
+/**
+ * Checks a regular expression in a constant expression.
+ *
+ * \param regex         Null-terminated string containing regular expression.
+ *
+ * \param max_depth     Maximum nesting depth of groups.
+ *
+ * \return              SUBREG_RESULT_NO_MATCH if the regular expression is
+ *                      valid, otherwise the error subreg_match() would
+ *                      report for it (see SUBREG_RESULT_* macros).
+ */
+template<std::size_t N>
+constexpr int validate(const char (&regex)[N], unsigned int max_depth = 4) noexcept
+{
+    return detail::compile(regex, max_depth).result;
+}
+
+
+/**
+ * Matcher for a regular expression fixed at compile time.
+ *
+ * \tparam Regex        Regular expression, as a string literal.
+ *
+ * \tparam MaxDepth     Maximum nesting depth of groups.
+ */
+template<fixed_string Regex, unsigned int MaxDepth = 4>
+class pattern
+{
+    static_assert(detail::check_result<detail::compiled<Regex, MaxDepth>.result>());
+
+public:
+    /**
+     * Returns the regular expression.
+     */
+    static constexpr const char* regex() noexcept
+    {
+        return Regex.data;
+    }
+
+
+    /**
+     * Matches input string against the regular expression. Arguments and
+     * return value are as for subreg_match().
+     */
+    static int match(const char* input, subreg_capture_t captures[] = nullptr,
+            unsigned int max_captures = 0) noexcept
+    {
+        return match_range(input, nullptr, captures, max_captures);
+    }
+
+
+    /**
+     * As above, but input need not be null-terminated.
+     */
+    static int match(std::string_view input, subreg_capture_t captures[] = nullptr,
+            unsigned int max_captures = 0) noexcept
+    {
+        const char* data;
+
+        data = detail::input_data(input);
+
+        return match_range(data, data + input.size(), captures, max_captures);
+    }
+
+
+    /**
+     * Matches input string against the regular expression, storing captures
+     * in caller storage.
+     *
+     * \return              The captures made, the first being the entire
+     *                      input, or an empty span if input does not match.
+     *
+     * \throws subreg::error if there are more captures than captures has
+     *                      room for.
+     */
+    static std::span<std::string_view> match(std::string_view input,
+            std::span<std::string_view> captures)
+    {
+        return detail::match_views(captures,
+            [input](subreg_capture_t* buffer, unsigned int max_captures)
+            {
+                return match(input, buffer, max_captures);
+            });
+    }
+
+
+private:
+    static int match_range(const char* input, const char* end,
+            subreg_capture_t captures[], unsigned int max_captures) noexcept
+    {
+        constexpr const auto& prog = detail::compiled<Regex, MaxDepth>;
+
+        /* an invalid regular expression has already failed to compile */
+        if constexpr ( prog.result < 0 ) return prog.result;
+        else return detail::matcher<prog>::match(input, end, captures, max_captures);
+    }
+};
+
+
+/**
+ * Matches input string against a regular expression fixed at compile time.
+ * Arguments and return value are as for subreg_match().
+ */
+template<fixed_string Regex, unsigned int MaxDepth = 4>
+int match(const char* input, subreg_capture_t captures[] = nullptr,
+        unsigned int max_captures = 0) noexcept
+{
+    return pattern<Regex, MaxDepth>::match(input, captures, max_captures);
+}
+
+
+/**
+ * As above, but input need not be null-terminated.
+ */
+template<fixed_string Regex, unsigned int MaxDepth = 4>
+int match(std::string_view input, subreg_capture_t captures[] = nullptr,
+        unsigned int max_captures = 0) noexcept
+{
+    return pattern<Regex, MaxDepth>::match(input, captures, max_captures);
+}
+
+
+/**
+ * Regular expression validated at run time. Construction copies and
+ * validates the regular expression once, after which matching does no
+ * allocation.
+ */
+class regex
+{
+public:
+    /**
+     * \param pattern       Regular expression.
+     *
+     * \param max_depth     Maximum nesting depth of groups.
+     *
+     * \throws subreg::error if the regular expression is invalid.
+     */
+    explicit regex(std::string_view pattern, unsigned int max_depth = 4) :
+        source_(pattern), max_depth_(max_depth)
+    {
+        subreg_cost_t cost;
+        int result;
+
+        if ( source_.find('\0') != std::string::npos )
+            throw error(SUBREG_RESULT_ILLEGAL_EXPRESSION);
+
+        result = subreg_analyze(source_.c_str(), max_depth, &cost);
+        if ( result < 0 ) throw error(result);
+    }
+
+
+    /**
+     * Returns the regular expression.
+     */
+    const std::string& source() const noexcept
+    {
+        return source_;
+    }
+
+
+    /**
+     * Returns the maximum nesting depth of groups.
+     */
+    unsigned int max_depth() const noexcept
+    {
+        return max_depth_;
+    }
+
+
+    /**
+     * Matches input string against the regular expression, storing captures
+     * in caller storage.
+     *
+     * \return              The captures made, the first being the entire
+     *                      input, or an empty span if input does not match.
+     *
+     * \throws subreg::error if there are more captures than captures has
+     *                      room for.
+     */
+    std::span<std::string_view> match(std::string_view input,
+            std::span<std::string_view> captures) const
+    {
+        return detail::match_views(captures,
+            [this, input](subreg_capture_t* buffer, unsigned int max_captures)
+            {
+                return match_raw(input, buffer, max_captures);
+            });
+    }
+
+
+    /**
+     * Returns true if input matches the regular expression.
+     */
+    bool matches(std::string_view input) const
+    {
+        int result;
+
+        result = match_raw(input, nullptr, 0);
+        if ( result < 0 ) throw error(result);
+
+        return result > 0;
+    }
+
+
+private:
+    std::string source_;
+    unsigned int max_depth_;
+
+
+    int match_raw(std::string_view input, subreg_capture_t captures[],
+            unsigned int max_captures) const
+    {
+        if ( input.size() > UINT_MAX ) throw error(SUBREG_RESULT_INVALID_ARGUMENT);
+
+        return subreg_match_n(source_.c_str(), detail::input_data(input),
+                static_cast<unsigned int>(input.size()), captures, max_captures,
+                max_depth_);
+    }
+};
+
+
+/**
+ * Captures of a successful regex_match(), in the style of std::match_results.
+ */
+class match_results
+{
+public:
+    using value_type = std::string_view;
+    using const_iterator = const std::string_view*;
+    using iterator = const_iterator;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+
+    bool empty() const noexcept
+    {
+        return count == 0;
+    }
+
+
+    size_type size() const noexcept
+    {
+        return count;
+    }
+
+
+    /**
+     * Returns capture n, or an empty view if there is no such capture.
+     */
+    std::string_view operator[](size_type n) const noexcept
+    {
+        return (n < count) ? captures[n] : std::string_view();
+    }
+
+
+    std::string str(size_type n = 0) const
+    {
+        return std::string((*this)[n]);
+    }
+
+
+    difference_type position(size_type n = 0) const noexcept
+    {
+        return (n < count) ? captures[n].data() - captures[0].data() : -1;
+    }
+
+
+    difference_type length(size_type n = 0) const noexcept
+    {
+        return static_cast<difference_type>((*this)[n].size());
+    }
+
+
+    const_iterator begin() const noexcept
+    {
+        return captures;
+    }
+
+
+    const_iterator end() const noexcept
+    {
+        return captures + count;
+    }
+
+
+private:
+    std::string_view captures[SUBREG_HPP_MAX_CAPTURES];
+    size_type count = 0;
+
+    friend bool regex_match(std::string_view input, match_results& m,
+            const regex& re);
+};
+
+
+/**
+ * As std::regex_match(), returns true if the whole of input matches re,
+ * storing its captures in m.
+ *
+ * \throws subreg::error if there are more than SUBREG_HPP_MAX_CAPTURES
+ *                      captures.
+ */
+inline bool regex_match(std::string_view input, match_results& m, const regex& re)
+{
+    m.count = re.match(input, m.captures).size();
+    return m.count > 0;
+}
+
+
+/**
+ * As std::regex_match(), returns true if the whole of input matches re.
+ */
+inline bool regex_match(std::string_view input, const regex& re)
+{
+    return re.matches(input);
+}
+
+
+inline bool regex_match(const char* input, match_results& m, const regex& re)
+{
+    return regex_match(std::string_view(input), m, re);
+}
+
+
+/* as with std::regex_match(), captures must not refer to a temporary */
+bool regex_match(std::string&&, match_results&, const regex&) = delete;
+
+} /* namespace subreg */
+
+#endif /* _SUBREG_HPP_ */
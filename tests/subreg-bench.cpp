@@ -0,0 +1,284 @@
+/**
+ * SubReg - A small footprint regular expression engine written in ANSI C.
+ *
+ * https://github.com/mattbucknall/subreg
+ *
+ * Copyright (c) 2016-2021 Matthew T. Bucknall
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISIN
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Benchmarks std::regex_match() against SubReg's C and C++ interfaces on
+ * the same patterns and corpus, after checking that they all agree.
+ *
+ * Usage:
+ *   subreg-bench [-n iterations]
+ *
+ * SubReg's repetition is possessive, so the patterns are ones for which
+ * that makes no difference.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <subreg.hpp>
+
+
+#define MAX_CAPTURES            4
+
+#define PATTERN(regex)          { regex, subreg::pattern<regex>::match }
+
+
+struct pattern_entry
+{
+    const char* regex;
+    std::span<std::string_view> (*match)(std::string_view input,
+            std::span<std::string_view> captures);
+};
+
+
+static const pattern_entry PATTERNS[] =
+{
+    PATTERN("(\\d+)\\.(\\d+)\\.(\\d+)"),
+    PATTERN("GET|HEAD|POST|PUT|DELETE"),
+    PATTERN("(\\w+)@(\\w+)\\.(?:com|org|net)"),
+    PATTERN("(\\w+)=(\\w*)"),
+    PATTERN("\\d+\\.\\d+\\.\\d+\\.\\d+"),
+    PATTERN("Content-Length: (\\d+)")
+};
+
+
+static const char* const CORPUS[] =
+{
+    "1.2.3", "10.20.30", "1.2", "1.2.3.4", "v1.2.3", "192.168.0.1",
+    "GET", "POST", "PATCH", "DELETE", "get",
+    "someone@example.com", "someone@example.co.uk", "@example.com",
+    "key=value", "key=", "=value", "key=value=more",
+    "Content-Length: 1024", "Content-Length: ", "Content-Type: text/plain",
+    "the quick brown fox jumps over the lazy dog"
+};
+
+
+/* plain characters and '.' only, so every atom takes the literal path */
+static const char* const LITERAL_PATTERNS[] =
+{
+    "Content-Length: 1024",
+    "GET /index.html HTTP/1.1",
+    "..:..:..",
+    "192.168.0.1"
+};
+
+
+static const char* const LITERAL_CORPUS[] =
+{
+    "Content-Length: 1024", "Content-Length: 2048", "Content-Type: text/html",
+    "GET /index.html HTTP/1.1", "GET /index.html HTTP/1.0", "GET /",
+    "12:34:56", "12:34", "192.168.0.1", "192.168.0.10"
+};
+
+
+#define NUM_PATTERNS            (sizeof(PATTERNS) / sizeof(PATTERNS[0]))
+#define NUM_INPUTS              (sizeof(CORPUS) / sizeof(CORPUS[0]))
+
+#define NUM_LITERAL_PATTERNS    (sizeof(LITERAL_PATTERNS) / sizeof(LITERAL_PATTERNS[0]))
+#define NUM_LITERAL_INPUTS      (sizeof(LITERAL_CORPUS) / sizeof(LITERAL_CORPUS[0]))
+
+
+typedef std::chrono::steady_clock bench_clock;
+
+
+static double elapsed_ns(bench_clock::time_point start, unsigned long calls)
+{
+    std::chrono::duration<double, std::nano> elapsed;
+
+    elapsed = bench_clock::now() - start;
+
+    return elapsed.count() / static_cast<double>(calls);
+}
+
+
+int main(int argc, char* argv[])
+{
+    std::regex std_regexes[NUM_PATTERNS];
+    std::regex std_literals[NUM_LITERAL_PATTERNS];
+    std::vector<subreg::regex> subreg_regexes;
+    std::string inputs[NUM_INPUTS];
+    std::string_view capture_storage[MAX_CAPTURES];
+    std::span<std::string_view> captures(capture_storage);
+    subreg_capture_t c_captures[MAX_CAPTURES];
+    subreg::match_results m;
+    std::smatch sm;
+    bench_clock::time_point start;
+    unsigned long iterations;
+    unsigned long calls;
+    unsigned long matches;
+    unsigned long i;
+    unsigned int p;
+    unsigned int j;
+    int failed;
+
+    iterations = 10000;
+
+    if ( argc == 3 && std::strcmp(argv[1], "-n") == 0 )
+        iterations = std::strtoul(argv[2], nullptr, 0);
+    else if ( argc != 1 )
+    {
+        std::fprintf(stderr, "usage: %s [-n iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (j = 0; j < NUM_INPUTS; j++) inputs[j] = CORPUS[j];
+
+    for (p = 0; p < NUM_PATTERNS; p++)
+    {
+        std_regexes[p] = std::regex(PATTERNS[p].regex);
+        subreg_regexes.emplace_back(PATTERNS[p].regex);
+    }
+
+    for (p = 0; p < NUM_LITERAL_PATTERNS; p++)
+        std_literals[p] = std::regex(LITERAL_PATTERNS[p]);
+
+    /* results are only worth comparing if they are the same */
+    failed = 0;
+
+    for (p = 0; p < NUM_PATTERNS; p++)
+    {
+        for (j = 0; j < NUM_INPUTS; j++)
+        {
+            bool expected;
+            bool ok;
+
+            expected = std::regex_match(inputs[j], sm, std_regexes[p]);
+            ok = (subreg::regex_match(inputs[j], m, subreg_regexes[p]) == expected);
+            ok = ok && (PATTERNS[p].match(inputs[j], captures).empty() != expected);
+            ok = ok && ((subreg_match(PATTERNS[p].regex, inputs[j].c_str(),
+                    c_captures, MAX_CAPTURES, 4) > 0) == expected);
+
+            for (i = 0; ok && expected && i < sm.size(); i++)
+                ok = (sm.str(i) == m.str(i));
+
+            if ( !ok )
+            {
+                std::fprintf(stderr, "disagreement: \"%s\" on \"%s\"\n",
+                        PATTERNS[p].regex, CORPUS[j]);
+                failed = 1;
+            }
+        }
+    }
+
+    for (p = 0; p < NUM_LITERAL_PATTERNS; p++)
+    {
+        for (j = 0; j < NUM_LITERAL_INPUTS; j++)
+        {
+            if ( std::regex_match(LITERAL_CORPUS[j], std_literals[p]) !=
+                    (subreg_match(LITERAL_PATTERNS[p], LITERAL_CORPUS[j],
+                    nullptr, 0, 4) > 0) )
+            {
+                std::fprintf(stderr, "disagreement: \"%s\" on \"%s\"\n",
+                        LITERAL_PATTERNS[p], LITERAL_CORPUS[j]);
+                failed = 1;
+            }
+        }
+    }
+
+    if ( failed ) return EXIT_FAILURE;
+
+    calls = iterations * NUM_PATTERNS * NUM_INPUTS;
+    std::printf("%lu calls per engine\n", calls);
+
+    start = bench_clock::now();
+    matches = 0;
+
+    for (i = 0; i < iterations; i++)
+        for (p = 0; p < NUM_PATTERNS; p++)
+            for (j = 0; j < NUM_INPUTS; j++)
+                matches += std::regex_match(inputs[j], sm, std_regexes[p]);
+
+    std::printf("%-34s %8.1f ns/match (%lu matched)\n", "std::regex_match",
+            elapsed_ns(start, calls), matches);
+
+    start = bench_clock::now();
+    matches = 0;
+
+    for (i = 0; i < iterations; i++)
+        for (p = 0; p < NUM_PATTERNS; p++)
+            for (j = 0; j < NUM_INPUTS; j++)
+                matches += subreg_match(PATTERNS[p].regex, inputs[j].c_str(),
+                        c_captures, MAX_CAPTURES, 4) > 0;
+
+    std::printf("%-34s %8.1f ns/match (%lu matched)\n", "subreg_match",
+            elapsed_ns(start, calls), matches);
+
+    start = bench_clock::now();
+    matches = 0;
+
+    for (i = 0; i < iterations; i++)
+        for (p = 0; p < NUM_PATTERNS; p++)
+            for (j = 0; j < NUM_INPUTS; j++)
+                matches += subreg::regex_match(inputs[j], m, subreg_regexes[p]);
+
+    std::printf("%-34s %8.1f ns/match (%lu matched)\n", "subreg::regex_match",
+            elapsed_ns(start, calls), matches);
+
+    start = bench_clock::now();
+    matches = 0;
+
+    for (i = 0; i < iterations; i++)
+        for (p = 0; p < NUM_PATTERNS; p++)
+            for (j = 0; j < NUM_INPUTS; j++)
+                matches += !PATTERNS[p].match(inputs[j], captures).empty();
+
+    std::printf("%-34s %8.1f ns/match (%lu matched)\n", "subreg::pattern<...>::match",
+            elapsed_ns(start, calls), matches);
+
+    /* the literal path on its own, with no groups, escapes or repetition */
+    calls = iterations * NUM_LITERAL_PATTERNS * NUM_LITERAL_INPUTS;
+    std::printf("\n%lu calls per engine on literal patterns\n", calls);
+
+    start = bench_clock::now();
+    matches = 0;
+
+    for (i = 0; i < iterations; i++)
+        for (p = 0; p < NUM_LITERAL_PATTERNS; p++)
+            for (j = 0; j < NUM_LITERAL_INPUTS; j++)
+                matches += std::regex_match(LITERAL_CORPUS[j], std_literals[p]);
+
+    std::printf("%-34s %8.1f ns/match (%lu matched)\n", "std::regex_match",
+            elapsed_ns(start, calls), matches);
+
+    start = bench_clock::now();
+    matches = 0;
+
+    for (i = 0; i < iterations; i++)
+        for (p = 0; p < NUM_LITERAL_PATTERNS; p++)
+            for (j = 0; j < NUM_LITERAL_INPUTS; j++)
+                matches += subreg_match(LITERAL_PATTERNS[p], LITERAL_CORPUS[j],
+                        nullptr, 0, 4) > 0;
+
+    std::printf("%-34s %8.1f ns/match (%lu matched)\n", "subreg_match",
+            elapsed_ns(start, calls), matches);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,478 @@
+/**
+ * SubReg - A small footprint regular expression engine written in ANSI C.
+ *
+ * https://github.com/mattbucknall/subreg
+ *
+ * Copyright (c) 2016-2021 Matthew T. Bucknall
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISIN
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Performance fuzzer. Generates random regular expressions and inputs,
+ * measures matcher steps per input character and keeps the worst pairs,
+ * minimised, as regression cases. Every generated pair is also checked
+ * against the bound computed by subreg_analyze(), and against the result
+ * of a matcher, whose plan may not use the interpreter at all.
+ *
+ * Usage:
+ *   subreg-fuzz [-s seed] [-n iterations] [-k keep] [-o cases-file]
+ *   subreg-fuzz -c cases-file
+ *
+ * The second form replays saved cases and fails if any of them takes more
+ * steps, or gives a different result, than when it was saved.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <subreg.h>
+
+
+#define MAX_DEPTH               6
+#define MAX_REGEX_LENGTH        48
+#define MAX_INPUT_LENGTH        256
+#define MAX_KEEP                64
+#define MAX_LINE_LENGTH         1024
+
+
+typedef struct
+{
+    char regex[MAX_REGEX_LENGTH + 1];
+    char input[MAX_INPUT_LENGTH + 1];
+    unsigned long steps;
+    int result;
+    double ratio;
+
+} fuzz_case_t;
+
+
+static unsigned long rng_state;
+
+
+static unsigned int rng(unsigned int range)
+{
+    /* xorshift, reproducible across platforms for a given seed */
+    rng_state ^= (rng_state << 13) & 0xFFFFFFFFUL;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= (rng_state << 5) & 0xFFFFFFFFUL;
+
+    return (unsigned int) (rng_state % range);
+}
+
+
+static void append(char* buffer, const char* str)
+{
+    if ( strlen(buffer) + strlen(str) <= MAX_REGEX_LENGTH ) strcat(buffer, str);
+}
+
+
+static void generate_alternation(char* regex, int depth);
+
+
+static void generate_atom(char* regex, int depth)
+{
+    static const char* atoms[] =
+    {
+        "a", "b", "x", " ", ".", "\\d", "\\w", "\\s", "\\D", "\\!a", "(?i)"
+    };
+
+    static const char* groups[] = {"(", "(?:", "(?=", "(?!"};
+    char count[16];
+    unsigned int min;
+
+    if ( depth < MAX_DEPTH && rng(4) == 0 )
+    {
+        append(regex, groups[rng(4)]);
+        generate_alternation(regex, depth + 1);
+        append(regex, ")");
+    }
+    else
+    {
+        append(regex, atoms[rng(sizeof(atoms) / sizeof(atoms[0]))]);
+    }
+
+    count[0] = '\0';
+    min = rng(4);
+
+    switch (rng(9))
+    {
+    case 0: append(regex, "*"); break;
+    case 1: append(regex, "+"); break;
+    case 2: append(regex, "?"); break;
+    case 3: sprintf(count, "{%u}", min); break;
+    case 4: sprintf(count, "{%u,}", min); break;
+    case 5: sprintf(count, "{%u,%u}", min, min + rng(4)); break;
+    }
+
+    append(regex, count);
+}
+
+
+static void generate_alternation(char* regex, int depth)
+{
+    unsigned int branches;
+    unsigned int atoms;
+
+    branches = 1 + (rng(3) == 0 ? rng(3) : 0);
+
+    while ( branches-- )
+    {
+        for (atoms = 1 + rng(4); atoms > 0; atoms--)
+            generate_atom(regex, depth);
+
+        if ( branches ) append(regex, "|");
+    }
+}
+
+
+static void generate_input(char* input)
+{
+    static const char alphabet[] = "abx 1";
+    char unit[8];
+    unsigned int unit_length;
+    unsigned int length;
+    unsigned int i;
+
+    /* repeating a short unit gives repetitions something to chew on */
+    unit_length = 1 + rng(sizeof(unit) - 1);
+
+    for (i = 0; i < unit_length; i++)
+        unit[i] = alphabet[rng(sizeof(alphabet) - 1)];
+
+    length = 16 + rng(MAX_INPUT_LENGTH - 16);
+
+    for (i = 0; i < length; i++)
+        input[i] = rng(16) ? unit[i % unit_length] :
+                alphabet[rng(sizeof(alphabet) - 1)];
+
+    input[length] = '\0';
+}
+
+
+static int measure(fuzz_case_t* fc)
+{
+    unsigned long arena[1024];
+    subreg_stats_t stats;
+    subreg_cost_t cost;
+    subreg_matcher_t matcher;
+
+    if ( subreg_analyze(fc->regex, MAX_DEPTH, &cost) != 0 ) return 0;
+
+    subreg_stats_init(&stats);
+    fc->result = subreg_match_stats(&stats, fc->regex, fc->input, NULL, 0,
+            MAX_DEPTH);
+
+    fc->steps = stats.steps;
+    fc->ratio = (double) stats.steps / (double) (strlen(fc->input) + 1);
+
+    if ( stats.steps > subreg_cost_steps(&cost, strlen(fc->input)) )
+    {
+        fprintf(stderr, "step bound violated: \"%s\" \"%s\"\n", fc->regex,
+                fc->input);
+        exit(EXIT_FAILURE);
+    }
+
+    /* whichever plan the matcher picks must give the interpreter's result */
+    if ( subreg_matcher_init(&matcher, fc->regex, MAX_DEPTH, arena,
+            sizeof(arena)) == 0 &&
+            subreg_matcher_match(&matcher, fc->input, NULL, 0) != fc->result )
+    {
+        fprintf(stderr, "plans disagree: \"%s\" \"%s\"\n", fc->regex,
+                fc->input);
+        exit(EXIT_FAILURE);
+    }
+
+    return 1;
+}
+
+
+static void minimise_string(fuzz_case_t* fc, char* str, double ratio)
+{
+    fuzz_case_t trial;
+    size_t i;
+
+    /* greedily drop characters for as long as the case stays as slow */
+    for (i = 0; str[i]; )
+    {
+        char removed;
+
+        removed = str[i];
+        memmove(&str[i], &str[i + 1], strlen(&str[i + 1]) + 1);
+
+        trial = *fc;
+
+        if ( measure(&trial) && trial.ratio >= ratio ) continue;
+
+        memmove(&str[i + 1], &str[i], strlen(&str[i]) + 1);
+        str[i] = removed;
+        i++;
+    }
+}
+
+
+static void minimise(fuzz_case_t* fc)
+{
+    double ratio;
+
+    ratio = fc->ratio;
+
+    minimise_string(fc, fc->regex, ratio);
+    minimise_string(fc, fc->input, ratio);
+    measure(fc);
+}
+
+
+static void keep_case(fuzz_case_t* worst, unsigned int* num_worst,
+        unsigned int keep, const fuzz_case_t* fc)
+{
+    unsigned int victim;
+    unsigned int i;
+
+    for (i = 0; i < *num_worst; i++)
+        if ( strcmp(worst[i].regex, fc->regex) == 0 ) break;
+
+    if ( i < *num_worst )
+    {
+        if ( fc->ratio > worst[i].ratio ) worst[i] = *fc;
+        return;
+    }
+
+    if ( *num_worst < keep )
+    {
+        worst[(*num_worst)++] = *fc;
+        return;
+    }
+
+    for (i = 1, victim = 0; i < *num_worst; i++)
+        if ( worst[i].ratio < worst[victim].ratio ) victim = i;
+
+    if ( fc->ratio > worst[victim].ratio ) worst[victim] = *fc;
+}
+
+
+static void write_string(FILE* file, const char* str)
+{
+    fputc('"', file);
+
+    for (; *str; str++)
+    {
+        if ( *str == '"' || *str == '\\' ) fprintf(file, "\\%c", *str);
+        else if ( *str < 0x20 || *str > 0x7E )
+            fprintf(file, "\\x%02X", (unsigned char) *str);
+        else fputc(*str, file);
+    }
+
+    fputc('"', file);
+}
+
+
+static const char* read_string(const char* line, char* str, size_t size)
+{
+    size_t length;
+
+    while ( *line == ' ' ) line++;
+    if ( *line++ != '"' ) return NULL;
+
+    for (length = 0; *line && *line != '"'; line++)
+    {
+        char c;
+
+        c = *line;
+
+        if ( c == '\\' )
+        {
+            unsigned int code;
+
+            line++;
+
+            if ( *line == 'x' && sscanf(line + 1, "%2x", &code) == 1 )
+            {
+                c = (char) code;
+                line += 2;
+            }
+            else if ( *line ) c = *line;
+            else return NULL;
+        }
+
+        if ( length + 1 >= size ) return NULL;
+        str[length++] = c;
+    }
+
+    if ( *line != '"' ) return NULL;
+
+    str[length] = '\0';
+
+    return line + 1;
+}
+
+
+static int compare_cases(const void* a, const void* b)
+{
+    double ra;
+    double rb;
+
+    ra = ((const fuzz_case_t*) a)->ratio;
+    rb = ((const fuzz_case_t*) b)->ratio;
+
+    return (ra < rb) - (ra > rb);
+}
+
+
+static int fuzz(unsigned long seed, unsigned long iterations,
+        unsigned int keep, const char* output)
+{
+    static fuzz_case_t worst[MAX_KEEP];
+    unsigned int num_worst;
+    unsigned long i;
+    FILE* file;
+
+    rng_state = seed ? seed : 1;
+    num_worst = 0;
+
+    for (i = 0; i < iterations; i++)
+    {
+        fuzz_case_t fc;
+
+        fc.regex[0] = '\0';
+        generate_alternation(fc.regex, 0);
+        generate_input(fc.input);
+
+        if ( measure(&fc) ) keep_case(worst, &num_worst, keep, &fc);
+    }
+
+    for (i = 0; i < num_worst; i++) minimise(&worst[i]);
+
+    qsort(worst, num_worst, sizeof(worst[0]), compare_cases);
+
+    file = output ? fopen(output, "w") : stdout;
+
+    if ( !file )
+    {
+        perror(output);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(file, "# subreg-fuzz -s %lu -n %lu\n", seed, iterations);
+    fprintf(file, "# steps result regex input (%% steps per input character)\n");
+
+    for (i = 0; i < num_worst; i++)
+    {
+        fprintf(file, "%lu %d ", worst[i].steps, worst[i].result);
+        write_string(file, worst[i].regex);
+        fputc(' ', file);
+        write_string(file, worst[i].input);
+        fprintf(file, " %% %.1f\n", worst[i].ratio);
+    }
+
+    if ( output ) fclose(file);
+
+    return EXIT_SUCCESS;
+}
+
+
+static int replay(const char* path)
+{
+    char line[MAX_LINE_LENGTH];
+    unsigned int num_cases;
+    unsigned int num_failed;
+    FILE* file;
+
+    file = fopen(path, "r");
+
+    if ( !file )
+    {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+
+    num_cases = 0;
+    num_failed = 0;
+
+    while ( fgets(line, sizeof(line), file) )
+    {
+        fuzz_case_t expected;
+        fuzz_case_t fc;
+        const char* p;
+        int consumed;
+
+        if ( line[0] == '#' || line[0] == '\n' ) continue;
+
+        if ( sscanf(line, "%lu %d%n", &expected.steps, &expected.result,
+                &consumed) != 2 ||
+                !(p = read_string(line + consumed, fc.regex, sizeof(fc.regex))) ||
+                !read_string(p, fc.input, sizeof(fc.input)) )
+        {
+            fprintf(stderr, "%s: malformed line: %s", path, line);
+            fclose(file);
+            return EXIT_FAILURE;
+        }
+
+        num_cases++;
+
+        if ( !measure(&fc) || fc.result != expected.result ||
+                fc.steps > expected.steps )
+        {
+            num_failed++;
+            fprintf(stderr, "regression: \"%s\" took %lu steps (expected "
+                    "<= %lu) and returned %d (expected %d)\n", fc.regex,
+                    fc.steps, expected.steps, fc.result, expected.result);
+        }
+    }
+
+    fclose(file);
+
+    printf("%u of %u cases passed\n", num_cases - num_failed, num_cases);
+
+    return num_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+int main(int argc, char* argv[])
+{
+    unsigned long seed;
+    unsigned long iterations;
+    unsigned int keep;
+    const char* output;
+    int i;
+
+    seed = 1;
+    iterations = 100000;
+    keep = 16;
+    output = NULL;
+
+    for (i = 1; i + 1 < argc; i += 2)
+    {
+        if ( strcmp(argv[i], "-c") == 0 ) return replay(argv[i + 1]);
+        else if ( strcmp(argv[i], "-s") == 0 ) seed = strtoul(argv[i + 1], NULL, 0);
+        else if ( strcmp(argv[i], "-n") == 0 ) iterations = strtoul(argv[i + 1], NULL, 0);
+        else if ( strcmp(argv[i], "-k") == 0 ) keep = (unsigned int) strtoul(argv[i + 1], NULL, 0);
+        else if ( strcmp(argv[i], "-o") == 0 ) output = argv[i + 1];
+        else break;
+    }
+
+    if ( i < argc || keep == 0 || keep > MAX_KEEP )
+    {
+        fprintf(stderr, "usage: %s [-s seed] [-n iterations] [-k keep] "
+                "[-o cases-file]\n       %s -c cases-file\n", argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    return fuzz(seed, iterations, keep, output);
+}
@@ -0,0 +1,186 @@
+/**
+ * SubReg - A small footprint regular expression engine written in ANSI C.
+ *
+ * https://github.com/mattbucknall/subreg
+ *
+ * Copyright (c) 2016-2021 Matthew T. Bucknall
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISIN
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Checks that every function generated by subreg-gen from
+ * subreg-gen-vectors.txt behaves exactly like subreg_match() with the same
+ * regular expression, including results, captures and errors.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <cutest.h>
+#include <subreg.h>
+#include "subreg-gen-vectors.h"
+
+
+#define MAX_DEPTH               4
+#define MAX_CAPTURES            4
+
+
+/* inputs used by subreg-tests.c */
+static const char* const CORPUS[] =
+{
+    "", "!", "!!!!", "1", "1234", "A", "AB", "ABAB", "ABC", "ABCD",
+    "AbCdEfGhIjKlMnOpQrStUvWxYz0123456789", "BAACAACAAD", "BAACAAD", "BAAD",
+    "CD", "CDC", "CDCD", "\b", "\f", "\n", "\r", "\t", "\v", "a", "abcd",
+    "abcdefghijklmnopqrstuvwxyz0123456789", "b", "bar", "barfoofoo", "bcd",
+    "bcda", "c", "d", "first SECOND THIRD", "first SECOND third",
+    "first SeCoNd third", "foo bar", "foo", "foo\"test\"bar", "foofoofoo",
+    "goodbye", "hello world", "hello", "test", "testtest", "x",
+
+    /* and a few more for the edge cases in subreg-gen-vectors.txt */
+    "|", "a|", "||", "ab", "aB", "Ab", "bB", "BB", "AB", "!b", "Ab",
+    "xyz", "aab", "ba", "aaaa", "me@example.com", "me@example.net",
+    "abc", "aBC", "AbC", "abx", "de", "dE", "cD", "axc", "AXC", "bc", "Bc",
+    "xxyy1!", "yy", "a\n", "abbbd", "aBbX", "Xyz", "abd", "ax", "aX", "xz",
+    "xyz", "12.5", "12", "12.", "ac", "aD", "AC", "GET /api/v1/users",
+    "GET /api/v1/items", "GET /api/v1/", "GET /api/v1/itemsx", "PUT", "PATCH",
+    "PATC", "OPTIONS", "CONNECT", "TRACE", "HEAD", "DELETEX", "9", "q", "Q",
+    "y", "xy", "_", "B", "z", "e", "f", "g", "h", "x y\tz#", "GETX", "G",
+    "GE", "ETA", "Zetas", "thetass", "THETA", "epsilo", "hb", "abb", "xnine",
+    "xeight", "x!!", "xninex", "xONE", "deadbeef-1234", "DEADBEEF-12345",
+    "aac", "aabbcc", "aabbbc", "ababab", "abaab", "aaab", "bby", "AAA", "xaAa",
+    "AbAb", "Ab{2}", "x{y}", "a{1,x}", "a{", "a{1"
+};
+
+
+static void check(unsigned int index, const char* input)
+{
+    static const unsigned int MAX_CAPTURES_LIST[] = {0, 1, 2, MAX_CAPTURES};
+    subreg_capture_t expected[MAX_CAPTURES];
+    subreg_capture_t actual[MAX_CAPTURES];
+    const subreg_gen_entry_t* entry;
+    unsigned int i;
+    int expected_result;
+    int actual_result;
+
+    entry = &vectors[index];
+
+    for (i = 0; i < sizeof(MAX_CAPTURES_LIST) / sizeof(MAX_CAPTURES_LIST[0]);
+            i++)
+    {
+        unsigned int max_captures;
+        int j;
+
+        max_captures = MAX_CAPTURES_LIST[i];
+
+        memset(expected, 0, sizeof(expected));
+        memset(actual, 0, sizeof(actual));
+
+        expected_result = subreg_match(entry->regex, input, expected,
+                max_captures, MAX_DEPTH);
+        actual_result = entry->match(input, actual, max_captures);
+
+        TEST_CHECK_( actual_result == expected_result,
+                "\"%s\" on \"%s\" with %u captures: %d, expected %d",
+                entry->regex, input, max_captures, actual_result,
+                expected_result );
+
+        for (j = 0; j < expected_result; j++)
+        {
+            TEST_CHECK_( actual[j].start == expected[j].start &&
+                    actual[j].length == expected[j].length,
+                    "\"%s\" on \"%s\": capture %d differs",
+                    entry->regex, input, j );
+        }
+    }
+}
+
+
+static void test_gen_corpus(void)
+{
+    unsigned int i;
+    unsigned int j;
+
+    for (i = 0; i < vectors_count; i++)
+        for (j = 0; j < sizeof(CORPUS) / sizeof(CORPUS[0]); j++)
+            check(i, CORPUS[j]);
+}
+
+
+static void test_gen_single_chars(void)
+{
+    char input[2];
+    unsigned int i;
+    unsigned int c;
+
+    input[1] = '\0';
+
+    /* bytes above 0x7F are negative where plain char is signed */
+    for (i = 0; i < vectors_count; i++)
+    {
+        for (c = 1; c < 256; c++)
+        {
+            input[0] = (char) c;
+            check(i, input);
+        }
+    }
+}
+
+
+static void test_gen_pairs(void)
+{
+    static const char ALPHABET[] = "aAbBcCdDxX!\"@.1 ";
+    char input[3];
+    unsigned int i;
+    unsigned int j;
+    unsigned int k;
+
+    input[2] = '\0';
+
+    for (i = 0; i < vectors_count; i++)
+    {
+        for (j = 0; ALPHABET[j]; j++)
+        {
+            for (k = 0; ALPHABET[k]; k++)
+            {
+                input[0] = ALPHABET[j];
+                input[1] = ALPHABET[k];
+                check(i, input);
+            }
+        }
+    }
+}
+
+
+static void test_gen_invalid_argument(void)
+{
+    TEST_CHECK( vectors[0].match(NULL, NULL, 0) ==
+            SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( vectors[0].match("x", NULL, 1) ==
+            SUBREG_RESULT_INVALID_ARGUMENT );
+}
+
+
+TEST_LIST =
+{
+    {"gen_corpus",                          test_gen_corpus},
+    {"gen_single_chars",                    test_gen_single_chars},
+    {"gen_pairs",                           test_gen_pairs},
+    {"gen_invalid_argument",                test_gen_invalid_argument},
+    {0}
+};
@@ -0,0 +1,350 @@
+/**
+ * SubReg - A small footprint regular expression engine written in ANSI C.
+ *
+ * https://github.com/mattbucknall/subreg
+ *
+ * Copyright (c) 2016-2021 Matthew T. Bucknall
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISIN
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Checks that compile-time matchers from subreg.hpp behave exactly like
+ * subreg_match() with the same regular expression, and that invalid
+ * regular expressions are diagnosed at compile time.
+ */
+
+#include <cstring>
+#include <string>
+#include <cutest.h>
+#include <subreg.hpp>
+
+
+#define MAX_CAPTURES            4
+
+#define PATTERN(regex)          { regex, subreg::pattern<regex>::match, \
+                                  subreg::pattern<regex>::match }
+
+
+struct entry
+{
+    const char* regex;
+    int (*match)(const char* input, subreg_capture_t captures[],
+            unsigned int max_captures);
+    int (*match_view)(std::string_view input, subreg_capture_t captures[],
+            unsigned int max_captures);
+};
+
+
+/* the same patterns as subreg-gen-vectors.txt */
+static const entry PATTERNS[] =
+{
+    PATTERN("(?!hello)(.*)"),
+    PATTERN("(?:)*"),
+    PATTERN("(?:foo)"),
+    PATTERN("(?:foo)+"),
+    PATTERN("(?=a)*a"),
+    PATTERN("(?=hello)(.*)"),
+    PATTERN("(?I)abcdefghijklmnopqrstuvwxyz0123456789"),
+    PATTERN("(?i)(?I)(?i)(?I)(?i)a"),
+    PATTERN("(?i)abcdefghijklmnopqrstuvwxyz0123456789"),
+    PATTERN("(AB|CD)"),
+    PATTERN("(AB|CD)+"),
+    PATTERN("(AB|CD)+C"),
+    PATTERN("(AB|CD)C"),
+    PATTERN("(\\D)"),
+    PATTERN("(\\D)+"),
+    PATTERN("(\\d)"),
+    PATTERN("(\\d)+"),
+    PATTERN("(a?)*b"),
+    PATTERN("(foo) (bar)"),
+    PATTERN("(hello)"),
+    PATTERN("(test)"),
+    PATTERN("(test)+"),
+    PATTERN("."),
+    PATTERN(".*"),
+    PATTERN(".+"),
+    PATTERN("B(AAC)*AAD"),
+    PATTERN("B(AAC)?AAD"),
+    PATTERN("\\!\\x21"),
+    PATTERN("\\!a"),
+    PATTERN("\\!a+"),
+    PATTERN("\\!b"),
+    PATTERN("\\D"),
+    PATTERN("\\H"),
+    PATTERN("\\S"),
+    PATTERN("\\W"),
+    PATTERN("\\b"),
+    PATTERN("\\d"),
+    PATTERN("\\f"),
+    PATTERN("\\h"),
+    PATTERN("\\n"),
+    PATTERN("\\r"),
+    PATTERN("\\s"),
+    PATTERN("\\t"),
+    PATTERN("\\v"),
+    PATTERN("\\w"),
+    PATTERN("\\x21+"),
+    PATTERN("\x09"),
+    PATTERN("a|b"),
+    PATTERN("a|b|c"),
+    PATTERN("first (?i)second(?I) third"),
+    PATTERN("foo\"(\\!\"+)\"bar"),
+    PATTERN("hello"),
+    PATTERN("test"),
+    PATTERN("x"),
+    PATTERN("x?"),
+    PATTERN("a|"),
+    PATTERN("|"),
+    PATTERN("a||b"),
+    PATTERN("^ab$"),
+    PATTERN("(?i)a|b"),
+    PATTERN("(a|(?i)b)B"),
+    PATTERN("\\!\\x21b"),
+    PATTERN("\\x00"),
+    PATTERN("(x)(y)(z)"),
+    PATTERN("((a)|b)+"),
+    PATTERN("(?i)\\!a"),
+    PATTERN("a**"),
+    PATTERN("(?!a)"),
+    PATTERN("(?=(a))a"),
+    PATTERN("\\w+@\\w+\\.(?:com|org)"),
+    PATTERN("\\h{8}-\\h{4}"),
+    PATTERN("a{2}b{0,2}c{1,}"),
+    PATTERN("(ab|a){2,3}(x){0}|(?:b?){2}y"),
+    PATTERN("(a?){1,}b|x{0}(?i)a{3}"),
+    PATTERN(".{2,}|\\d{0,1}!"),
+    PATTERN("(?:A|b)*{2}"),
+    PATTERN("x{y}|a{1,x}|a{"),
+    PATTERN("(2\\!()"),
+    PATTERN("(a\\!()"),
+    PATTERN("(()2\\!()"),
+    PATTERN("(?:x\\!|)b|c"),
+    PATTERN("(?:a\\!\\()b|c")
+};
+
+
+static const char* const CORPUS[] =
+{
+    "", "!", "!!!!", "1", "1234", "A", "AB", "ABAB", "ABC", "ABCD",
+    "AbCdEfGhIjKlMnOpQrStUvWxYz0123456789", "BAACAACAAD", "BAACAAD", "BAAD",
+    "CD", "CDC", "CDCD", "\b", "\f", "\n", "\r", "\t", "\v", "a", "abcd",
+    "abcdefghijklmnopqrstuvwxyz0123456789", "b", "bar", "barfoofoo", "bcd",
+    "bcda", "c", "d", "first SECOND THIRD", "first SECOND third",
+    "first SeCoNd third", "foo bar", "foo", "foo\"test\"bar", "foofoofoo",
+    "goodbye", "hello world", "hello", "test", "testtest", "x",
+    "|", "a|", "||", "ab", "aB", "Ab", "bB", "BB", "!b", "xyz", "aab", "ba",
+    "aaaa", "me@example.com", "me@example.net", "deadbeef-1234",
+    "DEADBEEF-12345", "aac", "aabbcc", "aabbbc", "ababab", "abaab", "aaab",
+    "bby", "AAA", "xaAa", "AbAb", "Ab{2}", "x{y}", "a{1,x}",
+    "a{", "a{1", "11", "2x", "2(", "a(", "xyb", "x|b", "a(b"
+};
+
+
+static_assert(subreg::validate("(\\d+)\\.(\\d+)") == SUBREG_RESULT_NO_MATCH);
+static_assert(subreg::validate("a)") == SUBREG_RESULT_ILLEGAL_EXPRESSION);
+static_assert(subreg::validate("(a") == SUBREG_RESULT_MISSING_BRACKET);
+static_assert(subreg::validate("a|\\x4") == SUBREG_RESULT_INVALID_METACHARACTER);
+static_assert(subreg::validate("\\!\\d") == SUBREG_RESULT_ILLEGAL_EXPRESSION);
+static_assert(subreg::validate("((a))", 1) == SUBREG_RESULT_MAX_DEPTH_EXCEEDED);
+static_assert(subreg::validate("(?q)") == SUBREG_RESULT_INVALID_OPTION);
+static_assert(subreg::validate("a{2,1}") == SUBREG_RESULT_ILLEGAL_EXPRESSION);
+static_assert(subreg::validate("a{1001}") == SUBREG_RESULT_ILLEGAL_EXPRESSION);
+static_assert(subreg::validate("a{,1}|{1}") == SUBREG_RESULT_NO_MATCH);
+static_assert(subreg::validate("x{y}|a{1,x}|a{") == SUBREG_RESULT_NO_MATCH);
+static_assert(subreg::validate("(2\\!()") == SUBREG_RESULT_NO_MATCH);
+static_assert(subreg::validate("(?:x\\!|)b|c") == SUBREG_RESULT_NO_MATCH);
+
+
+static void check(const entry& e, const char* input)
+{
+    static const unsigned int MAX_CAPTURES_LIST[] = {0, 1, 2, MAX_CAPTURES};
+
+    for (unsigned int max_captures : MAX_CAPTURES_LIST)
+    {
+        subreg_capture_t expected[MAX_CAPTURES] = {};
+        subreg_capture_t actual[MAX_CAPTURES] = {};
+        int expected_result;
+        int actual_result;
+
+        expected_result = subreg_match(e.regex, input, expected, max_captures,
+                4);
+        actual_result = e.match(input, actual, max_captures);
+
+        TEST_CHECK_( actual_result == expected_result,
+                "\"%s\" on \"%s\" with %u captures: %d, expected %d",
+                e.regex, input, max_captures, actual_result, expected_result );
+
+        for (int i = 0; i < expected_result; i++)
+        {
+            TEST_CHECK_( actual[i].start == expected[i].start &&
+                    actual[i].length == expected[i].length,
+                    "\"%s\" on \"%s\": capture %d differs", e.regex, input, i );
+        }
+
+        /* length-bounded inputs must ignore whatever follows them */
+        std::string padded = std::string(input) + "ab!";
+        std::string_view view(padded.data(), std::strlen(input));
+
+        for (int bounded = 0; bounded < 2; bounded++)
+        {
+            if ( bounded ) actual_result = e.match_view(view, actual, max_captures);
+            else actual_result = subreg_match_n(e.regex, view.data(),
+                    static_cast<unsigned int>(view.size()), actual, max_captures, 4);
+
+            TEST_CHECK_( actual_result == expected_result,
+                    "\"%s\" on bounded \"%s\" with %u captures: %d, expected %d",
+                    e.regex, input, max_captures, actual_result, expected_result );
+
+            for (int i = 0; i < expected_result && i < static_cast<int>(max_captures); i++)
+            {
+                TEST_CHECK_( actual[i].start - view.data() ==
+                        expected[i].start - input &&
+                        actual[i].length == expected[i].length,
+                        "\"%s\" on bounded \"%s\": capture %d differs",
+                        e.regex, input, i );
+            }
+        }
+    }
+}
+
+
+static void test_hpp_corpus(void)
+{
+    for (const entry& e : PATTERNS)
+        for (const char* input : CORPUS)
+            check(e, input);
+}
+
+
+static void test_hpp_single_chars(void)
+{
+    char input[2] = {};
+
+    for (const entry& e : PATTERNS)
+    {
+        for (input[0] = 1; input[0] < 0x7F; input[0]++)
+            check(e, input);
+    }
+}
+
+
+static void test_hpp_api(void)
+{
+    subreg_capture_t cap[3];
+
+    TEST_CHECK( subreg::match<"(\\d+)\\.(\\d+)">("12.345", cap, 3) == 3 );
+    TEST_CHECK( cap[1].length == 2 && cap[2].length == 3 );
+    TEST_CHECK( subreg::match<"hello">("hello") == 1 );
+    TEST_CHECK( (subreg::match<"((a))", 2>("a")) == 1 );
+    TEST_CHECK( subreg::match<"x">(nullptr) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg::match<"x">("x", nullptr, 1) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( std::strcmp(subreg::pattern<"a|b">::regex(), "a|b") == 0 );
+}
+
+
+static void test_hpp_string_view(void)
+{
+    std::string_view captures[3];
+    std::string_view input("12.345 trailing", 6);
+
+    TEST_CHECK( subreg::match<"(\\d+)\\.(\\d+)">(input) == 1 );
+    TEST_CHECK( subreg::match<"\\d+">(std::string_view()) == 0 );
+    TEST_CHECK( subreg::match<"">(std::string_view()) == 1 );
+
+    auto found = subreg::pattern<"(\\d+)\\.(\\d+)">::match(input, captures);
+
+    TEST_CHECK( found.size() == 3 );
+    TEST_CHECK( found[0] == "12.345" && found[1] == "12" && found[2] == "345" );
+    TEST_CHECK( subreg::pattern<"x">::match("y", captures).empty() );
+}
+
+
+static void test_hpp_regex(void)
+{
+    std::string_view captures[2];
+    int code;
+
+    subreg::regex re("(\\w+)=\\w*");
+    subreg::regex moved(std::move(re));
+
+    TEST_CHECK( moved.source() == "(\\w+)=\\w*" );
+    TEST_CHECK( moved.matches(std::string_view("key=value!", 9)) );
+    TEST_CHECK( !moved.matches("key") );
+
+    auto found = moved.match("key=value", captures);
+
+    TEST_CHECK( found.size() == 2 && found[1] == "key" );
+
+    code = 0;
+
+    try
+    {
+        subreg::regex bad("(a");
+    }
+    catch (const subreg::error& e)
+    {
+        code = e.code();
+    }
+
+    TEST_CHECK( code == SUBREG_RESULT_MISSING_BRACKET );
+
+    code = 0;
+
+    try
+    {
+        moved.match("key=value", std::span<std::string_view>(captures, 1));
+    }
+    catch (const subreg::error& e)
+    {
+        code = e.code();
+    }
+
+    TEST_CHECK( code == SUBREG_RESULT_CAPTURE_OVERFLOW );
+}
+
+
+static void test_hpp_regex_match(void)
+{
+    subreg::regex re("(\\d+)\\.(\\d+)");
+    subreg::match_results m;
+    std::string input("12.345");
+
+    TEST_CHECK( subreg::regex_match(input, m, re) );
+    TEST_CHECK( m.size() == 3 );
+    TEST_CHECK( m.str(1) == "12" && m[2] == "345" );
+    TEST_CHECK( m.position(2) == 3 && m.length(2) == 3 );
+    TEST_CHECK( m[3].empty() );
+
+    TEST_CHECK( !subreg::regex_match("12.", m, re) );
+    TEST_CHECK( m.empty() );
+    TEST_CHECK( subreg::regex_match("1.2", re) );
+}
+
+
+TEST_LIST =
+{
+    {"hpp_corpus",                          test_hpp_corpus},
+    {"hpp_single_chars",                    test_hpp_single_chars},
+    {"hpp_api",                             test_hpp_api},
+    {"hpp_string_view",                     test_hpp_string_view},
+    {"hpp_regex",                           test_hpp_regex},
+    {"hpp_regex_match",                     test_hpp_regex_match},
+    {0}
+};
@@ -917,6 +917,1427 @@ static void test_inverted_hex_non_match(void)
 }
 
 
+static void test_memo_hit(void)
+{
+    subreg_memo_entry_t entries[8];
+    subreg_memo_t memo;
+    subreg_capture_t cap[2];
+    char input[8];
+    
+    subreg_memo_init(&memo, "(\\d+)ms", 4, entries, 8);
+    
+    strcpy(input, "250ms");
+    TEST_CHECK( subreg_memo_match(&memo, input, cap, 2) == 2 );
+    TEST_CHECK( memo.misses == 1 && memo.hits == 0 );
+    
+    /* same input at a different address must yield relocated captures */
+    strcpy(input + 1, "250ms");
+    TEST_CHECK( subreg_memo_match(&memo, input + 1, cap, 2) == 2 );
+    TEST_CHECK( memo.misses == 1 && memo.hits == 1 );
+    TEST_CHECK( cap[0].start == input + 1 && cap[0].length == 5 );
+    TEST_CHECK( cap[1].start == input + 1 && cap[1].length == 3 );
+}
+
+
+static void test_memo_miss(void)
+{
+    subreg_memo_entry_t entries[8];
+    subreg_memo_t memo;
+    
+    subreg_memo_init(&memo, "GET|PUT", 4, entries, 8);
+    
+    TEST_CHECK( subreg_memo_match(&memo, "GET", NULL, 0) == 1 );
+    TEST_CHECK( subreg_memo_match(&memo, "POST", NULL, 0) == 0 );
+    TEST_CHECK( subreg_memo_match(&memo, "POST", NULL, 0) == 0 );
+    TEST_CHECK( subreg_memo_match(&memo, "GETS", NULL, 0) == 0 );
+    TEST_CHECK( memo.misses == 3 && memo.hits == 1 );
+}
+
+
+static void test_memo_max_captures(void)
+{
+    subreg_memo_entry_t entries[8];
+    subreg_memo_t memo;
+    subreg_capture_t cap[3];
+    
+    subreg_memo_init(&memo, "(a)(b)", 4, entries, 8);
+    
+    TEST_CHECK( subreg_memo_match(&memo, "ab", cap, 3) == 3 );
+    TEST_CHECK( subreg_memo_match(&memo, "ab", cap, 2) == SUBREG_RESULT_CAPTURE_OVERFLOW );
+    TEST_CHECK( subreg_memo_match(&memo, "ab", NULL, 0) == 1 );
+    TEST_CHECK( memo.hits == 0 && memo.misses == 3 );
+    TEST_CHECK( subreg_memo_match(&memo, "ab", cap, 2) == SUBREG_RESULT_CAPTURE_OVERFLOW );
+    TEST_CHECK( memo.hits == 1 );
+}
+
+
+static void test_memo_bypass(void)
+{
+    subreg_memo_entry_t entries[2];
+    subreg_memo_t memo;
+    char input[SUBREG_MEMO_MAX_INPUT + 2];
+    
+    memset(input, 'a', sizeof(input) - 1);
+    input[sizeof(input) - 1] = '\0';
+    
+    subreg_memo_init(&memo, "a*", 4, entries, 2);
+    
+    TEST_CHECK( subreg_memo_match(&memo, input, NULL, 0) == 1 );
+    TEST_CHECK( subreg_memo_match(&memo, input, NULL, 0) == 1 );
+    TEST_CHECK( memo.bypasses == 2 && memo.hits == 0 && memo.misses == 0 );
+}
+
+
+static void test_memo_totals(void)
+{
+    subreg_memo_entry_t entries[4];
+    subreg_memo_t memo;
+    subreg_capture_t cap[6];
+    char input[SUBREG_MEMO_MAX_INPUT + 2];
+    
+    memset(input, 'a', sizeof(input) - 1);
+    input[sizeof(input) - 1] = '\0';
+    
+    subreg_memo_init(&memo, "(a)(a)?(a)?(a)?(a*)", 4, entries, 4);
+    
+    /* five captures are one too many to memoise, whatever the input */
+    TEST_CHECK( subreg_memo_match(&memo, "aaaaa", cap, 6) == 6 );
+    TEST_CHECK( subreg_memo_match(&memo, input, cap, 6) == 6 );
+    TEST_CHECK( memo.bypasses == 2 && memo.misses == 0 && memo.hits == 0 );
+    
+    TEST_CHECK( subreg_memo_match(&memo, "aaaaa", NULL, 0) == 1 );
+    TEST_CHECK( subreg_memo_match(&memo, "aaaaa", NULL, 0) == 1 );
+    TEST_CHECK( subreg_memo_match(&memo, input, NULL, 0) == 1 );
+    TEST_CHECK( memo.bypasses == 3 && memo.misses == 1 && memo.hits == 1 );
+    
+    TEST_CHECK( memo.hits + memo.misses + memo.bypasses == 5 );
+}
+
+
+static void test_memo_eviction(void)
+{
+    subreg_memo_entry_t entries[1];
+    subreg_memo_t memo;
+    
+    subreg_memo_init(&memo, "\\w+", 4, entries, 1);
+    
+    TEST_CHECK( subreg_memo_match(&memo, "foo", NULL, 0) == 1 );
+    TEST_CHECK( subreg_memo_match(&memo, "bar", NULL, 0) == 1 );
+    TEST_CHECK( subreg_memo_match(&memo, "bar", NULL, 0) == 1 );
+    TEST_CHECK( memo.evictions == 1 && memo.hits == 1 );
+}
+
+
+static void test_stats_counts(void)
+{
+    subreg_stats_t stats;
+    
+    subreg_stats_init(&stats);
+    
+    TEST_CHECK( subreg_match_stats(&stats, "\\d+", "1234", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match_stats(&stats, "\\d+", "12a4", NULL, 0, 4) == 0 );
+    TEST_CHECK( subreg_match_stats(&stats, "(\\d+", "1234", NULL, 0, 4) == SUBREG_RESULT_MISSING_BRACKET );
+    TEST_CHECK( stats.calls == 3 );
+    TEST_CHECK( stats.matches == 1 );
+    TEST_CHECK( stats.no_matches == 1 );
+    TEST_CHECK( stats.errors == 1 );
+    TEST_CHECK( stats.bytes >= 4 + 2 );
+    TEST_CHECK( stats.steps > 0 );
+}
+
+
+static void test_stats_histogram(void)
+{
+    subreg_stats_t stats;
+    unsigned long total;
+    unsigned int i;
+    
+    subreg_stats_init(&stats);
+    
+    TEST_CHECK( subreg_match_stats(&stats, "x", "x", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match_stats(&stats, ".*", "a fairly long input string", NULL, 0, 4) == 1 );
+    
+    total = 0;
+    for (i = 0; i < SUBREG_STATS_NUM_BUCKETS; i++) total += stats.histogram[i];
+    
+    TEST_CHECK( total == 2 );
+    TEST_CHECK( stats.histogram[0] + stats.histogram[1] == 1 );
+}
+
+
+static void test_stats_merge(void)
+{
+    subreg_stats_t a;
+    subreg_stats_t b;
+    
+    subreg_stats_init(&a);
+    subreg_stats_init(&b);
+    
+    subreg_match_stats(&a, "a", "a", NULL, 0, 4);
+    subreg_match_stats(&b, "a", "b", NULL, 0, 4);
+    subreg_stats_merge(&a, &b);
+    
+    TEST_CHECK( a.calls == 2 && a.matches == 1 && a.no_matches == 1 );
+}
+
+
+static void test_stats_format(void)
+{
+    subreg_stats_t stats;
+    char buffer[256];
+    char small[8];
+    unsigned int length;
+    
+    subreg_stats_init(&stats);
+    subreg_match_stats(&stats, "a", "a", NULL, 0, 4);
+    
+    length = subreg_stats_format(&stats, "a", buffer, sizeof(buffer));
+    TEST_CHECK( length == strlen(buffer) );
+    TEST_CHECK( strncmp(buffer, "a calls=1 matches=1 no_matches=0 errors=0 ", 42) == 0 );
+    
+    TEST_CHECK( subreg_stats_format(&stats, "a", small, sizeof(small)) == length );
+    TEST_CHECK( strcmp(small, "a calls") == 0 );
+}
+
+
+static void test_empty_repetition(void)
+{
+    subreg_capture_t cap[3];
+    
+    TEST_CHECK( subreg_match("(?:)*", "", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match("(?=a)*a", "a", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match("(a?)*b", "b", cap, 3, 4) == 2 );
+    TEST_CHECK( cap[1].length == 0 );
+}
+
+
+static void test_option_depth(void)
+{
+    TEST_CHECK( subreg_match("(?i)(?I)(?i)(?I)(?i)a", "A", NULL, 0, 1) == 1 );
+}
+
+
+static void test_empty_branch(void)
+{
+    TEST_CHECK( subreg_match("a|", "", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match("a|", "b", NULL, 0, 4) == 0 );
+    TEST_CHECK( subreg_match("(?:a|)b", "b", NULL, 0, 4) == 1 );
+}
+
+
+static void test_input_end(void)
+{
+    TEST_CHECK( subreg_match("\\x00", "", NULL, 0, 4) == 0 );
+    TEST_CHECK( subreg_match("\\!a*", "", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match("\\!\\x21b", "Ab", NULL, 0, 4) == 1 );
+}
+
+
+static void test_match_n(void)
+{
+    subreg_capture_t cap[2];
+    
+    TEST_CHECK( subreg_match_n("ab", "abc", 2, NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match_n("abc", "abc", 2, NULL, 0, 4) == 0 );
+    TEST_CHECK( subreg_match_n("", "abc", 0, NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match_n("a.b", "a\0b", 3, NULL, 0, 4) == 0 );
+    TEST_CHECK( subreg_match_n("a", "a\0", 2, NULL, 0, 4) == 0 );
+    TEST_CHECK( subreg_match_n("a", NULL, 0, NULL, 0, 4) == SUBREG_RESULT_INVALID_ARGUMENT );
+    
+    TEST_CHECK( subreg_match_n("(.*)", "hello", 4, cap, 2, 4) == 2 );
+    TEST_CHECK( cap[1].length == 4 );
+}
+
+
+static void test_analyze_invalid(void)
+{
+    subreg_cost_t cost;
+    
+    TEST_CHECK( subreg_analyze("(a", 4, &cost) == SUBREG_RESULT_MISSING_BRACKET );
+    TEST_CHECK( subreg_analyze("a)", 4, &cost) == SUBREG_RESULT_ILLEGAL_EXPRESSION );
+    TEST_CHECK( subreg_analyze("a|\\x4", 4, &cost) == SUBREG_RESULT_INVALID_METACHARACTER );
+    TEST_CHECK( subreg_analyze("(?q)", 4, &cost) == SUBREG_RESULT_INVALID_OPTION );
+    TEST_CHECK( subreg_analyze("((a))", 1, &cost) == SUBREG_RESULT_MAX_DEPTH_EXCEEDED );
+    TEST_CHECK( subreg_analyze(NULL, 4, &cost) == SUBREG_RESULT_INVALID_ARGUMENT );
+}
+
+
+static void test_analyze_depth(void)
+{
+    subreg_cost_t cost;
+    
+    TEST_CHECK( subreg_analyze("a(b(c))(d)", 4, &cost) == 0 );
+    TEST_CHECK( cost.depth == 2 );
+}
+
+
+static void test_analyze_degree(void)
+{
+    subreg_cost_t cost;
+    
+    TEST_CHECK( subreg_analyze("GET /index.html", 4, &cost) == 0 );
+    TEST_CHECK( cost.degree == 0 );
+    
+    TEST_CHECK( subreg_analyze("(\\w+\\s?)*", 4, &cost) == 0 );
+    TEST_CHECK( cost.degree == 1 );
+    
+    TEST_CHECK( subreg_analyze("(?:.*x|a)*", 4, &cost) == 0 );
+    TEST_CHECK( cost.degree == 2 );
+    
+    TEST_CHECK( subreg_analyze("(?:(?=.*x)a)*", 4, &cost) == 0 );
+    TEST_CHECK( cost.degree == 2 );
+}
+
+
+static void test_analyze_bound(void)
+{
+    static const char* regexes[] = {"(?:.*x|a)*", "(\\w+\\s?)*", "(?!a)(.)*", "a|b|c"};
+    static const char* inputs[] = {"aaaaaaaaaaaaaaaaaaaa", "one two three", "bbbbbbb", "c"};
+    subreg_cost_t cost;
+    subreg_stats_t stats;
+    unsigned int i;
+    
+    for (i = 0; i < sizeof(regexes) / sizeof(regexes[0]); i++)
+    {
+        subreg_stats_init(&stats);
+        
+        TEST_CHECK( subreg_analyze(regexes[i], 4, &cost) == 0 );
+        TEST_CHECK( subreg_match_stats(&stats, regexes[i], inputs[i], NULL, 0, 4) >= 0 );
+        TEST_CHECK( stats.steps <= subreg_cost_steps(&cost, strlen(inputs[i])) );
+    }
+}
+
+
+static void test_analyze_negated_operand(void)
+{
+    static const char* regexes[] = {"(2\\!()", "(a\\!()", "(()2\\!()", "(?:x\\!|)b|c", "(?:a\\!\\x29)b|c", "(?:a\\!\\()b|c"};
+    subreg_cost_t cost;
+    unsigned int i;
+    
+    /* whatever analysis accepts, matching must not reject */
+    for (i = 0; i < sizeof(regexes) / sizeof(regexes[0]); i++)
+    {
+        TEST_CHECK( subreg_analyze(regexes[i], 4, &cost) == 0 );
+        TEST_CHECK_( subreg_match(regexes[i], "", NULL, 0, 4) >= 0, "\"%s\"", regexes[i] );
+    }
+    
+    TEST_CHECK( subreg_match("(2\\!()", "11", NULL, 0, 4) == 0 );
+    TEST_CHECK( subreg_match("(2\\!()", "2x", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match("(a\\!()", "a(", NULL, 0, 4) == 0 );
+    TEST_CHECK( subreg_match("(?:x\\!|)b|c", "b", NULL, 0, 4) == 0 );
+    TEST_CHECK( subreg_match("(?:x\\!|)b|c", "xyb", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match("(?:x\\!|)b|c", "c", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match("(?:a\\!\\x29)b|c", "c", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match("(?:a\\!\\()b|c", "c", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match("(?:a\\!\\()b|c", "a(b", NULL, 0, 4) == 0 );
+}
+
+
+static const char* const IMAGE_REGEXES[] = {"GET|PUT|POST", "(\\d+)\\.(\\d+)", ""};
+
+
+static void test_image_build(void)
+{
+    unsigned char image[128];
+    unsigned long size;
+    unsigned int max_depth;
+    
+    size = subreg_image_size(IMAGE_REGEXES, 3);
+    TEST_CHECK( size <= sizeof(image) );
+    
+    TEST_CHECK( subreg_image_build(image, size - 1, IMAGE_REGEXES, 3, 4) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_image_build(image, size, IMAGE_REGEXES, 3, 4) == 0 );
+    TEST_CHECK( subreg_image_check(image, size) == 3 );
+    
+    TEST_CHECK( strcmp(subreg_image_regex(image, 0, &max_depth), "GET|PUT|POST") == 0 );
+    TEST_CHECK( max_depth == 0 );
+    TEST_CHECK( strcmp(subreg_image_regex(image, 1, &max_depth), "(\\d+)\\.(\\d+)") == 0 );
+    TEST_CHECK( max_depth == 1 );
+    TEST_CHECK( strcmp(subreg_image_regex(image, 2, NULL), "") == 0 );
+    TEST_CHECK( subreg_image_regex(image, 3, NULL) == NULL );
+}
+
+
+static void test_image_match(void)
+{
+    unsigned char image[128];
+    subreg_capture_t cap[3];
+    
+    TEST_CHECK( subreg_image_build(image, sizeof(image), IMAGE_REGEXES, 3, 4) == 0 );
+    
+    TEST_CHECK( subreg_image_match(image, 0, "PUT", NULL, 0) == 1 );
+    TEST_CHECK( subreg_image_match(image, 1, "10.25", cap, 3) == 3 );
+    TEST_CHECK( cap[2].length == 2 && memcmp(cap[2].start, "25", 2) == 0 );
+    TEST_CHECK( subreg_image_match(image, 3, "", NULL, 0) == SUBREG_RESULT_INVALID_ARGUMENT );
+}
+
+
+static void test_image_invalid_regex(void)
+{
+    static const char* const regexes[] = {"ok", "(bad"};
+    unsigned char image[64];
+    
+    TEST_CHECK( subreg_image_build(image, sizeof(image), regexes, 2, 4) == SUBREG_RESULT_MISSING_BRACKET );
+}
+
+
+static void test_image_corrupt(void)
+{
+    unsigned char image[128];
+    unsigned long size;
+    
+    size = subreg_image_size(IMAGE_REGEXES, 3);
+    TEST_CHECK( subreg_image_build(image, size, IMAGE_REGEXES, 3, 4) == 0 );
+    
+    TEST_CHECK( subreg_image_check(image, size - 1) == SUBREG_RESULT_INVALID_IMAGE );
+    
+    image[size - 2] ^= 1;
+    TEST_CHECK( subreg_image_check(image, size) == SUBREG_RESULT_INVALID_IMAGE );
+    image[size - 2] ^= 1;
+    
+    image[4]++;
+    TEST_CHECK( subreg_image_check(image, size) == SUBREG_RESULT_INVALID_IMAGE );
+    image[4]--;
+    
+    /* a size field smaller than the header must not be trusted */
+    image[8] = 8;
+    TEST_CHECK( subreg_image_check(image, size) == SUBREG_RESULT_INVALID_IMAGE );
+    image[8] = 0;
+    TEST_CHECK( subreg_image_check(image, size) == SUBREG_RESULT_INVALID_IMAGE );
+    image[8] = (unsigned char) size;
+    
+    TEST_CHECK( subreg_image_check(image, size) == 3 );
+}
+
+
+static void test_search(void)
+{
+    subreg_capture_t cap[2];
+    
+    TEST_CHECK( subreg_search("b+", "aabbbc", cap, 2, 4) == 1 );
+    TEST_CHECK( cap[0].start[0] == 'b' && cap[0].length == 3 );
+    
+    TEST_CHECK( subreg_search("(\\d+)px", "width: 12px", cap, 2, 4) == 2 );
+    TEST_CHECK( cap[1].length == 2 && memcmp(cap[1].start, "12", 2) == 0 );
+    
+    /* first alternative to match at the leftmost offset wins */
+    TEST_CHECK( subreg_search("ab|abc|b", "xabc", cap, 1, 4) == 1 );
+    TEST_CHECK( cap[0].length == 2 && memcmp(cap[0].start, "ab", 2) == 0 );
+    
+    TEST_CHECK( subreg_search("^ab", "ab", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_search("^ab", "xab", NULL, 0, 4) == SUBREG_RESULT_NO_MATCH );
+    TEST_CHECK( subreg_search("ab$", "abxab", cap, 1, 4) == 1 );
+    TEST_CHECK( cap[0].start[-1] == 'x' );
+    TEST_CHECK( subreg_search("ab$", "abx", NULL, 0, 4) == SUBREG_RESULT_NO_MATCH );
+    
+    /* the '(' is the operand of \!, so "b" is a top-level alternative */
+    TEST_CHECK( subreg_search("a\\!(|b", "xb", cap, 1, 4) == 1 );
+    TEST_CHECK( cap[0].start[0] == 'b' );
+    
+    TEST_CHECK( subreg_search("x*", "abc", cap, 1, 4) == 1 );
+    TEST_CHECK( cap[0].length == 0 && cap[0].start[0] == 'a' );
+    TEST_CHECK( subreg_search("c?$", "abc", cap, 1, 4) == 1 );
+    TEST_CHECK( cap[0].length == 1 && cap[0].start[0] == 'c' );
+    TEST_CHECK( subreg_search("a", "", NULL, 0, 4) == SUBREG_RESULT_NO_MATCH );
+}
+
+
+static void test_search_errors(void)
+{
+    TEST_CHECK( subreg_search(NULL, "", NULL, 0, 4) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_search("a", NULL, NULL, 0, 4) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_search("a", "a", NULL, 1, 4) == SUBREG_RESULT_INVALID_ARGUMENT );
+    
+    /* bracket and depth errors are reported however little input there is */
+    TEST_CHECK( subreg_search("a(", "bbb", NULL, 0, 4) == SUBREG_RESULT_MISSING_BRACKET );
+    TEST_CHECK( subreg_search("a\\xZZ", "ba", NULL, 0, 4) == SUBREG_RESULT_INVALID_METACHARACTER );
+    TEST_CHECK( subreg_search("x((a))", "xa", NULL, 0, 1) == SUBREG_RESULT_MAX_DEPTH_EXCEEDED );
+}
+
+
+static const char* const SEARCHER_REGEXES[] =
+{
+    "he|she|his|hers", "abc|ab|b", "ab|abc", "a|a|aa", "(?i)get|put|Post",
+    "(?I)get|PUT", "\\x41\\x42|\\.\\||\\n", "a\\x00|b", "x", "hello|hell|he|h"
+};
+
+
+static const char* const SEARCHER_INPUTS[] =
+{
+    "", "ushers", "xabcx", "abc", "aa", "POST /put", "AB.|\n", "a", "b",
+    "xxx", "ahishers", "say hello", "hhhh", "shelf", "GeT", "ab", "zzz"
+};
+
+
+static void test_searcher_engine(void)
+{
+    unsigned long arena[64];
+    subreg_searcher_t searcher;
+    
+    TEST_CHECK( subreg_searcher_arena_size("a|bc") > 0 );
+    TEST_CHECK( subreg_searcher_arena_size("(?i)a\\.b") > 0 );
+    TEST_CHECK( subreg_searcher_arena_size("a*|b") == 0 );
+    TEST_CHECK( subreg_searcher_arena_size("a|") == 0 );
+    TEST_CHECK( subreg_searcher_arena_size("^a") == 0 );
+    TEST_CHECK( subreg_searcher_arena_size("a\\d") > 0 );
+    TEST_CHECK( subreg_searcher_arena_size("a?\\d?") == 0 );
+    TEST_CHECK( subreg_searcher_arena_size("a+") == 0 );
+    TEST_CHECK( subreg_searcher_arena_size("(a)") == 0 );
+    
+    TEST_CHECK( subreg_searcher_init(&searcher, "a|bc", 4, arena, sizeof(arena)) == 0 );
+    TEST_CHECK( searcher.engine == SUBREG_ENGINE_AHO_CORASICK );
+    
+    TEST_CHECK( subreg_searcher_init(&searcher, "a|bc", 4, arena, subreg_searcher_arena_size("a|bc") - 1) == 0 );
+    TEST_CHECK( searcher.engine == SUBREG_ENGINE_INTERPRETER );
+    
+    TEST_CHECK( subreg_searcher_init(&searcher, "a|b+", 4, arena, sizeof(arena)) == 0 );
+    TEST_CHECK( searcher.engine == SUBREG_ENGINE_INTERPRETER );
+    
+    TEST_CHECK( subreg_searcher_init(&searcher, "\\d+", 4, arena, sizeof(arena)) == 0 );
+    TEST_CHECK( searcher.engine == SUBREG_ENGINE_INTERPRETER );
+    
+    TEST_CHECK( subreg_searcher_init(&searcher, "a|(b", 4, arena, sizeof(arena)) == SUBREG_RESULT_MISSING_BRACKET );
+    TEST_CHECK( subreg_searcher_init(NULL, "a", 4, arena, sizeof(arena)) == SUBREG_RESULT_INVALID_ARGUMENT );
+}
+
+
+static void test_searcher_equivalence(void)
+{
+    unsigned long arena[128];
+    subreg_searcher_t searcher;
+    subreg_capture_t expected[1];
+    subreg_capture_t actual[1];
+    unsigned int i;
+    unsigned int j;
+    
+    for (i = 0; i < sizeof(SEARCHER_REGEXES) / sizeof(SEARCHER_REGEXES[0]); i++)
+    {
+        TEST_CHECK( subreg_searcher_arena_size(SEARCHER_REGEXES[i]) <= sizeof(arena) );
+        TEST_CHECK( subreg_searcher_init(&searcher, SEARCHER_REGEXES[i], 4, arena, sizeof(arena)) == 0 );
+        TEST_CHECK( searcher.engine == SUBREG_ENGINE_AHO_CORASICK );
+        
+        for (j = 0; j < sizeof(SEARCHER_INPUTS) / sizeof(SEARCHER_INPUTS[0]); j++)
+        {
+            int expected_result;
+            int actual_result;
+            
+            memset(expected, 0, sizeof(expected));
+            memset(actual, 0, sizeof(actual));
+            
+            expected_result = subreg_search(SEARCHER_REGEXES[i], SEARCHER_INPUTS[j], expected, 1, 4);
+            actual_result = subreg_searcher_search(&searcher, SEARCHER_INPUTS[j], actual, 1);
+            
+            TEST_CHECK_( actual_result == expected_result &&
+                    actual[0].start == expected[0].start &&
+                    actual[0].length == expected[0].length,
+                    "\"%s\" on \"%s\"", SEARCHER_REGEXES[i], SEARCHER_INPUTS[j] );
+            
+            TEST_CHECK( subreg_searcher_search(&searcher, SEARCHER_INPUTS[j], NULL, 0) == expected_result );
+        }
+    }
+}
+
+
+static const char* const BITAP_REGEXES[] =
+{
+    "a?a", "ab?b", "\\d\\d?\\.\\d", "x.?y", "(?i)ab?c", "\\!ab", "a?bc?",
+    "\\w\\s?\\w", "\\D\\H?\\S\\W?.", "\\x41?\\n?b", "..?.", "\\d\\d\\d-?\\d\\d\\d\\d",
+    "a?b?c?d?9\\d", "\\d?\\dx", "x?x?xy", "b?.a?b"
+};
+
+
+static const char* const BITAP_INPUTS[] =
+{
+    "", "a", "aa", "xaab", "abb", "ab", "12.5", "1.25", "x1..2", "xy xzy",
+    "XaBC", "AC", "xb", "bcab", "a b", "a\nb", "!Z x", "Ab\nb", "555-1234",
+    "5551234", "55-1234", "ab.c", "99999", "xbcd99", "1x12x", "xxxxy", "xxy",
+    "babab", "aab"
+};
+
+
+static void test_searcher_bitap(void)
+{
+    unsigned long arena[512];
+    subreg_searcher_t searcher;
+    subreg_capture_t expected[1];
+    subreg_capture_t actual[1];
+    unsigned int i;
+    unsigned int j;
+    
+    for (i = 0; i < sizeof(BITAP_REGEXES) / sizeof(BITAP_REGEXES[0]); i++)
+    {
+        TEST_CHECK( subreg_searcher_arena_size(BITAP_REGEXES[i]) <= sizeof(arena) );
+        TEST_CHECK( subreg_searcher_init(&searcher, BITAP_REGEXES[i], 4, arena, sizeof(arena)) == 0 );
+        TEST_CHECK_( searcher.engine == SUBREG_ENGINE_BITAP, "\"%s\"", BITAP_REGEXES[i] );
+        
+        for (j = 0; j < sizeof(BITAP_INPUTS) / sizeof(BITAP_INPUTS[0]); j++)
+        {
+            int expected_result;
+            int actual_result;
+            
+            memset(expected, 0, sizeof(expected));
+            memset(actual, 0, sizeof(actual));
+            
+            expected_result = subreg_search(BITAP_REGEXES[i], BITAP_INPUTS[j], expected, 1, 4);
+            actual_result = subreg_searcher_search(&searcher, BITAP_INPUTS[j], actual, 1);
+            
+            TEST_CHECK_( actual_result == expected_result &&
+                    actual[0].start == expected[0].start &&
+                    actual[0].length == expected[0].length,
+                    "\"%s\" on \"%s\"", BITAP_REGEXES[i], BITAP_INPUTS[j] );
+        }
+    }
+}
+
+
+static void test_searcher_bitap_long(void)
+{
+    char regex[200];
+    char input[200];
+    unsigned long arena[512];
+    subreg_searcher_t searcher;
+    subreg_capture_t cap[1];
+    unsigned int length;
+    
+    /* one atom more than fits in a word falls back to the interpreter */
+    length = (unsigned int) (sizeof(unsigned long) * 8);
+    
+    memset(regex, 'a', length);
+    regex[0] = '.';
+    regex[length] = '\0';
+    memset(input, 'a', length + 1);
+    input[length + 1] = '\0';
+    
+    TEST_CHECK( subreg_searcher_init(&searcher, regex, 4, arena, sizeof(arena)) == 0 );
+    TEST_CHECK( searcher.engine == SUBREG_ENGINE_BITAP );
+    TEST_CHECK( subreg_searcher_search(&searcher, input, cap, 1) == 1 );
+    TEST_CHECK( cap[0].start == input && cap[0].length == length );
+    
+    regex[length] = 'a';
+    regex[length + 1] = '\0';
+    
+    TEST_CHECK( subreg_searcher_init(&searcher, regex, 4, arena, sizeof(arena)) == 0 );
+    TEST_CHECK( searcher.engine == SUBREG_ENGINE_INTERPRETER );
+    TEST_CHECK( subreg_searcher_search(&searcher, input, cap, 1) == 1 );
+}
+
+
+static void test_searcher_literal(void)
+{
+    unsigned long arena[64];
+    subreg_searcher_t searcher;
+    subreg_capture_t cap[1];
+    
+    TEST_CHECK( subreg_searcher_init(&searcher, "(?i)he|she|his|hers", 4, arena, sizeof(arena)) == 0 );
+    
+    TEST_CHECK( subreg_searcher_search(&searcher, "USHERS", cap, 1) == 1 );
+    TEST_CHECK( subreg_searcher_literal(&searcher, cap) == 1 );
+    TEST_CHECK( subreg_searcher_search(&searcher, "this", cap, 1) == 1 );
+    TEST_CHECK( subreg_searcher_literal(&searcher, cap) == 2 );
+    
+    cap[0].length = 1;
+    TEST_CHECK( subreg_searcher_literal(&searcher, cap) == SUBREG_RESULT_INVALID_ARGUMENT );
+    
+    TEST_CHECK( subreg_searcher_init(&searcher, "he|she", 4, NULL, 0) == 0 );
+    TEST_CHECK( subreg_searcher_search(&searcher, "ushe", cap, 1) == 1 );
+    TEST_CHECK( subreg_searcher_literal(&searcher, cap) == SUBREG_RESULT_INVALID_ARGUMENT );
+}
+
+typedef struct
+{
+    unsigned long offsets[8];
+    unsigned long lengths[8];
+    unsigned int count;
+    
+} stream_matches_t;
+
+
+static void record_match(void* context, unsigned long offset, unsigned long length)
+{
+    stream_matches_t* matches;
+    
+    matches = (stream_matches_t*) context;
+    
+    if ( matches->count < 8 )
+    {
+        matches->offsets[matches->count] = offset;
+        matches->lengths[matches->count] = length;
+    }
+    
+    matches->count++;
+}
+
+
+static void check_stream(const char* regex, const char* input, unsigned long chunk,
+        const unsigned long expected[], unsigned int count)
+{
+    unsigned long arena[512];
+    char buffer[64];
+    subreg_searcher_t searcher;
+    subreg_stream_t stream;
+    stream_matches_t matches;
+    unsigned long length;
+    unsigned long i;
+    
+    matches.count = 0;
+    length = (unsigned long) strlen(input);
+    
+    TEST_CHECK( subreg_searcher_init(&searcher, regex, 4, arena, sizeof(arena)) == 0 );
+    TEST_CHECK( subreg_stream_buffer_size(&searcher) <= sizeof(buffer) );
+    TEST_CHECK( subreg_stream_init(&stream, &searcher, buffer, sizeof(buffer), record_match, &matches) == 0 );
+    
+    for (i = 0; i < length; i += chunk)
+        TEST_CHECK( subreg_stream_feed(&stream, input + i, (length - i < chunk) ? length - i : chunk) == 0 );
+    
+    TEST_CHECK( subreg_stream_finish(&stream) == 0 );
+    TEST_CHECK( stream.position == length );
+    
+    TEST_CHECK_( matches.count == count, "\"%s\" on \"%s\" in chunks of %lu: %u matches",
+            regex, input, chunk, matches.count );
+    
+    for (i = 0; i < count && i < matches.count; i++)
+    {
+        TEST_CHECK_( matches.offsets[i] == expected[2 * i] && matches.lengths[i] == expected[2 * i + 1],
+                "\"%s\" on \"%s\" in chunks of %lu: match %lu", regex, input, chunk, i );
+    }
+}
+
+
+static void test_stream(void)
+{
+    static const unsigned long keywords[] = {2, 3, 6, 4, 13, 2};
+    static const unsigned long nocase[] = {0, 3, 3, 3};
+    static const unsigned long phone[] = {4, 8, 13, 7};
+    static const unsigned long possessive[] = {1, 3, 4, 2};
+    unsigned long chunk;
+    
+    for (chunk = 1; chunk <= 8; chunk++)
+    {
+        check_stream("she|hers|he|ab", "a she hers xxhe", chunk, keywords, 3);
+        check_stream("(?i)get|put", "GETput", chunk, nocase, 2);
+        check_stream("\\d\\d\\d-?\\d\\d\\d\\d", "tel 555-1234 5551234 55-123", chunk, phone, 2);
+        check_stream("a?ab?", "xaabaa", chunk, possessive, 2);
+        check_stream("abc", "ab", chunk, NULL, 0);
+    }
+}
+
+
+static void test_stream_invalid(void)
+{
+    unsigned long arena[512];
+    char buffer[64];
+    subreg_searcher_t searcher;
+    subreg_stream_t stream;
+    stream_matches_t matches;
+    
+    TEST_CHECK( subreg_searcher_init(&searcher, "a|bcd", 4, arena, sizeof(arena)) == 0 );
+    TEST_CHECK( subreg_stream_buffer_size(&searcher) == 3 );
+    TEST_CHECK( subreg_stream_init(&stream, &searcher, buffer, 2, record_match, &matches) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_stream_init(&stream, &searcher, buffer, 3, NULL, &matches) == SUBREG_RESULT_INVALID_ARGUMENT );
+    
+    TEST_CHECK( subreg_searcher_init(&searcher, "a\\d?", 4, arena, sizeof(arena)) == 0 );
+    TEST_CHECK( subreg_stream_buffer_size(&searcher) == 4 );
+    
+    TEST_CHECK( subreg_searcher_init(&searcher, "a+", 4, arena, sizeof(arena)) == 0 );
+    TEST_CHECK( subreg_stream_buffer_size(&searcher) == 0 );
+    TEST_CHECK( subreg_stream_init(&stream, &searcher, buffer, sizeof(buffer), record_match, &matches) == SUBREG_RESULT_INVALID_ARGUMENT );
+}
+
+static void test_validator(void)
+{
+    static const char* const input = "AT+BAUD=96x";
+    unsigned long arena[256];
+    subreg_validator_t validator;
+    unsigned int i;
+    
+    TEST_CHECK( subreg_validator_arena_size("AT\\+BAUD=\\d\\d?\\d?\\d?\\d?") <= sizeof(arena) );
+    TEST_CHECK( subreg_validator_init(&validator, "AT\\+BAUD=\\d\\d?\\d?\\d?\\d?", arena, sizeof(arena)) == 0 );
+    TEST_CHECK( !subreg_validator_accepts(&validator) );
+    
+    /* rejected at the first character that cannot be part of a match */
+    for (i = 0; input[i] != 'x'; i++)
+        TEST_CHECK( subreg_validator_push(&validator, input[i]) == 1 );
+    
+    TEST_CHECK( subreg_validator_accepts(&validator) );
+    TEST_CHECK( subreg_validator_push(&validator, 'x') == 0 );
+    TEST_CHECK( !subreg_validator_accepts(&validator) );
+    TEST_CHECK( subreg_validator_push(&validator, '6') == 0 );
+    
+    subreg_validator_reset(&validator);
+    TEST_CHECK( subreg_validator_push(&validator, 'A') == 1 );
+    TEST_CHECK( subreg_validator_push(&validator, 'X') == 0 );
+    
+    /* possessive: "a?" takes the only 'a' and leaves nothing for "a" */
+    TEST_CHECK( subreg_validator_init(&validator, "^(?i)a?ab$", arena, sizeof(arena)) == 0 );
+    TEST_CHECK( subreg_validator_push(&validator, 'A') == 1 );
+    TEST_CHECK( subreg_validator_push(&validator, 'b') == 0 );
+    
+    /* an atom that cannot match anything makes every prefix a dead end */
+    TEST_CHECK( subreg_validator_init(&validator, "a\\x00", arena, sizeof(arena)) == 0 );
+    TEST_CHECK( subreg_validator_push(&validator, 'a') == 0 );
+}
+
+
+static void test_validator_equivalence(void)
+{
+    static const char* const regexes[] = {"a?ab?", "\\d\\d?:\\d\\d", "(?i)a.?\\W", "", "\\!ab?1?"};
+    static const char ALPHABET[] = "aAb1: ";
+    unsigned long arena[256];
+    subreg_validator_t validator;
+    char input[5];
+    unsigned int i;
+    unsigned int j;
+    
+    for (i = 0; i < sizeof(regexes) / sizeof(regexes[0]); i++)
+    {
+        TEST_CHECK( subreg_validator_init(&validator, regexes[i], arena, sizeof(arena)) == 0 );
+        
+        /* every input of up to 4 characters, as digits in base 7 */
+        for (j = 0; j < 7 * 7 * 7 * 7; j++)
+        {
+            unsigned int length;
+            unsigned int k;
+            unsigned int n;
+            
+            subreg_validator_reset(&validator);
+            
+            for (n = j, length = 0; n > 0; n /= 7)
+            {
+                if ( n % 7 == 0 ) break;
+                
+                input[length] = ALPHABET[n % 7 - 1];
+                subreg_validator_push(&validator, input[length]);
+                length++;
+            }
+            
+            if ( n > 0 ) continue;
+            
+            input[length] = '\0';
+            
+            k = (subreg_match(regexes[i], input, NULL, 0, 4) > 0);
+            TEST_CHECK_( subreg_validator_accepts(&validator) == (int) k,
+                    "\"%s\" on \"%s\"", regexes[i], input );
+        }
+    }
+}
+
+
+static void test_validator_unsupported(void)
+{
+    unsigned long arena[256];
+    subreg_validator_t validator;
+    
+    TEST_CHECK( subreg_validator_arena_size("a|b") == 0 );
+    TEST_CHECK( subreg_validator_arena_size("a*") == 0 );
+    TEST_CHECK( subreg_validator_arena_size("(a)") == 0 );
+    TEST_CHECK( subreg_validator_init(&validator, "a+", arena, sizeof(arena)) == SUBREG_RESULT_ILLEGAL_EXPRESSION );
+    TEST_CHECK( subreg_validator_init(&validator, "a\\xZZ", arena, sizeof(arena)) == SUBREG_RESULT_INVALID_METACHARACTER );
+    TEST_CHECK( subreg_validator_init(&validator, "a", arena, sizeof(arena) - 1) == SUBREG_RESULT_INVALID_ARGUMENT );
+}
+
+
+static void test_match_segments(void)
+{
+    static const char* const regexes[] = {"(\\w+)=(\\w*)", "(a|ab)(c|bcd)(d*)", "(?i)(AB)+c?", "(?!ab)(\\w\\w?)\\d", "x*(y)?z$"};
+    static const char* const inputs[] = {"key=value", "abcd", "aBabC", "ab1", "xxyz", "", "a"};
+    subreg_capture_t expected[4];
+    subreg_span_t actual[4];
+    subreg_segment_t segments[3];
+    unsigned int length;
+    unsigned int split;
+    unsigned int i;
+    unsigned int j;
+    int expected_result;
+    int result;
+    int k;
+    
+    for (i = 0; i < sizeof(regexes) / sizeof(regexes[0]); i++)
+    {
+        for (j = 0; j < sizeof(inputs) / sizeof(inputs[0]); j++)
+        {
+            length = (unsigned int) strlen(inputs[j]);
+            expected_result = subreg_match(regexes[i], inputs[j], expected, 4, 4);
+            
+            /* every two-way split, with an empty segment in the middle */
+            for (split = 0; split <= length; split++)
+            {
+                segments[0].start = inputs[j];
+                segments[0].length = split;
+                segments[1].start = NULL;
+                segments[1].length = 0;
+                segments[2].start = inputs[j] + split;
+                segments[2].length = length - split;
+                
+                result = subreg_match_segments(regexes[i], segments, 3, actual, 4, 4);
+                TEST_CHECK_( result == expected_result, "\"%s\" on \"%s\" split at %u",
+                        regexes[i], inputs[j], split );
+                
+                for (k = 0; k < expected_result && result == expected_result; k++)
+                {
+                    TEST_CHECK_( actual[k].offset == (unsigned long) (expected[k].start - inputs[j]) &&
+                            actual[k].length == expected[k].length,
+                            "\"%s\" on \"%s\" split at %u: capture %d differs",
+                            regexes[i], inputs[j], split, k );
+                }
+            }
+        }
+    }
+    
+    /* the two halves of a wrapped ring buffer */
+    segments[0].start = "world";
+    segments[0].length = 5;
+    segments[1].start = "hello ";
+    segments[1].length = 6;
+    TEST_CHECK( subreg_match_segments("world(hel+)o .*", segments, 2, actual, 2, 4) == 2 );
+    TEST_CHECK( actual[1].offset == 5 && actual[1].length == 4 );
+    TEST_CHECK( subreg_match_segments("worldhello", segments, 2, NULL, 0, 4) == 0 );
+    
+    TEST_CHECK( subreg_match_segments("", segments, 0, actual, 1, 4) == 1 );
+    TEST_CHECK( actual[0].offset == 0 && actual[0].length == 0 );
+    TEST_CHECK( subreg_match_segments(NULL, segments, 2, NULL, 0, 4) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_match_segments("a", NULL, 2, NULL, 0, 4) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_match_segments("a", segments, 2, NULL, 1, 4) == SUBREG_RESULT_INVALID_ARGUMENT );
+    
+    segments[1].start = NULL;
+    TEST_CHECK( subreg_match_segments("a", segments, 2, NULL, 0, 4) == SUBREG_RESULT_INVALID_ARGUMENT );
+}
+
+
+static void test_locate(void)
+{
+    subreg_segment_t segments[3];
+    unsigned long segment_offset;
+    unsigned int segment;
+    
+    segments[0].start = "abc";
+    segments[0].length = 3;
+    segments[1].start = "";
+    segments[1].length = 0;
+    segments[2].start = "de";
+    segments[2].length = 2;
+    
+    TEST_CHECK( subreg_locate(segments, 3, 1, &segment, &segment_offset) == 0 );
+    TEST_CHECK( segment == 0 && segment_offset == 1 );
+    
+    /* offsets on a boundary belong to the next non-empty segment */
+    TEST_CHECK( subreg_locate(segments, 3, 3, &segment, &segment_offset) == 0 );
+    TEST_CHECK( segment == 2 && segment_offset == 0 );
+    
+    /* the end of the input is the end of the last segment */
+    TEST_CHECK( subreg_locate(segments, 3, 5, &segment, &segment_offset) == 0 );
+    TEST_CHECK( segment == 2 && segment_offset == 2 );
+    
+    TEST_CHECK( subreg_locate(segments, 3, 6, &segment, &segment_offset) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_locate(segments, 0, 0, &segment, &segment_offset) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_locate(segments, 3, 0, NULL, &segment_offset) == SUBREG_RESULT_INVALID_ARGUMENT );
+}
+
+
+static void test_tracker(void)
+{
+    static const char* const regex = "\\d\\d\\d\\d-\\d\\d-\\d\\d";
+    unsigned long arena[256];
+    char input[32];
+    subreg_checkpoint_t checkpoints[8];
+    subreg_validator_t validator;
+    subreg_tracker_t tracker;
+    
+    strcpy(input, "2024-01-15");
+    
+    TEST_CHECK( subreg_validator_init(&validator, regex, arena, sizeof(arena)) == 0 );
+    TEST_CHECK( subreg_tracker_init(&tracker, &validator, checkpoints, 8, 4, input, 10) == 0 );
+    TEST_CHECK( subreg_tracker_accepts(&tracker) == 1 );
+    TEST_CHECK( tracker.num_checkpoints == 2 );
+    
+    input[5] = 'x';
+    TEST_CHECK( subreg_tracker_edit(&tracker, input, 5, 1, 1) == 0 );
+    TEST_CHECK( subreg_tracker_accepts(&tracker) == 0 );
+    
+    input[5] = '1';
+    TEST_CHECK( subreg_tracker_edit(&tracker, input, 5, 1, 1) == 0 );
+    TEST_CHECK( subreg_tracker_accepts(&tracker) == 1 );
+    
+    strcpy(input, "2024-11-150");
+    TEST_CHECK( subreg_tracker_edit(&tracker, input, 10, 0, 1) == 0 );
+    TEST_CHECK( subreg_tracker_accepts(&tracker) == 0 && tracker.length == 11 );
+    
+    strcpy(input, "12024-11-150");
+    TEST_CHECK( subreg_tracker_edit(&tracker, input, 0, 0, 1) == 0 );
+    TEST_CHECK( subreg_tracker_accepts(&tracker) == 0 );
+    
+    input[11] = '\0';
+    TEST_CHECK( subreg_tracker_edit(&tracker, input, 11, 1, 0) == 0 );
+    TEST_CHECK( subreg_tracker_accepts(&tracker) == 0 && tracker.length == 11 );
+    
+    strcpy(input, "2024-11-15");
+    TEST_CHECK( subreg_tracker_edit(&tracker, input, 0, 1, 0) == 0 );
+    TEST_CHECK( subreg_tracker_accepts(&tracker) == 1 && tracker.length == 10 );
+    
+    /* the validator stays in the same state once it has failed, so an edit
+       after that is only rescanned up to the end of its span */
+    strcpy(input, "x024-11-15");
+    TEST_CHECK( subreg_tracker_edit(&tracker, input, 0, 1, 1) == 0 );
+    TEST_CHECK( subreg_tracker_accepts(&tracker) == 0 );
+    TEST_CHECK( checkpoints[0].state == checkpoints[1].state );
+    
+    /* edits can empty the input and fill it again */
+    TEST_CHECK( subreg_tracker_edit(&tracker, NULL, 0, 10, 0) == 0 );
+    TEST_CHECK( tracker.num_checkpoints == 0 && tracker.length == 0 );
+    TEST_CHECK( subreg_tracker_accepts(&tracker) == 0 );
+    TEST_CHECK( subreg_tracker_edit(&tracker, "1999-12-31", 0, 0, 10) == 0 );
+    TEST_CHECK( subreg_tracker_accepts(&tracker) == 1 && tracker.length == 10 );
+}
+
+
+static void test_tracker_invalid(void)
+{
+    unsigned long arena[256];
+    char input[32];
+    subreg_checkpoint_t checkpoints[3];
+    subreg_validator_t validator;
+    subreg_tracker_t tracker;
+    
+    strcpy(input, "the cat sat");
+    
+    TEST_CHECK( subreg_validator_init(&validator, "the.c.t.?.?.?.?", arena, sizeof(arena)) == 0 );
+    TEST_CHECK( subreg_tracker_init(&tracker, NULL, checkpoints, 3, 4, input, 11) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_tracker_init(&tracker, &validator, checkpoints, 1, 4, input, 11) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_tracker_init(&tracker, &validator, checkpoints, 3, 0, input, 11) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_tracker_init(&tracker, &validator, checkpoints, 3, 4, NULL, 11) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_tracker_init(&tracker, &validator, checkpoints, 3, 4, input, 11) == 0 );
+    TEST_CHECK( subreg_tracker_accepts(&tracker) == 1 );
+    
+    TEST_CHECK( subreg_tracker_edit(&tracker, input, 12, 0, 0) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_tracker_edit(&tracker, input, 8, 4, 0) == SUBREG_RESULT_INVALID_ARGUMENT );
+    
+    /* 20 characters would need five spans */
+    strcpy(input, "the cat sat on a mat");
+    TEST_CHECK( subreg_tracker_edit(&tracker, input, 11, 0, 9) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( tracker.length == 11 && subreg_tracker_accepts(&tracker) == 1 );
+}
+
+
+static void test_tracker_equivalence(void)
+{
+    static const char* const regexes[] = {"a?b.c?", "\\dab?c", "a.?.?b?c", "(?i)a?B?c?A?b?C?", "^a{1,3}b?$"};
+    static const char ALPHABET[] = "abcxAB1";
+    unsigned long arena[256];
+    char input[32];
+    subreg_checkpoint_t checkpoints[16];
+    subreg_checkpoint_t fresh_checkpoints[16];
+    subreg_validator_t validator;
+    subreg_tracker_t tracker;
+    subreg_tracker_t fresh;
+    unsigned long length;
+    unsigned long seed;
+    unsigned int i;
+    unsigned int j;
+    
+    seed = 1;
+    
+    for (i = 0; i < sizeof(regexes) / sizeof(regexes[0]); i++)
+    {
+        TEST_CHECK( subreg_validator_init(&validator, regexes[i], arena, sizeof(arena)) == 0 );
+        
+        input[0] = '\0';
+        length = 0;
+        TEST_CHECK( subreg_tracker_init(&tracker, &validator, checkpoints, 16, 2, input, 0) == 0 );
+        
+        for (j = 0; j < 2000; j++)
+        {
+            unsigned long offset;
+            unsigned long removed;
+            unsigned long inserted;
+            unsigned long k;
+            int expected;
+            
+            /* a pseudo-random edit, keeping the input short enough to match */
+            seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+            offset = (seed >> 8) % (length + 1);
+            removed = (seed >> 4) % 4;
+            inserted = (length < 8) ? seed % 4 : 0;
+            if ( removed > length - offset ) removed = length - offset;
+            
+            for (k = offset + removed; k <= length; k++)
+                input[k - removed] = input[k];
+            
+            for (k = length - removed + 1; k-- > offset;)
+                input[k + inserted] = input[k];
+            
+            for (k = 0; k < inserted; k++)
+                input[offset + k] = ALPHABET[(seed >> (k + 12)) % 7];
+            
+            length = length - removed + inserted;
+            
+            TEST_CHECK( subreg_tracker_edit(&tracker, input, offset, removed, inserted) == 0 );
+            TEST_CHECK( subreg_tracker_init(&fresh, &validator, fresh_checkpoints, 16, 2, input, length) == 0 );
+            
+            expected = (subreg_match(regexes[i], input, NULL, 0, 4) > 0);
+            TEST_CHECK_( subreg_tracker_accepts(&tracker) == expected &&
+                    subreg_tracker_accepts(&fresh) == expected && tracker.length == length,
+                    "\"%s\" on \"%s\"", regexes[i], input );
+        }
+    }
+}
+
+
+static void check_plan(const char* regex, void* arena, int plan,
+        const char* explanation)
+{
+    subreg_matcher_t matcher;
+    char buffer[80];
+    
+    TEST_CHECK( subreg_matcher_init(&matcher, regex, 4, arena, arena ? 256 * sizeof(unsigned long) : 0) == 0 );
+    TEST_CHECK_( matcher.plan == plan, "\"%s\": plan %d", regex, matcher.plan );
+    
+    subreg_matcher_explain(&matcher, buffer, sizeof(buffer));
+    TEST_CHECK_( strcmp(buffer, explanation) == 0, "\"%s\": %s", regex, buffer );
+}
+
+
+static void test_matcher_plan(void)
+{
+    unsigned long arena[256];
+    
+    check_plan("Content-Length", NULL, SUBREG_PLAN_LITERAL, "plan=literal reason=plain depth=0 groups=0");
+    check_plan("\\d\\d?:\\d\\d", arena, SUBREG_PLAN_AUTOMATON, "plan=automaton reason=atoms depth=0 groups=0");
+    check_plan("^(\\d\\d):(?:\\d\\d)$", arena, SUBREG_PLAN_PREFILTER, "plan=prefilter reason=captures depth=1 groups=1");
+    check_plan("\\d\\d?:\\d\\d", NULL, SUBREG_PLAN_INTERPRETER, "plan=interpreter reason=no-arena depth=0 groups=0");
+    check_plan("(GET|PUT) (\\w+)", arena, SUBREG_PLAN_INTERPRETER, "plan=interpreter reason=alternation,repetition depth=1 groups=2");
+    check_plan("(?!x)(a)?", arena, SUBREG_PLAN_INTERPRETER, "plan=interpreter reason=repetition,look-ahead depth=1 groups=1");
+    check_plan("a(?i)b^", arena, SUBREG_PLAN_INTERPRETER, "plan=interpreter reason=option,anchor depth=1 groups=0");
+}
+
+
+static void test_matcher_equivalence(void)
+{
+    static const char* const regexes[] =
+    {
+        "abc", "(?i)aBc", "", "a?b", "(a)(b?)c", "^(\\d\\d):(?:\\d)\\d$",
+        "(?i)(a?)a", "((a)b)", "(a)?b", "a|b", "\\!ab.", "\\x41(b)", "(a)$"
+    };
+    
+    static const char ALPHABET[] = "aAbc1:";
+    unsigned long arena[256];
+    subreg_capture_t expected[4];
+    subreg_capture_t actual[4];
+    subreg_matcher_t matcher;
+    char input[5];
+    unsigned int max_captures;
+    unsigned int i;
+    unsigned int j;
+    int expected_result;
+    int result;
+    int k;
+    
+    for (i = 0; i < sizeof(regexes) / sizeof(regexes[0]); i++)
+    {
+        TEST_CHECK( subreg_matcher_init(&matcher, regexes[i], 4, arena, sizeof(arena)) == 0 );
+        
+        /* every input of up to 4 characters, as digits in base 7 */
+        for (j = 0; j < 7 * 7 * 7 * 7; j++)
+        {
+            unsigned int length;
+            unsigned int n;
+            
+            for (n = j, length = 0; n > 0; n /= 7)
+            {
+                if ( n % 7 == 0 ) break;
+                input[length++] = ALPHABET[n % 7 - 1];
+            }
+            
+            if ( n > 0 ) continue;
+            
+            input[length] = '\0';
+            
+            for (max_captures = 0; max_captures <= 4; max_captures++)
+            {
+                expected_result = subreg_match(regexes[i], input, expected, max_captures, 4);
+                result = subreg_matcher_match(&matcher, input, actual, max_captures);
+                
+                TEST_CHECK_( result == expected_result, "\"%s\" on \"%s\" with %u captures",
+                        regexes[i], input, max_captures );
+                
+                for (k = 0; k < expected_result && k < (int) max_captures && result == expected_result; k++)
+                {
+                    TEST_CHECK_( actual[k].start == expected[k].start && actual[k].length == expected[k].length,
+                            "\"%s\" on \"%s\": capture %d differs", regexes[i], input, k );
+                }
+            }
+        }
+    }
+}
+
+
+static void test_matcher_invalid(void)
+{
+    unsigned long arena[256];
+    subreg_matcher_t matcher;
+    subreg_capture_t capture;
+    
+    TEST_CHECK( subreg_matcher_arena_size("abc") == 0 );
+    TEST_CHECK( subreg_matcher_arena_size("a+") == 0 );
+    TEST_CHECK( subreg_matcher_arena_size("(a)b?") == sizeof(arena) );
+    
+    TEST_CHECK( subreg_matcher_init(&matcher, "(a", 4, arena, sizeof(arena)) == SUBREG_RESULT_MISSING_BRACKET );
+    TEST_CHECK( subreg_matcher_init(&matcher, "((a))", 1, arena, sizeof(arena)) == SUBREG_RESULT_MAX_DEPTH_EXCEEDED );
+    TEST_CHECK( subreg_matcher_init(&matcher, NULL, 4, arena, sizeof(arena)) == SUBREG_RESULT_INVALID_ARGUMENT );
+    
+    /* an arena that is too small just rules out the automaton */
+    TEST_CHECK( subreg_matcher_init(&matcher, "a?b", 4, arena, sizeof(arena) - 1) == 0 );
+    TEST_CHECK( matcher.plan == SUBREG_PLAN_INTERPRETER );
+    
+    TEST_CHECK( subreg_matcher_match(&matcher, NULL, NULL, 0) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_matcher_match(&matcher, "b", NULL, 1) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_matcher_match(&matcher, "b", &capture, 1) == 1 );
+}
+
+
+static void test_lexer(void)
+{
+    static const char* const patterns[] = {"\\s+", "if|else", "\\w+", "==|=", "\\d+"};
+    static const unsigned int ids[] = {1, 0, 2, 0, 3, 0, 2, 0, 2};
+    unsigned long arena[256];
+    subreg_token_t tokens[16];
+    subreg_lexer_t lexer;
+    unsigned long consumed;
+    unsigned int i;
+    
+    TEST_CHECK( subreg_lexer_init(&lexer, patterns, 5, 4, arena, sizeof(arena)) == 0 );
+    
+    /* "10" ties between "\w+" and "\d+", and "\w+" outlasts "else" */
+    TEST_CHECK( subreg_lexer_run(&lexer, "if x == 10 elsewhere", 20, tokens, 16, &consumed) == 9 );
+    TEST_CHECK( consumed == 20 );
+    
+    for (i = 0; i < 9; i++) TEST_CHECK_( tokens[i].id == ids[i], "token %u", i );
+    
+    TEST_CHECK( tokens[4].offset == 5 && tokens[4].length == 2 );
+    TEST_CHECK( tokens[8].offset == 11 && tokens[8].length == 9 );
+    
+    /* lexing stops where nothing matches or tokens is full */
+    TEST_CHECK( subreg_lexer_run(&lexer, "x = $", 5, tokens, 16, &consumed) == 4 );
+    TEST_CHECK( consumed == 4 );
+    TEST_CHECK( subreg_lexer_run(&lexer, "x = $", 5, tokens, 2, &consumed) == 2 );
+    TEST_CHECK( consumed == 2 );
+    TEST_CHECK( subreg_lexer_run(&lexer, "", 0, NULL, 0, &consumed) == 0 );
+    TEST_CHECK( consumed == 0 );
+    
+    /* input need not be null-terminated */
+    TEST_CHECK( subreg_lexer_run(&lexer, "ifx", 2, tokens, 16, &consumed) == 1 );
+    TEST_CHECK( tokens[0].id == 1 && tokens[0].length == 2 );
+}
+
+
+static void test_lexer_equivalence(void)
+{
+    static const char* const patterns[] =
+    {
+        "\\d+", "\\w+", "(?i)if", "a?b", "(x)*y", "(?=b)\\w\\w", "(?:ab|c)+",
+        "\\s+", "$a", "a(?i)B", "x?\\!a", "^c", "(a|)b", "(?!a).", "\\x41+"
+    };
+    
+    static const char* const inputs[] =
+    {
+        "if IF iF 12ab", "xxyab cab ccab", "bbAB aB Ab", "$a$ax1", "AAA  a ba"
+    };
+    
+    unsigned long arena[256];
+    subreg_token_t tokens[32];
+    subreg_capture_t capture[4];
+    subreg_lexer_t lexer;
+    char anchored[16];
+    unsigned long consumed;
+    unsigned long position;
+    unsigned int i;
+    unsigned int j;
+    unsigned int k;
+    int count;
+    
+    /* each window of three patterns, against a lexer made of searches */
+    for (i = 0; i + 3 <= sizeof(patterns) / sizeof(patterns[0]); i++)
+    {
+        TEST_CHECK( subreg_lexer_init(&lexer, patterns + i, 3, 4, arena, sizeof(arena)) == 0 );
+        
+        for (j = 0; j < sizeof(inputs) / sizeof(inputs[0]); j++)
+        {
+            count = subreg_lexer_run(&lexer, inputs[j], strlen(inputs[j]), tokens, 32, &consumed);
+            position = 0;
+            
+            /* where lexing stops, the searches must find nothing either */
+            for (k = 0; k <= (unsigned int) count && position < strlen(inputs[j]); k++)
+            {
+                unsigned int best_length;
+                unsigned int best;
+                unsigned int p;
+                
+                best_length = 0;
+                best = 0;
+                
+                for (p = 0; p < 3; p++)
+                {
+                    anchored[0] = '^';
+                    strcpy(anchored + 1, patterns[i + p] + (patterns[i + p][0] == '^'));
+                    
+                    if ( subreg_search(anchored, inputs[j] + position, capture, 4, 4) > 0 &&
+                            capture[0].length > best_length )
+                    {
+                        best_length = capture[0].length;
+                        best = p;
+                    }
+                }
+                
+                if ( k == (unsigned int) count )
+                {
+                    TEST_CHECK_( best_length == 0, "patterns from %u on \"%s\": stopped early",
+                            i, inputs[j] );
+                    break;
+                }
+                
+                TEST_CHECK_( tokens[k].offset == position && tokens[k].id == best &&
+                        tokens[k].length == best_length,
+                        "patterns from %u on \"%s\": token %u", i, inputs[j], k );
+                
+                position += best_length;
+            }
+            
+            TEST_CHECK_( consumed == position, "patterns from %u on \"%s\"", i, inputs[j] );
+        }
+    }
+}
+
+
+static void test_lexer_invalid(void)
+{
+    static const char* const patterns[] = {"\\w+", "(a"};
+    unsigned long arena[256];
+    subreg_token_t token;
+    subreg_lexer_t lexer;
+    
+    TEST_CHECK( subreg_lexer_arena_size(2) == sizeof(arena) );
+    TEST_CHECK( subreg_lexer_arena_size(sizeof(unsigned long) * 8 + 1) == 0 );
+    
+    TEST_CHECK( subreg_lexer_init(&lexer, patterns, 2, 4, arena, sizeof(arena)) == SUBREG_RESULT_MISSING_BRACKET );
+    TEST_CHECK( subreg_lexer_init(&lexer, patterns, 1, 4, arena, sizeof(arena) - 1) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_lexer_init(&lexer, patterns, 1, 4, arena, sizeof(arena)) == 0 );
+    
+    TEST_CHECK( subreg_lexer_run(&lexer, "abc", 3, &token, 1, NULL) == SUBREG_RESULT_INVALID_ARGUMENT );
+    TEST_CHECK( subreg_lexer_run(&lexer, NULL, 3, &token, 1, NULL) == SUBREG_RESULT_INVALID_ARGUMENT );
+}
+
+
+static void test_counted_repetition(void)
+{
+    subreg_capture_t cap[4];
+    
+    TEST_CHECK( subreg_match("a{3}", "aaa", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match("a{3}", "aa", NULL, 0, 4) == 0 );
+    TEST_CHECK( subreg_match("a{3}", "aaaa", NULL, 0, 4) == 0 );
+    TEST_CHECK( subreg_match("a{2,3}b", "aab", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match("a{2,3}b", "aaaab", NULL, 0, 4) == 0 );
+    TEST_CHECK( subreg_match("a{2,}", "aaaaaaaa", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match("a{2,}", "a", NULL, 0, 4) == 0 );
+    TEST_CHECK( subreg_match("a{0,1}b", "b", NULL, 0, 4) == 1 );
+    
+    /* possessive, so a range takes all it can */
+    TEST_CHECK( subreg_match("a{1,3}a", "aaa", NULL, 0, 4) == 0 );
+    
+    /* repeated groups capture each iteration, as "(ab)(ab)" would */
+    TEST_CHECK( subreg_match("(ab){2}", "abab", cap, 4, 4) == 3 );
+    TEST_CHECK( cap[1].start - cap[0].start == 0 && cap[1].length == 2 );
+    TEST_CHECK( cap[2].start - cap[0].start == 2 && cap[2].length == 2 );
+    
+    /* a count of zero gives back what it consumed and captured */
+    TEST_CHECK( subreg_match("(a){0}a", "a", cap, 4, 4) == 1 );
+    TEST_CHECK( subreg_match("a{0}", "", NULL, 0, 4) == 1 );
+    
+    /* an iteration that consumes nothing satisfies the rest */
+    TEST_CHECK( subreg_match("(?:a?){3}b", "ab", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match("(?:){1000}", "", NULL, 0, 4) == 1 );
+    
+    /* '{' is a literal where it cannot be a quantifier */
+    TEST_CHECK( subreg_match("{2}", "{2}", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match("a*{2}", "aa{2}", NULL, 0, 4) == 1 );
+}
+
+
+static void test_counted_repetition_invalid(void)
+{
+    static const char* const regexes[] = {"a{3,2}", "a{1001}", "a{0,99999999999}", "(a){2,1}"};
+    static const char* const literals[] = {"x{y}", "a{", "a{1,x}", "a{}", "a{,2}", "a{2", "a{2,", "a{x}", "a{2,3,4}"};
+    subreg_cost_t cost;
+    unsigned int i;
+    
+    for (i = 0; i < sizeof(regexes) / sizeof(regexes[0]); i++)
+    {
+        TEST_CHECK_( subreg_match(regexes[i], "aa", NULL, 0, 4) == SUBREG_RESULT_ILLEGAL_EXPRESSION, "\"%s\"", regexes[i] );
+        TEST_CHECK_( subreg_analyze(regexes[i], 4, &cost) == SUBREG_RESULT_ILLEGAL_EXPRESSION, "\"%s\"", regexes[i] );
+    }
+    
+    /* a '{' that does not start well-formed bounds is a plain character */
+    for (i = 0; i < sizeof(literals) / sizeof(literals[0]); i++)
+    {
+        TEST_CHECK_( subreg_match(literals[i], literals[i], NULL, 0, 4) == 1, "\"%s\"", literals[i] );
+        TEST_CHECK_( subreg_analyze(literals[i], 4, &cost) == 0, "\"%s\"", literals[i] );
+    }
+    
+    TEST_CHECK( subreg_match("(a){x", "a{x", NULL, 0, 4) == 1 );
+    TEST_CHECK( subreg_match("a{1,x}", "a", NULL, 0, 4) == 0 );
+    TEST_CHECK( subreg_search("a{1,x}", "-a{1,x}", NULL, 0, 4) == 1 );
+    
+    TEST_CHECK( SUBREG_REPEAT_MAX == 1000 );
+    TEST_CHECK( subreg_analyze("a{1000}", 4, &cost) == 0 );
+    TEST_CHECK( subreg_analyze("a{2,5}", 4, &cost) == 0 && cost.degree == 1 );
+    TEST_CHECK( subreg_analyze("a{0,1}", 4, &cost) == 0 && cost.degree == 0 );
+}
+
+
+static void test_counted_repetition_automata(void)
+{
+    static const char uuid[] = "\\h{8}-\\h{4}-\\h{4}-\\h{4}-\\h{12}";
+    static const char mac[] = "\\h{2}(?::\\h{2}){5}";
+    static const char* const inputs[] = {"id=123e4567-e89b-12d3-a456-426614174000;", "123e4567-e89b-12d3-a456-42661417400", "-123e4567-e89b-12d3-a456-4266141740000", "x"};
+    unsigned long arena[512];
+    subreg_searcher_t searcher;
+    subreg_validator_t validator;
+    subreg_matcher_t matcher;
+    subreg_capture_t expected[1];
+    subreg_capture_t actual[1];
+    unsigned int i;
+    int result;
+    
+    /* bounded repetitions of single characters expand into bitap atoms */
+    TEST_CHECK( subreg_searcher_init(&searcher, uuid, 4, arena, sizeof(arena)) == 0 );
+    TEST_CHECK( searcher.engine == SUBREG_ENGINE_BITAP );
+    TEST_CHECK( searcher.max_length == 36 );
+    
+    for (i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++)
+    {
+        result = subreg_search(uuid, inputs[i], expected, 1, 4);
+        TEST_CHECK_( subreg_searcher_search(&searcher, inputs[i], actual, 1) == result, "\"%s\"", inputs[i] );
+        
+        if ( result > 0 )
+            TEST_CHECK( actual[0].start == expected[0].start && actual[0].length == expected[0].length );
+    }
+    
+    TEST_CHECK( subreg_validator_init(&validator, "\\d{1,2}:\\d{2}", arena, sizeof(arena)) == 0 );
+    TEST_CHECK( subreg_validator_push(&validator, '1') && subreg_validator_push(&validator, '2') );
+    TEST_CHECK( !subreg_validator_push(&validator, '3') );
+    
+    /* but unbounded ones cannot, and nor can repeated groups */
+    TEST_CHECK( subreg_validator_arena_size("a{2,}") == 0 );
+    TEST_CHECK( subreg_validator_arena_size("(?:ab){2}") == 0 );
+    
+    TEST_CHECK( subreg_matcher_init(&matcher, uuid, 4, arena, 256 * sizeof(unsigned long)) == 0 );
+    TEST_CHECK( matcher.plan == SUBREG_PLAN_AUTOMATON );
+    TEST_CHECK( subreg_matcher_match(&matcher, inputs[0] + 3, NULL, 0) == 0 );
+    TEST_CHECK( subreg_matcher_match(&matcher, "123E4567-E89B-12D3-A456-426614174000", NULL, 0) == 1 );
+    
+    TEST_CHECK( subreg_matcher_init(&matcher, mac, 4, arena, 256 * sizeof(unsigned long)) == 0 );
+    TEST_CHECK( matcher.plan == SUBREG_PLAN_INTERPRETER );
+    TEST_CHECK( subreg_matcher_match(&matcher, "00:1a:2B:3c:4D:5e", NULL, 0) == 1 );
+    TEST_CHECK( subreg_matcher_match(&matcher, "00:1a:2B:3c:4D", NULL, 0) == 0 );
+}
+
 TEST_LIST =
 {
     {"empty_pass",                          test_empty_pass},
@@ -992,6 +2413,56 @@ TEST_LIST =
     {"capture_inverted_match",              test_capture_inverted_match},
     {"inverted_hex_match",                  test_inverted_hex_match},
     {"inverted_hex_non_match",              test_inverted_hex_non_match},
+    {"memo_hit",                            test_memo_hit},
+    {"memo_miss",                           test_memo_miss},
+    {"memo_max_captures",                   test_memo_max_captures},
+    {"memo_bypass",                         test_memo_bypass},
+    {"memo_totals",                         test_memo_totals},
+    {"memo_eviction",                       test_memo_eviction},
+    {"stats_counts",                        test_stats_counts},
+    {"stats_histogram",                     test_stats_histogram},
+    {"stats_merge",                         test_stats_merge},
+    {"stats_format",                        test_stats_format},
+    {"empty_repetition",                    test_empty_repetition},
+    {"option_depth",                        test_option_depth},
+    {"empty_branch",                        test_empty_branch},
+    {"input_end",                           test_input_end},
+    {"match_n",                             test_match_n},
+    {"analyze_invalid",                     test_analyze_invalid},
+    {"analyze_depth",                       test_analyze_depth},
+    {"analyze_degree",                      test_analyze_degree},
+    {"analyze_bound",                       test_analyze_bound},
+    {"analyze_negated_operand",             test_analyze_negated_operand},
+    {"image_build",                         test_image_build},
+    {"image_match",                         test_image_match},
+    {"image_invalid_regex",                 test_image_invalid_regex},
+    {"image_corrupt",                       test_image_corrupt},
+    {"search",                              test_search},
+    {"search_errors",                       test_search_errors},
+    {"searcher_engine",                     test_searcher_engine},
+    {"searcher_equivalence",                test_searcher_equivalence},
+    {"searcher_bitap",                      test_searcher_bitap},
+    {"searcher_bitap_long",                 test_searcher_bitap_long},
+    {"searcher_literal",                    test_searcher_literal},
+    {"stream",                              test_stream},
+    {"stream_invalid",                      test_stream_invalid},
+    {"validator",                           test_validator},
+    {"validator_equivalence",               test_validator_equivalence},
+    {"validator_unsupported",               test_validator_unsupported},
+    {"match_segments",                      test_match_segments},
+    {"locate",                              test_locate},
+    {"tracker",                             test_tracker},
+    {"tracker_invalid",                     test_tracker_invalid},
+    {"tracker_equivalence",                 test_tracker_equivalence},
+    {"matcher_plan",                        test_matcher_plan},
+    {"matcher_equivalence",                 test_matcher_equivalence},
+    {"matcher_invalid",                     test_matcher_invalid},
+    {"lexer",                               test_lexer},
+    {"lexer_equivalence",                   test_lexer_equivalence},
+    {"lexer_invalid",                       test_lexer_invalid},
+    {"counted_repetition",                  test_counted_repetition},
+    {"counted_repetition_invalid",          test_counted_repetition_invalid},
+    {"counted_repetition_automata",         test_counted_repetition_automata},
     {0}
 };
 
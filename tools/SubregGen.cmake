@@ -0,0 +1,47 @@
+# SubReg - A small footprint regular expression engine written in ANSI C.
+# 
+# https://github.com/mattbucknall/subreg
+# 
+# Copyright (c) 2016-2021 Matthew T. Bucknall
+# 
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+# 
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+# 
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISIN
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+
+# subreg_generate(<spec-file> <output-base> [subreg-gen options...])
+#
+# Adds a custom command that runs subreg-gen on <spec-file>, producing
+# <output-base>.c and <output-base>.h. A relative <output-base> is taken to
+# be relative to the current binary directory. Any further arguments, such
+# as "-d 8" or "-t table", are passed to subreg-gen. List <output-base>.c
+# among a target's sources to build the generated matchers into it.
+
+function(subreg_generate spec output_base)
+    get_filename_component(spec_path "${spec}" ABSOLUTE)
+
+    if(NOT IS_ABSOLUTE "${output_base}")
+        set(output_base "${CMAKE_CURRENT_BINARY_DIR}/${output_base}")
+    endif()
+
+    add_custom_command(
+        OUTPUT "${output_base}.c" "${output_base}.h"
+        COMMAND subreg-gen ${ARGN}
+            -o "${output_base}.c" -H "${output_base}.h" "${spec_path}"
+        DEPENDS subreg-gen "${spec_path}"
+        COMMENT "Generating SubReg matchers from ${spec}"
+    )
+endfunction()
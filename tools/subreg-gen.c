@@ -0,0 +1,2249 @@
+/**
+ * SubReg - A small footprint regular expression engine written in ANSI C.
+ *
+ * https://github.com/mattbucknall/subreg
+ *
+ * Copyright (c) 2016-2021 Matthew T. Bucknall
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISIN
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Offline code generator. Translates SubReg regular expressions into
+ * standalone C matcher functions that behave exactly like subreg_match()
+ * with a fixed regex and max_depth, but do no interpretation at run time.
+ *
+ * Usage:
+ *   subreg-gen [-d max-depth] [-o output.c] [-H output.h] spec-file
+ *
+ * Each non-blank line of spec-file that does not start with '#' names a
+ * function and gives its regular expression as a C string literal:
+ *
+ *   http_method "GET|PUT|POST"
+ *   version     "(\\d+)\\.(\\d+)"
+ *
+ * For each line, the generated source defines
+ *
+ *   const char name_regex[];
+ *   int name(const char* input, subreg_capture_t captures[],
+ *           unsigned int max_captures);
+ *
+ * With -t, it also defines a table of every function in the spec file, so
+ * that callers can select a matcher by index:
+ *
+ *   const subreg_gen_entry_t table[];
+ *   const unsigned int table_count;
+ *
+ * Invalid regular expressions are rejected at generation time.
+ */
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <subreg.h>
+
+
+#define MAX_LINE_LENGTH         4096
+#define MAX_NAME_LENGTH         64
+
+#define CASE_EXACT              (1 << 0)
+#define CASE_FOLD               (1 << 1)
+
+#define FIRST_NULLABLE          (1 << 0)
+#define FIRST_OPAQUE            (1 << 1)
+
+/* alternations at least this wide dispatch on their first input byte */
+#define DISPATCH_MIN_BRANCHES   4
+
+/* sets needing more ranges than this are not worth testing */
+#define MAX_SET_RANGES          8
+
+/* alternations of at least this many literals are matched by hashing */
+#define KEYWORD_MIN_BRANCHES    8
+
+/* the maximum of a counted repetition "{m,}" */
+#define REPEAT_UNBOUNDED        ((unsigned int) -1)
+
+
+typedef enum
+{
+    NODE_EMPTY,
+    NODE_CHAR,
+    NODE_ANY,
+    NODE_CLASS,
+    NODE_NOT_CHAR,
+    NODE_OPTION,
+    NODE_GROUP,
+    NODE_REPEAT,
+    NODE_SPAN,
+    NODE_ACCEPT,
+    NODE_CONCAT,
+    NODE_ALT,
+    NODE_KEYWORDS
+
+} node_kind_t;
+
+
+typedef enum
+{
+    GROUP_NON_CAPTURE,
+    GROUP_CAPTURE,
+    GROUP_POS_LOOK_AHEAD,
+    GROUP_NEG_LOOK_AHEAD
+
+} group_mode_t;
+
+
+typedef struct node_t
+{
+    node_kind_t kind;
+    int id;
+
+    /* NODE_CHAR, NODE_NOT_CHAR: character; NODE_CLASS: class letter;
+       NODE_OPTION: option letter; NODE_REPEAT, NODE_SPAN, NODE_ACCEPT:
+       quantifier */
+    char c;
+
+    /* NODE_CHAR, NODE_NOT_CHAR: CASE_* flags for the options it may be
+       matched under; NODE_KEYWORDS: CASE_FOLD if matched without case */
+    int cases;
+
+    /* NODE_REPEAT, NODE_SPAN with quantifier '{': bounds */
+    unsigned int min;
+    unsigned int max;
+
+    /* NODE_GROUP */
+    group_mode_t mode;
+
+    /* NODE_GROUP, NODE_REPEAT, NODE_SPAN: one child; NODE_CONCAT, NODE_ALT,
+       NODE_KEYWORDS: many */
+    struct node_t** children;
+    int num_children;
+
+} node_t;
+
+
+typedef struct
+{
+    const char* regex;
+    int next_id;
+    int uses_options;
+
+    /* flags the failure labels that some goto refers to */
+    char* jumps;
+
+} parser_t;
+
+
+static FILE* out;
+static int indent;
+
+
+static void* xmalloc(size_t size)
+{
+    void* p;
+
+    p = malloc(size);
+
+    if ( !p )
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return p;
+}
+
+
+static node_t* new_node(parser_t* parser, node_kind_t kind)
+{
+    node_t* node;
+
+    node = xmalloc(sizeof(node_t));
+    memset(node, 0, sizeof(node_t));
+
+    node->kind = kind;
+    node->id = parser->next_id++;
+
+    return node;
+}
+
+
+static void add_child(node_t* parent, node_t* child)
+{
+    node_t** children;
+
+    children = xmalloc((parent->num_children + 1) * sizeof(node_t*));
+
+    if ( parent->num_children )
+        memcpy(children, parent->children, parent->num_children * sizeof(node_t*));
+
+    free(parent->children);
+
+    parent->children = children;
+    parent->children[parent->num_children++] = child;
+}
+
+
+static int hex_value(char c)
+{
+    if ( c >= '0' && c <= '9' ) return c - '0';
+    if ( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+    return c - 'a' + 10;
+}
+
+
+/*
+ * The parser mirrors the structure of subreg.c's parse_* functions. It only
+ * sees regular expressions that subreg_analyze() has accepted, so it does
+ * not repeat any of the error checking.
+ */
+
+static char parse_non_class_metacharacter(parser_t* parser)
+{
+    char rc;
+
+    rc = *parser->regex++;
+
+    switch (rc)
+    {
+    case 'b':   return '\b';
+    case 'f':   return '\f';
+    case 'n':   return '\n';
+    case 'r':   return '\r';
+    case 't':   return '\t';
+    case 'v':   return '\v';
+
+    case 'x':
+        rc = (char) ((hex_value(parser->regex[0]) << 4) |
+                hex_value(parser->regex[1]));
+        parser->regex += 2;
+        return rc;
+
+    default:
+        return rc;
+    }
+}
+
+
+static node_t* parse_alternation(parser_t* parser);
+
+
+static node_t* parse_literal(parser_t* parser)
+{
+    node_t* node;
+    char rc;
+
+    rc = parser->regex[0];
+
+    if ( rc == '\0' ) return new_node(parser, NODE_EMPTY);
+
+    parser->regex++;
+
+    if ( rc == '(' )
+    {
+        node = new_node(parser, NODE_GROUP);
+        node->mode = GROUP_CAPTURE;
+
+        if ( parser->regex[0] == '?' )
+        {
+            rc = parser->regex[1];
+            parser->regex += 2;
+
+            if ( rc == ':' ) node->mode = GROUP_NON_CAPTURE;
+            else if ( rc == '=' ) node->mode = GROUP_POS_LOOK_AHEAD;
+            else if ( rc == '!' ) node->mode = GROUP_NEG_LOOK_AHEAD;
+            else
+            {
+                node->kind = NODE_OPTION;
+                node->c = rc;
+                parser->regex++;
+                parser->uses_options = 1;
+                return node;
+            }
+        }
+
+        add_child(node, parse_alternation(parser));
+        parser->regex++;
+
+        return node;
+    }
+    else if ( rc == '\\' )
+    {
+        rc = parser->regex[0];
+
+        if ( strchr("DHSWdhsw", rc) )
+        {
+            node = new_node(parser, NODE_CLASS);
+            node->c = rc;
+            parser->regex++;
+        }
+        else if ( rc == '!' )
+        {
+            node = new_node(parser, NODE_NOT_CHAR);
+            rc = parser->regex[1];
+            parser->regex += 2;
+            node->c = (rc == '\\') ? parse_non_class_metacharacter(parser) : rc;
+        }
+        else
+        {
+            node = new_node(parser, NODE_CHAR);
+            node->c = parse_non_class_metacharacter(parser);
+        }
+
+        return node;
+    }
+    else if ( rc == '.' )
+    {
+        return new_node(parser, NODE_ANY);
+    }
+
+    node = new_node(parser, NODE_CHAR);
+    node->c = rc;
+
+    return node;
+}
+
+
+/*
+ * Checks whether the '{' at regex starts counted repetition bounds. Any
+ * other '{' is a plain character, as it is to subreg_match().
+ */
+static int is_count(const char* regex)
+{
+    regex++;
+
+    if ( !isdigit((unsigned char) regex[0]) ) return 0;
+    while ( isdigit((unsigned char) regex[0]) ) regex++;
+
+    if ( regex[0] == ',' )
+    {
+        regex++;
+        while ( isdigit((unsigned char) regex[0]) ) regex++;
+    }
+
+    return regex[0] == '}';
+}
+
+
+static node_t* parse_repetition(parser_t* parser)
+{
+    node_t* atom;
+    node_t* node;
+    char* end;
+    char rc;
+
+    atom = parse_literal(parser);
+    rc = parser->regex[0];
+
+    if ( rc != '?' && rc != '*' && rc != '+' &&
+            (rc != '{' || !is_count(parser->regex)) )
+        return atom;
+
+    parser->regex++;
+
+    node = new_node(parser, NODE_REPEAT);
+    node->c = rc;
+    add_child(node, atom);
+
+    if ( rc == '{' )
+    {
+        node->min = (unsigned int) strtoul(parser->regex, &end, 10);
+        node->max = node->min;
+
+        if ( end[0] == ',' )
+        {
+            end++;
+
+            if ( end[0] == '}' ) node->max = REPEAT_UNBOUNDED;
+            else node->max = (unsigned int) strtoul(end, &end, 10);
+        }
+
+        parser->regex = end + 1;
+    }
+
+    return node;
+}
+
+
+static int is_block_boundary(char c)
+{
+    return (c == '\0') || (c == '|') || (c == '$');
+}
+
+
+static node_t* parse_concatenation(parser_t* parser)
+{
+    node_t* node;
+
+    node = new_node(parser, NODE_CONCAT);
+
+    do
+    {
+        if ( parser->regex[0] == ')' ) break;
+        add_child(node, parse_repetition(parser));
+
+    } while ( !is_block_boundary(parser->regex[0]) );
+
+    return node;
+}
+
+
+static node_t* parse_alternation(parser_t* parser)
+{
+    node_t* node;
+
+    node = new_node(parser, NODE_ALT);
+
+    for (;;)
+    {
+        add_child(node, parse_concatenation(parser));
+
+        if ( parser->regex[0] != '|' ) break;
+        parser->regex++;
+    }
+
+    return node;
+}
+
+
+/*
+ * Peephole optimisation of the parsed tree. Every rewrite keeps the exact
+ * behaviour of subreg.c's parse_* functions, which subreg-gen-tests checks:
+ *
+ *  - non-capturing groups that always match empty, such as "(?:)", and any
+ *    repetition of them, are removed;
+ *  - "X*", "X+" and "X{m,n}" over a single-byte atom become span loops,
+ *    which need no progress check as every iteration consumes exactly one
+ *    byte, and count iterations by how far they have got;
+ *  - ".*" and ".+" ending a top-level alternative accept the rest of the
+ *    input, without scanning it when no captures are wanted;
+ *  - where the case options in force can be worked out in advance, literals
+ *    are compared directly instead of testing the options at run time;
+ *  - wide alternations of plain literals are matched by hashing the input
+ *    once, instead of trying each literal in turn;
+ *  - adjacent alternatives that start with the same atoms share one match
+ *    of them, followed by an alternation of what is left of each.
+ */
+
+static int is_single_byte(const node_t* node)
+{
+    return (node->kind == NODE_CHAR && node->c != '\0') ||
+            node->kind == NODE_ANY || node->kind == NODE_CLASS ||
+            node->kind == NODE_NOT_CHAR;
+}
+
+
+static int is_empty_group(const node_t* node)
+{
+    const node_t* branch;
+    int i;
+
+    if ( node->kind == NODE_REPEAT ) node = node->children[0];
+
+    if ( node->kind != NODE_GROUP || node->mode != GROUP_NON_CAPTURE )
+        return 0;
+
+    /* the first alternative wins, and options are restored on leaving */
+    branch = node->children[0]->children[0];
+
+    for (i = 0; i < branch->num_children; i++)
+    {
+        if ( branch->children[i]->kind != NODE_OPTION &&
+                branch->children[i]->kind != NODE_EMPTY )
+            return 0;
+    }
+
+    return 1;
+}
+
+
+static void optimize(node_t* node)
+{
+    int i;
+    int j;
+
+    for (i = 0; i < node->num_children; i++) optimize(node->children[i]);
+
+    if ( node->kind == NODE_CONCAT )
+    {
+        for (i = 0, j = 0; i < node->num_children; i++)
+        {
+            if ( node->children[i]->kind != NODE_EMPTY &&
+                    !is_empty_group(node->children[i]) )
+                node->children[j++] = node->children[i];
+        }
+
+        node->num_children = j;
+    }
+    else if ( node->kind == NODE_REPEAT && node->c != '?' &&
+            is_single_byte(node->children[0]) )
+    {
+        node->kind = NODE_SPAN;
+    }
+}
+
+
+static void optimize_tail(node_t* root)
+{
+    int i;
+
+    for (i = 0; i < root->num_children; i++)
+    {
+        node_t* branch;
+        node_t* last;
+
+        branch = root->children[i];
+        if ( branch->num_children == 0 ) continue;
+
+        last = branch->children[branch->num_children - 1];
+
+        if ( last->kind == NODE_SPAN && last->c != '{' &&
+                last->children[0]->kind == NODE_ANY )
+            last->kind = NODE_ACCEPT;
+    }
+}
+
+
+/*
+ * Records in each literal the case options it may be matched under, given
+ * that they are those in cases on entry to node, and returns the options
+ * that may be in force on leaving it. Options are only restored at group
+ * boundaries, so a failed alternative can leave any of the options it set
+ * for the next one; every option that may be in force at some point is
+ * added to seen.
+ */
+static int fold_options(node_t* node, int cases, int* seen)
+{
+    int branch_seen;
+    int entry;
+    int exit;
+    int i;
+
+    *seen |= cases;
+
+    switch (node->kind)
+    {
+    case NODE_CHAR:
+    case NODE_NOT_CHAR:
+        node->cases = cases;
+        return cases;
+
+    case NODE_OPTION:
+        cases = (node->c == 'i') ? CASE_FOLD : CASE_EXACT;
+        *seen |= cases;
+        return cases;
+
+    case NODE_GROUP:
+        branch_seen = 0;
+        fold_options(node->children[0], cases, &branch_seen);
+        return cases;
+
+    case NODE_REPEAT:
+    case NODE_SPAN:
+        for (;;)
+        {
+            exit = fold_options(node->children[0], cases, seen);
+            if ( (cases | exit) == cases ) return cases;
+            cases |= exit;
+        }
+
+    case NODE_CONCAT:
+        for (i = 0; i < node->num_children; i++)
+            cases = fold_options(node->children[i], cases, seen);
+
+        *seen |= cases;
+        return cases;
+
+    case NODE_ALT:
+        entry = cases;
+        exit = 0;
+
+        for (i = 0; i < node->num_children; i++)
+        {
+            branch_seen = entry;
+            exit |= fold_options(node->children[i], entry, &branch_seen);
+            entry |= branch_seen;
+        }
+
+        *seen |= entry;
+        return exit;
+
+    default:
+        return cases;
+    }
+}
+
+
+static int is_case_unknown(const node_t* node)
+{
+    return (node->cases == (CASE_EXACT | CASE_FOLD)) &&
+            isalpha((unsigned char) node->c);
+}
+
+
+static int is_case_folded(const node_t* node)
+{
+    return (node->cases == CASE_FOLD) && isalpha((unsigned char) node->c);
+}
+
+
+/*
+ * Returns non-zero if some literal below node can only be matched by
+ * testing the options at run time.
+ */
+static int needs_options(const node_t* node)
+{
+    int i;
+
+    if ( (node->kind == NODE_CHAR || node->kind == NODE_NOT_CHAR) &&
+            is_case_unknown(node) )
+        return 1;
+
+    for (i = 0; i < node->num_children; i++)
+        if ( needs_options(node->children[i]) ) return 1;
+
+    return 0;
+}
+
+
+/*
+ * Returns non-zero if node is an alternation of enough plain literals, all
+ * compared with the same case sensitivity, to be worth hashing.
+ */
+static int is_keyword_list(const node_t* node)
+{
+    int cases;
+    int i;
+    int j;
+
+    if ( node->kind != NODE_ALT || node->num_children < KEYWORD_MIN_BRANCHES )
+        return 0;
+
+    for (cases = 0, i = 0; i < node->num_children; i++)
+    {
+        const node_t* branch;
+
+        branch = node->children[i];
+        if ( branch->num_children == 0 ) return 0;
+
+        for (j = 0; j < branch->num_children; j++)
+        {
+            const node_t* atom;
+
+            atom = branch->children[j];
+
+            if ( atom->kind != NODE_CHAR || atom->c == '\0' ||
+                    is_case_unknown(atom) )
+                return 0;
+
+            if ( isalpha((unsigned char) atom->c) ) cases |= atom->cases;
+        }
+    }
+
+    return cases != (CASE_EXACT | CASE_FOLD);
+}
+
+
+static void find_keywords(node_t* node)
+{
+    int i;
+    int j;
+
+    for (i = 0; i < node->num_children; i++) find_keywords(node->children[i]);
+
+    if ( !is_keyword_list(node) ) return;
+
+    node->kind = NODE_KEYWORDS;
+    node->cases = CASE_EXACT;
+
+    for (i = 0; i < node->num_children; i++)
+        for (j = 0; j < node->children[i]->num_children; j++)
+            if ( is_case_folded(node->children[i]->children[j]) )
+                node->cases = CASE_FOLD;
+}
+
+
+/*
+ * Returns non-zero if a and b are atoms, or repetitions of atoms, that
+ * always consume the same input whatever alternatives were tried before.
+ */
+static int same_atom(const node_t* a, const node_t* b)
+{
+    if ( a->kind != b->kind || a->c != b->c ) return 0;
+
+    if ( a->kind == NODE_SPAN )
+    {
+        return a->min == b->min && a->max == b->max &&
+                same_atom(a->children[0], b->children[0]);
+    }
+
+    if ( !is_single_byte(a) ) return 0;
+
+    if ( a->kind != NODE_CHAR && a->kind != NODE_NOT_CHAR ) return 1;
+
+    return !is_case_unknown(a) && !is_case_unknown(b) &&
+            (is_case_folded(a) == is_case_folded(b));
+}
+
+
+static int common_prefix(const node_t* a, const node_t* b)
+{
+    int i;
+
+    for (i = 0; i < a->num_children && i < b->num_children; i++)
+        if ( !same_atom(a->children[i], b->children[i]) ) break;
+
+    return i;
+}
+
+
+static void factor_prefixes(parser_t* parser, node_t* node);
+
+
+/*
+ * Replaces count alternatives that share their first prefix atoms with a
+ * single concatenation of those atoms and an alternation of the rest. It is
+ * not a group, so options set in the remainders still leak exactly as they
+ * did. If one remainder is empty, it always matches, so any after it are
+ * dropped.
+ */
+static node_t* factor_branches(parser_t* parser, node_t** branches, int count,
+        int prefix)
+{
+    node_t* concat;
+    node_t* alt;
+    int i;
+    int j;
+
+    concat = new_node(parser, NODE_CONCAT);
+    alt = new_node(parser, NODE_ALT);
+
+    for (i = 0; i < prefix; i++) add_child(concat, branches[0]->children[i]);
+
+    for (i = 0; i < count; i++)
+    {
+        node_t* rest;
+
+        rest = new_node(parser, NODE_CONCAT);
+
+        for (j = prefix; j < branches[i]->num_children; j++)
+            add_child(rest, branches[i]->children[j]);
+
+        add_child(alt, rest);
+
+        if ( rest->num_children == 0 ) break;
+    }
+
+    factor_prefixes(parser, alt);
+    add_child(concat, alt);
+
+    return concat;
+}
+
+
+static void factor_prefixes(parser_t* parser, node_t* node)
+{
+    int i;
+    int j;
+    int n;
+
+    for (i = 0; i < node->num_children; i++)
+        factor_prefixes(parser, node->children[i]);
+
+    if ( node->kind != NODE_ALT ) return;
+
+    /* only neighbours can be merged without changing which one wins */
+    for (i = 0, n = 0; i < node->num_children; i = j)
+    {
+        int prefix;
+
+        prefix = node->children[i]->num_children;
+
+        for (j = i + 1; j < node->num_children; j++)
+        {
+            int length;
+
+            length = common_prefix(node->children[i], node->children[j]);
+            if ( length == 0 ) break;
+            if ( length < prefix ) prefix = length;
+        }
+
+        if ( j - i < 2 ) node->children[n++] = node->children[i];
+        else
+        {
+            node->children[n++] = factor_branches(parser, node->children + i,
+                    j - i, prefix);
+        }
+    }
+
+    node->num_children = n;
+}
+
+
+static void emit(const char* format, ...)
+{
+    va_list args;
+    int i;
+
+    if ( format[0] != '\n' && format[0] != '#' )
+        for (i = 0; i < indent; i++) fputs("    ", out);
+
+    va_start(args, format);
+    vfprintf(out, format, args);
+    va_end(args);
+}
+
+
+static void emit_label(const char* prefix, int id)
+{
+    /* labels sit one level out, as they would in hand-written code */
+    indent--;
+    emit("%s%d: ;\n", prefix, id);
+    indent++;
+}
+
+
+static int jump(parser_t* parser, int fail_id)
+{
+    parser->jumps[fail_id] = 1;
+    return fail_id;
+}
+
+
+/*
+ * Emits failure label fail<id>, unless nothing jumps to it, in which case
+ * the code that would follow it is unreachable and 0 is returned.
+ */
+static int emit_fail_label(parser_t* parser, int id)
+{
+    if ( !parser->jumps[id] ) return 0;
+
+    emit_label("fail", id);
+    return 1;
+}
+
+
+static void emit_node(parser_t* parser, const node_t* node, int fail_id);
+
+
+static const char* char_literal(char c)
+{
+    static char buffer[8];
+
+    if ( c == '\'' || c == '\\' ) sprintf(buffer, "'\\%c'", c);
+    else if ( c >= 0x20 && c <= 0x7E ) sprintf(buffer, "'%c'", c);
+    else sprintf(buffer, "'\\x%02X'", (unsigned char) c);
+
+    return buffer;
+}
+
+
+static const char* class_test(char cls)
+{
+    switch (tolower((unsigned char) cls))
+    {
+    case 'd':   return "SUBREG_GEN_IS_DIGIT(c)";
+    case 'h':   return "SUBREG_GEN_IS_HEX(c)";
+    case 's':   return "SUBREG_GEN_IS_SPACE(c)";
+    default:    return "SUBREG_GEN_IS_WORD(c)";
+    }
+}
+
+
+/*
+ * Emits a test that is true when the character c does not match literal
+ * node, honouring case insensitivity where it could matter.
+ */
+static void emit_char_mismatch(parser_t* parser, const node_t* node, int fail_id)
+{
+    char lc;
+
+    lc = node->c;
+
+    if ( is_case_unknown(node) )
+    {
+        emit("if ( (opts & SUBREG_GEN_NOCASE) ? SUBREG_GEN_FOLD(c) != %s",
+                char_literal((char) toupper((unsigned char) lc)));
+        fprintf(out, " : c != %s ) goto fail%d;\n", char_literal(lc), jump(parser, fail_id));
+    }
+    else if ( is_case_folded(node) )
+    {
+        emit("if ( SUBREG_GEN_FOLD(c) != %s ) goto fail%d;\n",
+                char_literal((char) toupper((unsigned char) lc)), jump(parser, fail_id));
+    }
+    else
+    {
+        emit("if ( c != %s ) goto fail%d;\n", char_literal(lc), jump(parser, fail_id));
+    }
+}
+
+
+static int is_run_char(const node_t* node)
+{
+    /* case folding may depend on options only known at run time */
+    return (node->kind == NODE_CHAR) && (node->c != '\0') &&
+            !is_case_unknown(node);
+}
+
+
+/*
+ * Returns the number of consecutive plain literal characters in concatenation
+ * node, starting with child first.
+ */
+static int literal_run(const node_t* node, int first)
+{
+    int i;
+
+    for (i = first; i < node->num_children; i++)
+        if ( !is_run_char(node->children[i]) ) break;
+
+    return i - first;
+}
+
+
+/*
+ * Emits a run of literal characters as a single test. Each comparison only
+ * reads past the terminator if all the previous ones matched, which they
+ * cannot have done at the terminator, so it never reads beyond the input.
+ */
+static void emit_literal_run(parser_t* parser, const node_t* node, int first,
+        int run, int fail_id)
+{
+    int i;
+    char lc;
+
+    emit("if ( ");
+
+    for (i = 0; i < run; i++)
+    {
+        if ( i > 0 )
+        {
+            fprintf(out, " ||");
+
+            if ( i % 4 == 0 )
+            {
+                fprintf(out, "\n");
+                emit("        ");
+            }
+            else fprintf(out, " ");
+        }
+
+        lc = node->children[first + i]->c;
+
+        if ( is_case_folded(node->children[first + i]) )
+            fprintf(out, "SUBREG_GEN_FOLD(p[%d]) != %s", i,
+                    char_literal((char) toupper((unsigned char) lc)));
+        else
+            fprintf(out, "p[%d] != %s", i, char_literal(lc));
+    }
+
+    fprintf(out, " )\n");
+    emit("    goto fail%d;\n", jump(parser, fail_id));
+    emit("p += %d;\n", run);
+}
+
+
+static int is_class_char(char cls, int b)
+{
+    int match;
+
+    switch (tolower((unsigned char) cls))
+    {
+    case 'd':
+        match = (b >= '0' && b <= '9');
+        break;
+
+    case 'h':
+        match = (b >= '0' && b <= '9') || (b >= 'A' && b <= 'F') ||
+                (b >= 'a' && b <= 'f');
+        break;
+
+    case 's':
+        match = (b == ' ' || b == '\t' || b == '\n' || b == '\v' ||
+                b == '\f' || b == '\r');
+        break;
+
+    default:
+        match = (b >= '0' && b <= '9') || (b >= 'A' && b <= 'Z') ||
+                (b >= 'a' && b <= 'z') || (b == '_');
+        break;
+    }
+
+    return isupper((unsigned char) cls) ? !match : match;
+}
+
+
+/*
+ * Adds to set every byte that node can start a match with. Returns
+ * FIRST_NULLABLE if node can also match without consuming anything, and
+ * FIRST_OPAQUE if it can change options or captures before consuming
+ * anything, in which case it must always be tried.
+ */
+static int first_set(const parser_t* parser, const node_t* node,
+        unsigned char* set)
+{
+    int flags;
+    int b;
+    int i;
+
+    switch (node->kind)
+    {
+    case NODE_CHAR:
+        if ( node->c == '\0' ) return 0;
+
+        set[(unsigned char) node->c] = 1;
+
+        if ( isalpha((unsigned char) node->c) && (node->cases & CASE_FOLD) )
+        {
+            set[tolower((unsigned char) node->c)] = 1;
+            set[toupper((unsigned char) node->c)] = 1;
+        }
+
+        return 0;
+
+    case NODE_ANY:
+    case NODE_NOT_CHAR:
+        for (b = 1; b < 256; b++) set[b] = 1;
+        return 0;
+
+    case NODE_CLASS:
+        for (b = 1; b < 256; b++)
+            if ( is_class_char(node->c, b) ) set[b] = 1;
+
+        return 0;
+
+    case NODE_OPTION:
+        return parser->uses_options ? FIRST_OPAQUE : FIRST_NULLABLE;
+
+    case NODE_GROUP:
+        if ( node->mode == GROUP_POS_LOOK_AHEAD ||
+                node->mode == GROUP_NEG_LOOK_AHEAD )
+            return FIRST_OPAQUE;
+
+        flags = first_set(parser, node->children[0], set);
+
+        /* an empty capture is recorded even if what follows fails */
+        if ( node->mode == GROUP_CAPTURE && (flags & FIRST_NULLABLE) )
+            flags |= FIRST_OPAQUE;
+
+        return flags;
+
+    case NODE_REPEAT:
+    case NODE_SPAN:
+    case NODE_ACCEPT:
+        flags = first_set(parser, node->children[0], set);
+
+        if ( node->c == '+' || (node->c == '{' && node->min > 0) )
+            return flags;
+
+        return flags | FIRST_NULLABLE;
+
+    case NODE_CONCAT:
+        for (i = 0; i < node->num_children; i++)
+        {
+            flags = first_set(parser, node->children[i], set);
+            if ( flags != FIRST_NULLABLE ) return flags & FIRST_OPAQUE;
+        }
+
+        return FIRST_NULLABLE;
+
+    case NODE_ALT:
+    case NODE_KEYWORDS:
+        for (flags = 0, i = 0; i < node->num_children; i++)
+            flags |= first_set(parser, node->children[i], set);
+
+        return flags;
+
+    default:
+        return FIRST_NULLABLE;
+    }
+}
+
+
+static int count_ranges(const unsigned char* set)
+{
+    int count;
+    int b;
+
+    for (count = 0, b = 1; b < 256; b++)
+        if ( set[b] && !set[b - 1] ) count++;
+
+    return count;
+}
+
+
+/*
+ * Prints byte b as a bound for c cast to unsigned char, which a character
+ * literal above 0x7F is not where plain char is signed.
+ */
+static void print_bound(int b)
+{
+    if ( b < 0x80 ) fprintf(out, "%s", char_literal((char) b));
+    else fprintf(out, "0x%02X", b);
+}
+
+
+/*
+ * Emits a test that jumps to fail<fail_id> unless the byte at p is in set.
+ */
+static void emit_set_mismatch(parser_t* parser, const unsigned char* set,
+        int fail_id)
+{
+    int first;
+    int last;
+    int count;
+
+    count = count_ranges(set);
+
+    if ( count == 0 )
+    {
+        emit("goto fail%d;\n", jump(parser, fail_id));
+        return;
+    }
+
+    emit("c = *p;\n");
+
+    if ( count == 1 )
+    {
+        for (first = 1; !set[first]; first++) {}
+
+        for (last = first; last + 1 < 256 && set[last + 1]; last++) {}
+
+        if ( first == last )
+        {
+            emit("if ( c != %s ) goto fail%d;\n", char_literal((char) first),
+                    jump(parser, fail_id));
+        }
+        else
+        {
+            /* comparisons that always hold would trip -Wtype-limits */
+            emit("if ( (unsigned char) c < ");
+            print_bound(first);
+
+            if ( last < 0xFF )
+            {
+                fprintf(out, " || (unsigned char) c > ");
+                print_bound(last);
+            }
+
+            fprintf(out, " ) goto fail%d;\n", jump(parser, fail_id));
+        }
+
+        return;
+    }
+
+    emit("if ( !(");
+
+    for (count = 0, first = 1; first < 256; first = last + 1)
+    {
+        if ( !set[first] )
+        {
+            last = first;
+            continue;
+        }
+
+        for (last = first; last + 1 < 256 && set[last + 1]; last++) {}
+
+        if ( count > 0 )
+        {
+            fprintf(out, " ||");
+
+            if ( count % 3 == 0 )
+            {
+                fprintf(out, "\n");
+                emit("        ");
+            }
+            else fprintf(out, " ");
+        }
+
+        count++;
+
+        if ( first == last ) fprintf(out, "c == %s", char_literal((char) first));
+        else if ( last == 0xFF )
+        {
+            fprintf(out, "(unsigned char) c >= ");
+            print_bound(first);
+        }
+        else
+        {
+            fprintf(out, "((unsigned char) c >= ");
+            print_bound(first);
+            fprintf(out, " && (unsigned char) c <= ");
+            print_bound(last);
+            fprintf(out, ")");
+        }
+    }
+
+    fprintf(out, ") ) goto fail%d;\n", jump(parser, fail_id));
+}
+
+
+/*
+ * Emits a switch on the byte at p that jumps to the first alternative that
+ * could match starting with it, or to fail<fail_id> if there are none.
+ */
+static void emit_dispatch(parser_t* parser, const node_t* node,
+        const int* targets, int fail_id)
+{
+    int default_target;
+    int default_count;
+    int target;
+    int b;
+
+    /* the commonest target, usually failure, becomes the default */
+    default_target = targets[0];
+    default_count = 0;
+
+    for (b = 0; b < 256; b++)
+    {
+        int count;
+        int i;
+
+        for (count = 0, i = 0; i < 256; i++)
+            if ( targets[i] == targets[b] ) count++;
+
+        if ( count > default_count )
+        {
+            default_target = targets[b];
+            default_count = count;
+        }
+    }
+
+    emit("switch ( *p )\n");
+    emit("{\n");
+
+    for (target = 0; target <= node->num_children; target++)
+    {
+        int count;
+
+        if ( target == default_target ) continue;
+
+        for (count = 0, b = 0; b < 256; b++)
+        {
+            if ( targets[b] != target ) continue;
+
+            if ( count % 4 != 0 ) fprintf(out, " ");
+            else
+            {
+                if ( count > 0 ) fprintf(out, "\n");
+                emit("");
+            }
+
+            fprintf(out, "case %s:", char_literal((char) b));
+            count++;
+        }
+
+        if ( count == 0 ) continue;
+
+        fprintf(out, "\n");
+
+        if ( target < node->num_children )
+            emit("    goto try%d;\n", node->children[target]->id);
+        else emit("    goto fail%d;\n", jump(parser, fail_id));
+
+        emit("\n");
+    }
+
+    emit("default:\n");
+
+    if ( default_target < node->num_children )
+        emit("    goto try%d;\n", node->children[default_target]->id);
+    else emit("    goto fail%d;\n", jump(parser, fail_id));
+
+    emit("}\n");
+}
+
+
+/*
+ * Emits an alternation, in which the first alternative that matches wins.
+ * Wide alternations only try the alternatives that can start with the next
+ * input byte, still in order. Each one that is skipped would have failed
+ * on that byte without setting options or captures, so skipping it cannot
+ * change the result.
+ */
+static void emit_alternation(parser_t* parser, const node_t* node, int fail_id)
+{
+    unsigned char* sets;
+    int* flags;
+    int targets[256];
+    int dispatch;
+    int n;
+    int b;
+    int i;
+
+    n = node->num_children;
+
+    sets = xmalloc(n * 256);
+    flags = xmalloc(n * sizeof(int));
+    memset(sets, 0, n * 256);
+
+    for (i = 0; i < n; i++)
+    {
+        flags[i] = first_set(parser, node->children[i], sets + i * 256);
+
+        if ( flags[i] || count_ranges(sets + i * 256) > MAX_SET_RANGES )
+        {
+            flags[i] = FIRST_OPAQUE;
+            memset(sets + i * 256, 1, 256);
+        }
+    }
+
+    for (b = 0; b < 256; b++)
+    {
+        for (i = 0; i < n; i++)
+            if ( sets[i * 256 + b] ) break;
+
+        targets[b] = i;
+    }
+
+    dispatch = (n >= DISPATCH_MIN_BRANCHES) && !flags[0];
+
+    emit("{\n");
+    indent++;
+    emit("const char* begin%d = p;\n", node->id);
+
+    if ( dispatch )
+    {
+        emit("\n");
+        emit_dispatch(parser, node, targets, fail_id);
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        const node_t* branch;
+        int branch_fail_id;
+
+        branch = node->children[i];
+        branch_fail_id = (i + 1 < n) ? branch->id : fail_id;
+
+        emit("\n");
+
+        if ( i > 0 && emit_fail_label(parser, node->children[i - 1]->id) )
+        {
+            emit("p = begin%d;\n", node->id);
+
+            if ( dispatch && !flags[i] )
+                emit_set_mismatch(parser, sets + i * 256, branch_fail_id);
+        }
+
+        if ( dispatch )
+        {
+            for (b = 0; b < 256; b++)
+                if ( targets[b] == i ) break;
+
+            if ( b < 256 ) emit_label("try", branch->id);
+        }
+
+        emit_node(parser, branch, branch_fail_id);
+        emit("goto done%d;\n", node->id);
+    }
+
+    emit("\n");
+    emit_label("done", node->id);
+    indent--;
+    emit("}\n");
+
+    free(flags);
+    free(sets);
+}
+
+
+static void emit_string(const char* str)
+{
+    fputc('"', out);
+
+    for (; *str; str++)
+    {
+        if ( *str == '"' || *str == '\\' ) fprintf(out, "\\%c", *str);
+        else if ( *str < 0x20 || *str > 0x7E )
+            fprintf(out, "\\%03o", (unsigned char) *str);
+        else fputc(*str, out);
+    }
+
+    fputc('"', out);
+}
+
+
+static unsigned long keyword_hash(unsigned long hash, char c)
+{
+    return (hash * 31 + (unsigned char) c) & 0xFFFFFFFFUL;
+}
+
+
+static char keyword_char(const node_t* node, const node_t* atom)
+{
+    if ( node->cases == CASE_FOLD ) return (char) toupper((unsigned char) atom->c);
+    return atom->c;
+}
+
+
+/*
+ * Emits an alternation of plain literals. The input is hashed once, a byte
+ * at a time up to the length of the longest literal, and after each byte
+ * the literals of that length are looked up in an open-addressed hash
+ * table. The first literal in the alternation that prefixes the input is
+ * the one that matches, as in subreg_match().
+ */
+static void emit_keywords(parser_t* parser, const node_t* node, int fail_id)
+{
+    unsigned long* hashes;
+    unsigned int* slots;
+    unsigned int size;
+    int max_length;
+    int id;
+    int i;
+    int j;
+
+    id = node->id;
+    hashes = xmalloc(node->num_children * sizeof(unsigned long));
+
+    for (size = 1; size < 2 * (unsigned int) node->num_children; size *= 2) {}
+
+    slots = xmalloc(size * sizeof(unsigned int));
+    memset(slots, 0, size * sizeof(unsigned int));
+
+    for (max_length = 0, i = 0; i < node->num_children; i++)
+    {
+        const node_t* branch;
+        unsigned int slot;
+
+        branch = node->children[i];
+
+        for (hashes[i] = 0, j = 0; j < branch->num_children; j++)
+            hashes[i] = keyword_hash(hashes[i], keyword_char(node, branch->children[j]));
+
+        if ( branch->num_children > max_length ) max_length = branch->num_children;
+
+        for (slot = hashes[i] & (size - 1); slots[slot]; slot = (slot + 1) & (size - 1)) {}
+        slots[slot] = i + 1;
+    }
+
+    emit("{\n");
+    indent++;
+    emit("static const char* const words%d[] =\n", id);
+    emit("{\n");
+
+    for (i = 0; i < node->num_children; i++)
+    {
+        const node_t* branch;
+        char word[MAX_LINE_LENGTH];
+
+        branch = node->children[i];
+
+        for (j = 0; j < branch->num_children; j++)
+            word[j] = keyword_char(node, branch->children[j]);
+
+        word[j] = '\0';
+
+        emit("    ");
+        emit_string(word);
+        fprintf(out, "%s\n", (i + 1 < node->num_children) ? "," : "");
+    }
+
+    emit("};\n");
+    emit("static const unsigned long hashes%d[] =\n", id);
+    emit("{\n");
+
+    for (i = 0; i < node->num_children; i++)
+    {
+        if ( i % 4 == 0 ) emit("    ");
+        fprintf(out, "0x%08lXUL%s", hashes[i], (i + 1 < node->num_children) ?
+                ((i % 4 == 3) ? ",\n" : ", ") : "\n");
+    }
+
+    emit("};\n");
+    emit("static const unsigned int slots%d[%u] =\n", id, size);
+    emit("{\n");
+
+    for (i = 0; i < (int) size; i++)
+    {
+        if ( i % 8 == 0 ) emit("    ");
+        fprintf(out, "%u%s", slots[i], (i + 1 < (int) size) ?
+                ((i % 8 == 7) ? ",\n" : ", ") : "\n");
+    }
+
+    emit("};\n");
+    emit("unsigned long hash%d;\n", id);
+    emit("unsigned int length%d;\n", id);
+    emit("unsigned int best%d;\n", id);
+    emit("unsigned int end%d;\n", id);
+    emit("\n");
+    emit("hash%d = 0;\n", id);
+    emit("best%d = %d;\n", id, node->num_children);
+    emit("end%d = 0;\n", id);
+    emit("\n");
+    emit("for (length%d = 0; length%d < %d && p[length%d] != '\\0';)\n", id, id,
+            max_length, id);
+    emit("{\n");
+    emit("    unsigned int slot;\n");
+    emit("\n");
+    emit("    c = p[length%d++];\n", id);
+
+    if ( node->cases == CASE_FOLD )
+        emit("    hash%d = (hash%d * 31 + (unsigned char) SUBREG_GEN_FOLD(c)) & "
+                "0xFFFFFFFFUL;\n", id, id);
+    else
+        emit("    hash%d = (hash%d * 31 + (unsigned char) c) & 0xFFFFFFFFUL;\n", id, id);
+
+    emit("\n");
+    emit("    for (slot = (unsigned int) (hash%d & %uU); slots%d[slot] != 0;\n", id,
+            size - 1, id);
+    emit("            slot = (slot + 1) & %uU)\n", size - 1);
+    emit("    {\n");
+    emit("        const char* word;\n");
+    emit("        unsigned int i;\n");
+    emit("\n");
+    emit("        /* earlier literals take priority */\n");
+    emit("        if ( slots%d[slot] - 1 >= best%d ||\n", id, id);
+    emit("                hashes%d[slots%d[slot] - 1] != hash%d )\n", id, id, id);
+    emit("            continue;\n");
+    emit("\n");
+    emit("        word = words%d[slots%d[slot] - 1];\n", id, id);
+    emit("\n");
+
+    if ( node->cases == CASE_FOLD )
+        emit("        for (i = 0; i < length%d && SUBREG_GEN_FOLD(p[i]) == word[i]; "
+                "i++) {}\n", id);
+    else
+        emit("        for (i = 0; i < length%d && p[i] == word[i]; i++) {}\n", id);
+
+    emit("\n");
+    emit("        if ( i == length%d && word[i] == '\\0' )\n", id);
+    emit("        {\n");
+    emit("            best%d = slots%d[slot] - 1;\n", id, id);
+    emit("            end%d = length%d;\n", id, id);
+    emit("        }\n");
+    emit("    }\n");
+    emit("}\n");
+    emit("\n");
+    emit("if ( best%d == %d ) goto fail%d;\n", id, node->num_children,
+            jump(parser, fail_id));
+    emit("p += end%d;\n", id);
+    indent--;
+    emit("}\n");
+
+    free(slots);
+    free(hashes);
+}
+
+
+/*
+ * Emits the body of a counted repetition, in the block that declares
+ * check<id>. As in subreg.c, iterations are counted rather than unrolled,
+ * and one that consumes nothing satisfies the rest. A count of zero still
+ * tries the element, but gives back what it consumed and captured.
+ */
+static void emit_counted(parser_t* parser, const node_t* node, int fail_id)
+{
+    if ( node->max == 0 )
+    {
+        emit("unsigned int index%d = index;\n", node->id);
+        emit("\n");
+        emit_node(parser, node->children[0], node->id);
+        emit_fail_label(parser, node->id);
+        emit("p = check%d;\n", node->id);
+        emit("index = index%d;\n", node->id);
+        return;
+    }
+
+    emit("unsigned int count%d = 0;\n", node->id);
+    emit("\n");
+    emit_label("again", node->id);
+
+    if ( node->max != REPEAT_UNBOUNDED )
+        emit("if ( count%d == %uU ) goto done%d;\n", node->id, node->max,
+                node->id);
+
+    emit_node(parser, node->children[0], node->id);
+    emit("count%d++;\n", node->id);
+    emit("if ( p == check%d ) goto done%d;\n", node->id, node->id);
+    emit("check%d = p;\n", node->id);
+    emit("goto again%d;\n", node->id);
+    emit("\n");
+
+    if ( emit_fail_label(parser, node->id) )
+    {
+        emit("p = check%d;\n", node->id);
+
+        if ( node->min > 0 )
+            emit("if ( count%d < %uU ) goto fail%d;\n", node->id, node->min,
+                    jump(parser, fail_id));
+    }
+
+    emit_label("done", node->id);
+}
+
+
+/*
+ * Emits a counted repetition of a single-byte atom. Every iteration consumes
+ * one byte, so the count is how far p has moved, and the loop stops at the
+ * maximum without testing anything more.
+ */
+static void emit_counted_span(parser_t* parser, const node_t* node,
+        int fail_id)
+{
+    /* trying a single-byte atom has no effect to give back */
+    if ( node->max == 0 ) return;
+
+    emit("{\n");
+    indent++;
+    emit("const char* start%d = p;\n", node->id);
+    emit("\n");
+    emit_label("again", node->id);
+
+    if ( node->max != REPEAT_UNBOUNDED )
+        emit("if ( p - start%d == %u ) goto done%d;\n", node->id, node->max,
+                node->id);
+
+    emit_node(parser, node->children[0], node->id);
+    emit("goto again%d;\n", node->id);
+    emit("\n");
+    emit_fail_label(parser, node->id);
+
+    if ( node->min > 0 )
+        emit("if ( p - start%d < %u ) goto fail%d;\n", node->id, node->min,
+                jump(parser, fail_id));
+
+    if ( node->max != REPEAT_UNBOUNDED ) emit_label("done", node->id);
+
+    indent--;
+    emit("}\n");
+}
+
+
+/*
+ * Emits code that falls through with p advanced past the match if node
+ * matches at p, or jumps to label fail<fail_id> if it does not. The value
+ * of p after a failure is unspecified, exactly as it is for SubReg's own
+ * parse_* functions.
+ */
+static void emit_node(parser_t* parser, const node_t* node, int fail_id)
+{
+    int i;
+    int run;
+
+    switch (node->kind)
+    {
+    case NODE_EMPTY:
+        break;
+
+    case NODE_CHAR:
+        if ( node->c == '\0' )
+        {
+            emit("goto fail%d;\n", jump(parser, fail_id));
+            break;
+        }
+
+        emit("c = *p;\n");
+        emit_char_mismatch(parser, node, fail_id);
+        emit("p++;\n");
+        break;
+
+    case NODE_ANY:
+        emit("if ( *p == '\\0' ) goto fail%d;\n", jump(parser, fail_id));
+        emit("p++;\n");
+        break;
+
+    case NODE_CLASS:
+        emit("c = *p;\n");
+
+        if ( isupper((unsigned char) node->c) )
+            emit("if ( c == '\\0' || %s ) goto fail%d;\n", class_test(node->c),
+                    jump(parser, fail_id));
+        else
+            emit("if ( !%s ) goto fail%d;\n", class_test(node->c), jump(parser, fail_id));
+
+        emit("p++;\n");
+        break;
+
+    case NODE_NOT_CHAR:
+        emit("c = *p;\n");
+        emit("if ( c == '\\0' ) goto fail%d;\n", jump(parser, fail_id));
+
+        if ( is_case_unknown(node) )
+        {
+            /* char_literal() reuses its buffer, so one literal per call */
+            emit("if ( (opts & SUBREG_GEN_NOCASE) ? SUBREG_GEN_FOLD(c) == %s",
+                    char_literal((char) toupper((unsigned char) node->c)));
+            fprintf(out, " : c == %s ) goto fail%d;\n", char_literal(node->c),
+                    jump(parser, fail_id));
+        }
+        else if ( is_case_folded(node) )
+            emit("if ( SUBREG_GEN_FOLD(c) == %s ) goto fail%d;\n",
+                    char_literal((char) toupper((unsigned char) node->c)),
+                    jump(parser, fail_id));
+        else
+            emit("if ( c == %s ) goto fail%d;\n", char_literal(node->c), jump(parser, fail_id));
+
+        emit("p++;\n");
+        break;
+
+    case NODE_OPTION:
+        /* options that are never tested at run time are not tracked */
+        if ( !parser->uses_options ) break;
+
+        if ( node->c == 'i' ) emit("opts |= SUBREG_GEN_NOCASE;\n");
+        else emit("opts &= ~SUBREG_GEN_NOCASE;\n");
+        break;
+
+    case NODE_GROUP:
+        emit("{\n");
+        indent++;
+        if ( node->mode != GROUP_NON_CAPTURE )
+            emit("const char* start%d = p;\n", node->id);
+
+        if ( parser->uses_options ) emit("int saved_opts%d = opts;\n", node->id);
+
+        if ( node->mode != GROUP_NON_CAPTURE || parser->uses_options )
+            emit("\n");
+
+        emit_node(parser, node->children[0], node->id);
+
+        if ( parser->uses_options ) emit("opts = saved_opts%d;\n", node->id);
+
+        switch (node->mode)
+        {
+        case GROUP_CAPTURE:
+            emit("\n");
+            emit("if ( max_captures > 0 )\n");
+            emit("{\n");
+            emit("    if ( index + 1 > max_captures )\n");
+            emit("        return SUBREG_RESULT_CAPTURE_OVERFLOW;\n");
+            emit("\n");
+            emit("    captures[index].start = start%d;\n", node->id);
+            emit("    captures[index].length = (unsigned int) (p - start%d);\n",
+                    node->id);
+            emit("    index++;\n");
+            emit("}\n");
+            break;
+
+        case GROUP_POS_LOOK_AHEAD:
+            emit("p = start%d;\n", node->id);
+            break;
+
+        case GROUP_NEG_LOOK_AHEAD:
+            emit("p = start%d;\n", node->id);
+            emit("goto fail%d;\n", jump(parser, fail_id));
+            break;
+
+        default:
+            break;
+        }
+
+        emit("goto done%d;\n", node->id);
+        emit("\n");
+
+        if ( emit_fail_label(parser, node->id) )
+        {
+            if ( parser->uses_options )
+                emit("opts = saved_opts%d;\n", node->id);
+
+            if ( node->mode == GROUP_NEG_LOOK_AHEAD )
+                emit("p = start%d;\n", node->id);
+            else
+                emit("goto fail%d;\n", jump(parser, fail_id));
+        }
+
+        emit_label("done", node->id);
+        indent--;
+        emit("}\n");
+        break;
+
+    case NODE_REPEAT:
+        /*
+         * Repetition is greedy and possessive, so no backtracking is
+         * needed. As in subreg.c, an iteration that consumes nothing ends
+         * the repetition.
+         */
+        emit("{\n");
+        indent++;
+        emit("const char* check%d = p;\n", node->id);
+
+        if ( node->c == '{' )
+        {
+            emit_counted(parser, node, fail_id);
+        }
+        else if ( node->c == '?' )
+        {
+            emit("\n");
+            emit_node(parser, node->children[0], node->id);
+            emit("goto done%d;\n", node->id);
+            emit("\n");
+            if ( emit_fail_label(parser, node->id) )
+                emit("p = check%d;\n", node->id);
+            emit_label("done", node->id);
+        }
+        else
+        {
+            if ( node->c == '+' ) emit("int first%d = 1;\n", node->id);
+            emit("\n");
+            emit_label("again", node->id);
+            emit_node(parser, node->children[0], node->id);
+            emit("if ( p == check%d ) goto done%d;\n", node->id, node->id);
+            emit("check%d = p;\n", node->id);
+            if ( node->c == '+' ) emit("first%d = 0;\n", node->id);
+            emit("goto again%d;\n", node->id);
+            emit("\n");
+            if ( emit_fail_label(parser, node->id) )
+            {
+                if ( node->c == '+' )
+                    emit("if ( first%d ) goto fail%d;\n", node->id,
+                            jump(parser, fail_id));
+
+                emit("p = check%d;\n", node->id);
+            }
+
+            emit_label("done", node->id);
+        }
+
+        indent--;
+        emit("}\n");
+        break;
+
+    case NODE_SPAN:
+        /* every iteration consumes one byte, so progress is guaranteed */
+        if ( node->c == '{' )
+        {
+            emit_counted_span(parser, node, fail_id);
+            break;
+        }
+
+        emit("{\n");
+        indent++;
+
+        if ( node->c == '+' )
+        {
+            emit("const char* start%d = p;\n", node->id);
+            emit("\n");
+        }
+
+        emit_label("again", node->id);
+        emit_node(parser, node->children[0], node->id);
+        emit("goto again%d;\n", node->id);
+        emit("\n");
+        emit_fail_label(parser, node->id);
+
+        if ( node->c == '+' )
+            emit("if ( p == start%d ) goto fail%d;\n", node->id, jump(parser, fail_id));
+
+        indent--;
+        emit("}\n");
+        break;
+
+    case NODE_ACCEPT:
+        /* a trailing .* or .+ takes whatever input remains */
+        if ( node->c == '+' )
+            emit("if ( *p == '\\0' ) goto fail%d;\n", jump(parser, fail_id));
+
+        emit("if ( max_captures == 0 ) return (int) index;\n");
+        emit("while ( *p != '\\0' ) p++;\n");
+        break;
+
+    case NODE_CONCAT:
+        for (i = 0; i < node->num_children; i += run)
+        {
+            run = literal_run(node, i);
+
+            if ( run < 2 )
+            {
+                run = 1;
+                emit_node(parser, node->children[i], fail_id);
+            }
+            else emit_literal_run(parser, node, i, run, fail_id);
+        }
+        break;
+
+    case NODE_ALT:
+        if ( node->num_children == 1 )
+        {
+            emit_node(parser, node->children[0], fail_id);
+            break;
+        }
+
+        emit_alternation(parser, node, fail_id);
+        break;
+
+    case NODE_KEYWORDS:
+        emit_keywords(parser, node, fail_id);
+        break;
+    }
+}
+
+
+static void emit_entry_type(FILE* file)
+{
+    fprintf(file,
+        "#ifndef SUBREG_GEN_ENTRY_DEFINED\n"
+        "#define SUBREG_GEN_ENTRY_DEFINED\n\n"
+        "typedef struct\n"
+        "{\n"
+        "    const char* regex;\n"
+        "    int (*match)(const char* input, subreg_capture_t captures[],\n"
+        "            unsigned int max_captures);\n\n"
+        "} subreg_gen_entry_t;\n\n"
+        "#endif\n\n");
+}
+
+
+static void emit_prologue(const char* header, const char* table)
+{
+    fprintf(out, "/* generated by subreg-gen - do not edit */\n\n");
+
+    if ( header ) fprintf(out, "#include \"%s\"\n\n", header);
+    else fprintf(out, "#include \"subreg.h\"\n\n");
+
+    if ( table && !header ) emit_entry_type(out);
+
+    fprintf(out,
+        "#define SUBREG_GEN_NOCASE       1\n"
+        "#define SUBREG_GEN_FOLD(c)      (((c) >= 'a' && (c) <= 'z') ? (c) - 'a' + 'A' : (c))\n"
+        "#define SUBREG_GEN_IS_DIGIT(c)  ((c) >= '0' && (c) <= '9')\n"
+        "#define SUBREG_GEN_IS_HEX(c)    (SUBREG_GEN_IS_DIGIT(c) || "
+                "((c) >= 'A' && (c) <= 'F') || ((c) >= 'a' && (c) <= 'f'))\n"
+        "#define SUBREG_GEN_IS_WORD(c)   (SUBREG_GEN_IS_DIGIT(c) || "
+                "((c) >= 'A' && (c) <= 'Z') || ((c) >= 'a' && (c) <= 'z') || "
+                "(c) == '_')\n"
+        "#define SUBREG_GEN_IS_SPACE(c)  ((c) == ' ' || (c) == '\\t' || "
+                "(c) == '\\n' || (c) == '\\v' || (c) == '\\f' || (c) == '\\r')\n");
+}
+
+
+static void emit_function(const char* name, const char* regex)
+{
+    parser_t parser;
+    node_t* root;
+    int fail_id;
+    int seen;
+
+    parser.regex = regex;
+    parser.next_id = 0;
+    parser.uses_options = 0;
+
+    if ( parser.regex[0] == '^' ) parser.regex++;
+
+    root = parse_alternation(&parser);
+
+    optimize(root);
+    optimize_tail(root);
+
+    seen = 0;
+    fold_options(root, CASE_EXACT, &seen);
+    parser.uses_options = needs_options(root);
+
+    find_keywords(root);
+    factor_prefixes(&parser, root);
+    fail_id = parser.next_id;
+
+    parser.jumps = xmalloc(fail_id + 1);
+    memset(parser.jumps, 0, fail_id + 1);
+
+    fprintf(out, "\n\nconst char %s_regex[] = ", name);
+    emit_string(regex);
+    fprintf(out, ";\n\n\n");
+
+    fprintf(out, "int %s(const char* input, subreg_capture_t captures[],\n"
+            "        unsigned int max_captures)\n{\n", name);
+
+    indent = 1;
+    emit("const char* p;\n");
+    emit("unsigned int index;\n");
+    if ( parser.uses_options ) emit("int opts;\n");
+    emit("char c;\n");
+    emit("\n");
+    emit("if ( !input || (max_captures > 0 && !captures) )\n");
+    emit("    return SUBREG_RESULT_INVALID_ARGUMENT;\n");
+    emit("\n");
+    emit("p = input;\n");
+    emit("index = 1;\n");
+    if ( parser.uses_options ) emit("opts = 0;\n");
+    emit("(void) c;\n");
+    emit("\n");
+
+    emit_node(&parser, root, fail_id);
+
+    emit("\n");
+    emit("if ( *p != '\\0' ) return SUBREG_RESULT_NO_MATCH;\n");
+    emit("\n");
+    emit("if ( max_captures > 0 )\n");
+    emit("{\n");
+    emit("    captures[0].start = input;\n");
+    emit("    captures[0].length = (unsigned int) (p - input);\n");
+    emit("}\n");
+    emit("\n");
+    emit("return (int) index;\n");
+    emit("\n");
+    if ( emit_fail_label(&parser, fail_id) )
+        emit("return SUBREG_RESULT_NO_MATCH;\n");
+
+    fprintf(out, "}\n");
+
+    free(parser.jumps);
+}
+
+
+static const char* read_spec_line(const char* line, char* name, char* regex,
+        size_t size)
+{
+    size_t length;
+
+    while ( isspace((unsigned char) *line) ) line++;
+
+    for (length = 0; isalnum((unsigned char) *line) || *line == '_'; line++)
+    {
+        if ( length + 1 >= MAX_NAME_LENGTH ) return "name too long";
+        name[length++] = *line;
+    }
+
+    name[length] = '\0';
+
+    if ( length == 0 || isdigit((unsigned char) name[0]) )
+        return "expected function name";
+
+    while ( isspace((unsigned char) *line) ) line++;
+    if ( *line++ != '"' ) return "expected string literal";
+
+    for (length = 0; *line != '"'; line++)
+    {
+        char c;
+
+        c = *line;
+
+        if ( c == '\0' || c == '\n' ) return "unterminated string literal";
+
+        if ( c == '\\' )
+        {
+            line++;
+
+            switch (*line)
+            {
+            case 'a':   c = '\a';   break;
+            case 'b':   c = '\b';   break;
+            case 'f':   c = '\f';   break;
+            case 'n':   c = '\n';   break;
+            case 'r':   c = '\r';   break;
+            case 't':   c = '\t';   break;
+            case 'v':   c = '\v';   break;
+
+            case 'x':
+                if ( !isxdigit((unsigned char) line[1]) ) return "bad escape";
+
+                for (c = 0; isxdigit((unsigned char) line[1]); line++)
+                    c = (char) ((c << 4) | hex_value(line[1]));
+                break;
+
+            default:
+                if ( *line >= '0' && *line <= '7' )
+                {
+                    int digits;
+
+                    for (c = 0, digits = 0; digits < 3 && *line >= '0' &&
+                            *line <= '7'; digits++, line++)
+                        c = (char) ((c << 3) | (*line - '0'));
+
+                    line--;
+                }
+                else if ( *line == '\0' ) return "bad escape";
+                else c = *line;
+            }
+        }
+
+        if ( length + 1 >= size ) return "string literal too long";
+        regex[length++] = c;
+    }
+
+    regex[length] = '\0';
+
+    return NULL;
+}
+
+
+int main(int argc, char* argv[])
+{
+    char line[MAX_LINE_LENGTH];
+    char name[MAX_NAME_LENGTH];
+    char regex[MAX_LINE_LENGTH];
+    const char* output;
+    const char* header;
+    const char* table;
+    const char* error;
+    unsigned int max_depth;
+    unsigned int line_number;
+    subreg_cost_t cost;
+    FILE* spec;
+    FILE* hdr;
+    int result;
+    int i;
+
+    output = NULL;
+    header = NULL;
+    table = NULL;
+    max_depth = 4;
+
+    for (i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2)
+    {
+        if ( strcmp(argv[i], "-d") == 0 )
+            max_depth = (unsigned int) strtoul(argv[i + 1], NULL, 0);
+        else if ( strcmp(argv[i], "-o") == 0 ) output = argv[i + 1];
+        else if ( strcmp(argv[i], "-H") == 0 ) header = argv[i + 1];
+        else if ( strcmp(argv[i], "-t") == 0 ) table = argv[i + 1];
+        else break;
+    }
+
+    if ( argc - i != 1 )
+    {
+        fprintf(stderr, "usage: %s [-d max-depth] [-o output.c] [-H output.h] "
+                "[-t table-name] spec-file\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    spec = fopen(argv[i], "r");
+
+    if ( !spec )
+    {
+        perror(argv[i]);
+        return EXIT_FAILURE;
+    }
+
+    out = output ? fopen(output, "w") : stdout;
+    hdr = header ? fopen(header, "w") : NULL;
+
+    if ( !out || (header && !hdr) )
+    {
+        perror(out ? header : output);
+        return EXIT_FAILURE;
+    }
+
+    if ( hdr )
+    {
+        const char* base;
+        char guard[MAX_NAME_LENGTH];
+        size_t length;
+
+        base = strrchr(header, '/');
+        header = base ? base + 1 : header;
+
+        /* include guard derived from the header's file name */
+        for (length = 0; header[length] && length + 1 < sizeof(guard);
+                length++)
+        {
+            guard[length] = isalnum((unsigned char) header[length]) ?
+                    (char) toupper((unsigned char) header[length]) : '_';
+        }
+
+        guard[length] = '\0';
+
+        fprintf(hdr, "/* generated by subreg-gen - do not edit */\n\n");
+        fprintf(hdr, "#ifndef SUBREG_GEN_%s\n#define SUBREG_GEN_%s\n\n",
+                guard, guard);
+        fprintf(hdr, "#include \"subreg.h\"\n\n");
+
+        if ( table ) emit_entry_type(hdr);
+    }
+
+    emit_prologue(header, table);
+
+    for (line_number = 1; fgets(line, sizeof(line), spec); line_number++)
+    {
+        const char* p;
+
+        for (p = line; isspace((unsigned char) *p); p++) {}
+        if ( *p == '\0' || *p == '#' ) continue;
+
+        error = read_spec_line(line, name, regex, sizeof(regex));
+
+        if ( error )
+        {
+            fprintf(stderr, "%s:%u: %s\n", argv[i], line_number, error);
+            return EXIT_FAILURE;
+        }
+
+        result = subreg_analyze(regex, max_depth, &cost);
+
+        if ( result < 0 )
+        {
+            fprintf(stderr, "%s:%u: invalid regular expression (error %d)\n",
+                    argv[i], line_number, result);
+            return EXIT_FAILURE;
+        }
+
+        emit_function(name, regex);
+
+        if ( hdr )
+        {
+            fprintf(hdr, "extern const char %s_regex[];\n", name);
+            fprintf(hdr, "int %s(const char* input, subreg_capture_t captures[],\n"
+                    "        unsigned int max_captures);\n\n", name);
+        }
+    }
+
+    if ( table )
+    {
+        unsigned int count;
+
+        /* the spec file has already been validated, so just collect names */
+        rewind(spec);
+
+        fprintf(out, "\n\nconst subreg_gen_entry_t %s[] =\n{\n", table);
+
+        for (count = 0; fgets(line, sizeof(line), spec);)
+        {
+            const char* p;
+
+            for (p = line; isspace((unsigned char) *p); p++) {}
+            if ( *p == '\0' || *p == '#' ) continue;
+
+            read_spec_line(line, name, regex, sizeof(regex));
+            fprintf(out, "    { %s_regex, %s },\n", name, name);
+            count++;
+        }
+
+        fprintf(out, "};\n\n\nconst unsigned int %s_count = %u;\n", table,
+                count);
+
+        if ( hdr )
+        {
+            fprintf(hdr, "extern const subreg_gen_entry_t %s[];\n", table);
+            fprintf(hdr, "extern const unsigned int %s_count;\n\n", table);
+        }
+    }
+
+    fclose(spec);
+
+    if ( hdr )
+    {
+        fprintf(hdr, "#endif\n");
+
+        if ( fclose(hdr) != 0 )
+        {
+            perror(header);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if ( output && fclose(out) != 0 )
+    {
+        perror(output);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
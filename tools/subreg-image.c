@@ -0,0 +1,162 @@
+/**
+ * SubReg - A small footprint regular expression engine written in ANSI C.
+ *
+ * https://github.com/mattbucknall/subreg
+ *
+ * Copyright (c) 2016-2021 Matthew T. Bucknall
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISIN
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Builds a SubReg pattern image offline.
+ *
+ * Usage:
+ *   subreg-image [-d max-depth] [-n array-name] [-b] patterns-file output-file
+ *
+ * patterns-file holds one regular expression per line. The image is written
+ * as a C source file defining a const unsigned char array (suitable for ROM),
+ * or with -b as a raw binary file (suitable for mmap).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <subreg.h>
+
+
+#define MAX_PATTERNS            4096
+#define MAX_LINE_LENGTH         4096
+
+
+static char* patterns[MAX_PATTERNS];
+
+
+static int write_c_array(FILE* file, const char* name,
+        const unsigned char* image, unsigned long size)
+{
+    unsigned long i;
+
+    fprintf(file, "/* generated by subreg-image, format version %d */\n\n",
+            SUBREG_IMAGE_VERSION);
+    fprintf(file, "const unsigned long %s_size = %luUL;\n\n", name, size);
+    fprintf(file, "const unsigned char %s[] =\n{", name);
+
+    for (i = 0; i < size; i++)
+        fprintf(file, "%s0x%02X,", (i % 12) ? " " : "\n    ", image[i]);
+
+    fprintf(file, "\n};\n");
+
+    return ferror(file) ? -1 : 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+    char line[MAX_LINE_LENGTH];
+    const char* name;
+    unsigned int max_depth;
+    unsigned int count;
+    unsigned long size;
+    unsigned char* image;
+    int binary;
+    int result;
+    FILE* file;
+    int i;
+
+    name = "subreg_image";
+    max_depth = 4;
+    binary = 0;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++)
+    {
+        if ( strcmp(argv[i], "-b") == 0 ) binary = 1;
+        else if ( strcmp(argv[i], "-d") == 0 && i + 1 < argc )
+            max_depth = (unsigned int) strtoul(argv[++i], NULL, 0);
+        else if ( strcmp(argv[i], "-n") == 0 && i + 1 < argc ) name = argv[++i];
+        else break;
+    }
+
+    if ( argc - i != 2 )
+    {
+        fprintf(stderr, "usage: %s [-d max-depth] [-n array-name] [-b] "
+                "patterns-file output-file\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    file = fopen(argv[i], "r");
+
+    if ( !file )
+    {
+        perror(argv[i]);
+        return EXIT_FAILURE;
+    }
+
+    for (count = 0; fgets(line, sizeof(line), file); count++)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if ( count == MAX_PATTERNS || !(patterns[count] = malloc(strlen(line) + 1)) )
+        {
+            fprintf(stderr, "%s: too many patterns\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+
+        strcpy(patterns[count], line);
+    }
+
+    fclose(file);
+
+    size = subreg_image_size((const char* const*) patterns, count);
+    image = malloc(size);
+
+    if ( !image )
+    {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    result = subreg_image_build(image, size, (const char* const*) patterns,
+            count, max_depth);
+
+    if ( result < 0 )
+    {
+        fprintf(stderr, "%s: invalid pattern (error %d)\n", argv[i], result);
+        return EXIT_FAILURE;
+    }
+
+    file = fopen(argv[i + 1], binary ? "wb" : "w");
+
+    if ( !file )
+    {
+        perror(argv[i + 1]);
+        return EXIT_FAILURE;
+    }
+
+    if ( binary ) result = fwrite(image, 1, size, file) == size ? 0 : -1;
+    else result = write_c_array(file, name, image, size);
+
+    if ( fclose(file) != 0 || result != 0 )
+    {
+        perror(argv[i + 1]);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}